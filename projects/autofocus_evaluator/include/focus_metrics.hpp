@@ -0,0 +1,105 @@
+/**
+ * @file focus_metrics.hpp
+ * @brief Focus (sharpness) metrics and their name registry, shared by autofocus_evaluator and
+ * autofocus_benchmark.
+ */
+
+#pragma once
+
+#include <functional>
+#include <opencv2/core.hpp>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Preprocessed focus-metric input for one frame (or ROI).
+ *
+ * The V channel of HSV is max(B, G, R), so it is computed once per frame without a color
+ * conversion and shared by every metric. The normalised float copy is created on first use;
+ * an instance must therefore not be shared between threads.
+ */
+class FocusInput {
+ public:
+  /// @param bgr BGR frame or ROI
+  explicit FocusInput(const cv::Mat& bgr);
+
+  /// V channel, 8-bit
+  const cv::Mat& v8() const { return v8_; }
+
+  /// V channel, CV_32F in [0,1]
+  const cv::Mat& v32() const {
+    if (v32_.empty()) v8_.convertTo(v32_, CV_32F, 1.0 / 255.0);
+    return v32_;
+  }
+
+ private:
+  cv::Mat v8_;
+  mutable cv::Mat v32_;
+};
+
+/**
+ * @brief Compute variance of the Laplacian on V channel.
+ * @param in Preprocessed frame
+ * @return Sum of squared Laplacian responses
+ */
+double varAbsLaplacian(const FocusInput& in);
+
+/**
+ * @brief Compute local variance on V channel using sliding window.
+ *
+ * The local variance of every ksize×ksize window is E[x²] − E[x]², with both means taken from
+ * box filters, so the cost does not depend on the window size. Row stripes run in parallel;
+ * filtering a stripe ROI reads the neighbouring rows of the full plane, so the result equals a
+ * single full-frame pass.
+ *
+ * @param in Preprocessed frame
+ * @param ksize Window size (default 3x3)
+ * @return Variance of local variances
+ */
+double varLocal(const FocusInput& in, int ksize = 3);
+
+/**
+ * @brief Compute variance of gradient magnitude on V channel.
+ * @param in Preprocessed frame
+ * @return Sum of squared gradient magnitudes
+ */
+double varGradMagnitude(const FocusInput& in);
+
+/**
+ * @brief Compute sum of modified Laplacian (Lovlac) on V channel.
+ * @param in Preprocessed frame
+ * @return Sum of absolute directional Laplacians
+ */
+double sumModifiedLaplacian(const FocusInput& in);
+
+//----------------------------------------------------------------------------------
+// Metric registry
+//----------------------------------------------------------------------------------
+
+/// Focus metric: higher score = sharper frame.
+using FocusMetric = std::function<double(const FocusInput&)>;
+
+/// Named entry of the metric registry.
+struct NamedFocusMetric {
+  std::string name;
+  FocusMetric fn;
+};
+
+/**
+ * @brief Returns the registry of available metrics, in report order.
+ *
+ * New metrics are added to the built-in list in focus_metrics.cpp (or with
+ * registerFocusMetric()) and are then selectable with `--metrics <name>`.
+ */
+std::vector<NamedFocusMetric>& focusMetricRegistry();
+
+/// Adds (or replaces) a metric in the registry.
+void registerFocusMetric(const std::string& name, FocusMetric fn);
+
+/**
+ * @brief Selects metrics from a comma-separated list of names.
+ * @param list Comma-separated names, or empty for every registered metric
+ * @param selected Receives the selected metrics in the given order
+ * @return False if a name is unknown
+ */
+bool selectFocusMetrics(const std::string& list, std::vector<NamedFocusMetric>& selected);
@@ -0,0 +1,237 @@
+/**
+ * @file autofocus_benchmark.cpp
+ * @brief Latency/throughput benchmark of the focus metrics in focus_metrics.hpp.
+ *
+ * This tool:
+ *  1. Decodes a set of sample frames spread over a video (default DATA_DIR/../data/focus-test.mp4).
+ *  2. For every combination of resolution (100 %, 50 %, 25 % of the frame) and centered ROI
+ *     (100 %, 50 %, 25 % of the resized frame), preprocesses the samples once.
+ *  3. Runs each metric in isolation: warmup calls first, then timed calls cycling over the
+ *     samples so consecutive calls do not hit the same cache-hot crop.
+ *  4. Reports p50/p95/p99 latency and throughput, and optionally writes them as JSON so results
+ *     can be compared between builds.
+ *
+ * Usage:
+ *   ./autofocus_benchmark [video_file] [--metrics name1,name2,...] [--frames N] [--warmup N]
+ *                         [--iterations N] [--json report.json]
+ *
+ * The pseudo-metric "preprocess" times the FocusInput construction shared by all metrics.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <opencv2/opencv.hpp>
+#include <string>
+#include <vector>
+
+#include "config.pch"  // Defines DATA_DIR macro
+#include "focus_metrics.hpp"
+
+namespace fs = std::filesystem;
+
+static const fs::path kDefaultVideo = fs::path(DATA_DIR) / "../data/focus-test.mp4";
+static const double kScales[] = {1.0, 0.5, 0.25};        ///< Frame resolutions benchmarked
+static const double kRoiFractions[] = {1.0, 0.5, 0.25};  ///< Centered ROI sizes benchmarked
+
+/// Latency statistics of one metric on one configuration.
+struct BenchResult {
+  std::string metric;
+  cv::Size frameSize;
+  cv::Size roiSize;
+  double p50 = 0, p95 = 0, p99 = 0, mean = 0;  ///< Milliseconds per call
+  double callsPerSec = 0;
+  double megapixelsPerSec = 0;
+};
+
+/**
+ * @brief Returns the nearest-rank percentile of sorted samples.
+ * @param sorted Samples in ascending order
+ * @param p Percentile in [0,100]
+ */
+double percentile(const std::vector<double>& sorted, double p) {
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+/**
+ * @brief Times @p call, running it @p warmup times untimed first.
+ * @param call Invoked with the iteration number
+ * @param warmup Untimed calls
+ * @param iterations Timed calls
+ * @return Per-call latencies in milliseconds, ascending
+ */
+template <typename Call>
+std::vector<double> timeCalls(Call&& call, int warmup, int iterations) {
+  for (int i = 0; i < warmup; ++i) call(i);
+  std::vector<double> ms(iterations);
+  for (int i = 0; i < iterations; ++i) {
+    auto start = std::chrono::steady_clock::now();
+    call(warmup + i);
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    ms[i] = std::chrono::duration<double, std::milli>(elapsed).count();
+  }
+  std::sort(ms.begin(), ms.end());
+  return ms;
+}
+
+/// Fills the statistics of @p r from ascending latencies.
+void summarize(const std::vector<double>& ms, BenchResult& r) {
+  double total = 0;
+  for (double t : ms) total += t;
+  r.mean = total / ms.size();
+  r.p50 = percentile(ms, 50);
+  r.p95 = percentile(ms, 95);
+  r.p99 = percentile(ms, 99);
+  r.callsPerSec = 1000.0 / r.mean;
+  r.megapixelsPerSec = r.callsPerSec * r.roiSize.area() * 1e-6;
+}
+
+/// Formats a size as "WxH".
+std::string sizeStr(cv::Size s) { return std::to_string(s.width) + "x" + std::to_string(s.height); }
+
+/// Escapes a string for a JSON string literal.
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+/**
+ * @brief Writes the results as JSON.
+ * @return False if the file cannot be written
+ */
+bool writeJson(const fs::path& path, const fs::path& video, int frames, int warmup,
+               int iterations, const std::vector<BenchResult>& results) {
+  std::ofstream out(path);
+  if (!out) return false;
+  out << "{\n  \"video\": \"" << jsonEscape(video.string()) << "\",\n"
+      << "  \"frames\": " << frames << ",\n  \"warmup\": " << warmup
+      << ",\n  \"iterations\": " << iterations << ",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const BenchResult& r = results[i];
+    out << "    {\"metric\": \"" << jsonEscape(r.metric) << "\", \"width\": " << r.frameSize.width
+        << ", \"height\": " << r.frameSize.height << ", \"roi_width\": " << r.roiSize.width
+        << ", \"roi_height\": " << r.roiSize.height << ", \"p50_ms\": " << r.p50
+        << ", \"p95_ms\": " << r.p95 << ", \"p99_ms\": " << r.p99 << ", \"mean_ms\": " << r.mean
+        << ", \"calls_per_s\": " << r.callsPerSec << ", \"mpix_per_s\": " << r.megapixelsPerSec
+        << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+  }
+  out << "  ]\n}\n";
+  return static_cast<bool>(out);
+}
+
+int main(int argc, char* argv[]) {
+  // Parse options
+  fs::path videoPath = kDefaultVideo;
+  fs::path jsonPath;
+  std::string metricList;
+  int numFrames = 16, warmup = 5, iterations = 100;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--metrics" && hasValue) {
+      metricList = argv[++i];
+    } else if (arg == "--frames" && hasValue) {
+      numFrames = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--warmup" && hasValue) {
+      warmup = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--json" && hasValue) {
+      jsonPath = argv[++i];
+    } else {
+      videoPath = arg;
+    }
+  }
+  std::vector<NamedFocusMetric> metrics;
+  if (!selectFocusMetrics(metricList, metrics)) return EXIT_FAILURE;
+
+  // Decode sample frames spread evenly over the video
+  cv::VideoCapture cap(videoPath.string());
+  if (!cap.isOpened()) {
+    std::cerr << "ERROR: Cannot open video: " << videoPath << std::endl;
+    return EXIT_FAILURE;
+  }
+  const int totalFrames = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+  const int stride = std::max(1, totalFrames / numFrames);
+  std::vector<cv::Mat> samples;
+  cv::Mat frame;
+  for (int index = 0; static_cast<int>(samples.size()) < numFrames && cap.read(frame); ++index) {
+    if (index % stride == 0) samples.push_back(frame.clone());
+  }
+  if (samples.empty()) {
+    std::cerr << "ERROR: No frames decoded from " << videoPath << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<BenchResult> results;
+  std::cout << std::left << std::setw(22) << "metric" << std::setw(12) << "frame" << std::setw(12)
+            << "roi" << std::right << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms"
+            << std::setw(10) << "p99 ms" << std::setw(10) << "calls/s" << std::setw(10)
+            << "MPix/s" << std::endl;
+  auto print = [](const BenchResult& r) {
+    std::cout << std::left << std::setw(22) << r.metric << std::setw(12) << sizeStr(r.frameSize)
+              << std::setw(12) << sizeStr(r.roiSize) << std::right << std::fixed
+              << std::setprecision(3) << std::setw(10) << r.p50 << std::setw(10) << r.p95
+              << std::setw(10) << r.p99 << std::setprecision(1) << std::setw(10) << r.callsPerSec
+              << std::setw(10) << r.megapixelsPerSec << std::defaultfloat << std::endl;
+  };
+
+  for (double scale : kScales) {
+    std::vector<cv::Mat> scaled(samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+      cv::resize(samples[i], scaled[i], cv::Size(), scale, scale, cv::INTER_AREA);
+    const cv::Size frameSize = scaled.front().size();
+
+    for (double fraction : kRoiFractions) {
+      const cv::Size roiSize(std::max(1, static_cast<int>(frameSize.width * fraction)),
+                             std::max(1, static_cast<int>(frameSize.height * fraction)));
+      const cv::Rect roi((frameSize.width - roiSize.width) / 2,
+                         (frameSize.height - roiSize.height) / 2, roiSize.width, roiSize.height);
+      const size_t n = scaled.size();
+
+      // Preprocessing on its own
+      BenchResult pre{"preprocess", frameSize, roiSize};
+      summarize(timeCalls(
+                    [&](int i) {
+                      FocusInput input(scaled[i % n](roi));
+                      input.v32();
+                    },
+                    warmup, iterations),
+                pre);
+      results.push_back(pre);
+      print(pre);
+
+      // Metrics on prebuilt inputs (float plane already cached)
+      std::vector<FocusInput> inputs;
+      for (const auto& f : scaled) {
+        inputs.emplace_back(f(roi));
+        inputs.back().v32();
+      }
+      for (const auto& m : metrics) {
+        BenchResult r{m.name, frameSize, roiSize};
+        summarize(timeCalls([&](int i) { m.fn(inputs[i % n]); }, warmup, iterations), r);
+        results.push_back(r);
+        print(r);
+      }
+    }
+  }
+
+  if (!jsonPath.empty()) {
+    if (!writeJson(jsonPath, videoPath, static_cast<int>(samples.size()), warmup, iterations,
+                   results)) {
+      std::cerr << "ERROR: Failed to write " << jsonPath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << jsonPath << std::endl;
+  }
+  return EXIT_SUCCESS;
+}
@@ -4,186 +4,366 @@
  *
  * This tool:
  *  1. Opens a video file or default DATA_DIR/../data/focus-test.mp4.
- *  2. Computes four focus measures on each frame or ROI:
+ *  2. Computes the V plane of each frame or ROI once (FocusInput) and evaluates the selected
+ *     focus measures on it (all by default):
  *     - Variance of Laplacian (absolute)
  *     - Sum of Modified Laplacian
  *     - Local variance
  *     - Variance of gradient magnitude
- *  3. Tracks timing per-frame and identifies the frame with maximum focus for each metric.
+ *  3. Scores frames in parallel (decoder thread + worker pool), tracks timing and identifies the
+ *     frame with maximum focus for each metric. Only indices are kept during the scan; the
+ *     winning frames are read back afterwards.
  *  4. Reports the best frame IDs and average computation times.
- *  5. Displays a concatenated image of the best frames side-by-side.
+ *  5. Displays a grid of the best frames side-by-side.
  *
  * Usage:
  *   ./autofocus_evaluator [video_file] [top left X] [top left Y] [width] [height]
+ *                         [--metrics name1,name2,...] [--search [--step N] [--level L]]
+ *
+ * --search assumes a unimodal focus curve: every Nth frame (default 10) is scored at pyramid
+ * level L (default 2), then each metric's peak is refined at full resolution by seeking.
  *
  * If video_file is not provided, defaults to DATA_DIR/../data/focus-test.mp4.
  * If ROI parameters are omitted, uses the full frame.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
+#include <limits>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "config.pch"  // Defines DATA_DIR macro
+#include "focus_metrics.hpp"
+#include "portfolio/bounded_queue.hpp"
+#include "portfolio/image_io.hpp"
 
 namespace fs = std::filesystem;
 
 static const fs::path kDefaultVideo = fs::path(DATA_DIR) / "../data/focus-test.mp4";
 
 /**
- * @brief Displays an image in a resizable window.
- * @param image Image to display
- * @param windowName Optional window name (default "Image")
+ * @brief Tiles images into a near-square grid (empty cells stay black).
+ * @param images Same-size, same-type images
+ * @return Grid image
  */
-void displayImage(const cv::Mat& image, const std::string& windowName = "Image") {
-  cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-  cv::resizeWindow(windowName, cv::Size(1200, 900));
-  cv::imshow(windowName, image);
-  cv::waitKey(0);
-  cv::destroyWindow(windowName);
+cv::Mat makeGrid(const std::vector<cv::Mat>& images) {
+  const int cols = static_cast<int>(std::ceil(std::sqrt(static_cast<double>(images.size()))));
+  const int rows = (static_cast<int>(images.size()) + cols - 1) / cols;
+  const cv::Size cell = images.front().size();
+  cv::Mat grid = cv::Mat::zeros(cell.height * rows, cell.width * cols, images.front().type());
+  for (size_t i = 0; i < images.size(); ++i) {
+    const int r = static_cast<int>(i) / cols, c = static_cast<int>(i) % cols;
+    images[i].copyTo(grid(cv::Rect(c * cell.width, r * cell.height, cell.width, cell.height)));
+  }
+  return grid;
 }
 
+//----------------------------------------------------------------------------------
+// Parallel scan
+//----------------------------------------------------------------------------------
+
+/// Best score of one metric and the frame that produced it.
+struct BestFrame {
+  double score = 0.0;
+  int index = -1;
+};
+
 /**
- * @brief Compute variance of the Laplacian on V channel.
- * @param image BGR image
- * @return Sum of squared Laplacian responses
+ * @brief Per-metric argmax plus timing, accumulated privately by each worker.
  */
-double varAbsLaplacian(const cv::Mat& image) {
-  cv::Mat hsv, v;
-  cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-  std::vector<cv::Mat> channels;
-  cv::split(hsv, channels);
-  v = channels[2];
-
-  cv::Mat lap;
-  cv::Laplacian(v, lap, CV_32F, 3, 1.0 / (255.0 * 3 * 2));
-  cv::Mat sq;
-  cv::pow(lap, 2.0, sq);
-  return cv::sum(sq)[0];
-}
+struct ScanResult {
+  std::vector<BestFrame> best;
+  std::vector<double> timeMs;
+  int frames = 0;
+
+  explicit ScanResult(size_t numMetrics) : best(numMetrics), timeMs(numMetrics, 0.0) {}
+
+  /// Folds another worker's result in; ties go to the earliest frame, as in a serial scan.
+  void merge(const ScanResult& other) {
+    for (size_t m = 0; m < best.size(); ++m) {
+      const BestFrame& o = other.best[m];
+      if (o.index < 0) continue;
+      if (best[m].index < 0 || o.score > best[m].score ||
+          (o.score == best[m].score && o.index < best[m].index))
+        best[m] = o;
+      timeMs[m] += other.timeMs[m];
+    }
+    frames += other.frames;
+  }
+};
+
+/// Decoded frame handed from the decoder to the workers.
+struct FrameJob {
+  int index;
+  cv::Mat frame;
+};
 
 /**
- * @brief Compute local variance on V channel using sliding window.
- * @param image BGR image
- * @param ksize Window size (default 3x3)
- * @return Variance of local variances
+ * @brief Scores every frame of an opened video with a decoder thread feeding a worker pool.
+ *
+ * Each worker keeps its own argmax per metric, so the scan needs no lock besides the queue and
+ * never copies a frame; the winners are fetched afterwards with fetchFrames().
+ *
+ * @param cap Opened capture, read from the decoder thread
+ * @param roi Region evaluated in every frame
+ * @param metrics Metrics to evaluate
+ * @param numWorkers Number of scoring threads
+ * @return Merged result
  */
-double varLocal(const cv::Mat& image, int ksize = 3) {
-  cv::Mat L_result;
-
-  int wy = 3;
-  int wx = 3;
-  cv::Mat mean_kernel = cv::Mat::ones(cv::Size(wx, wy), CV_32F);
-
-  cv::Mat HSV;
-  std::vector<cv::Mat> HSV_Ch;
-  cv::cvtColor(image, HSV, cv::COLOR_BGR2HSV);
-  split(HSV, HSV_Ch);
-
-  cv::Mat Vch_normalized;
-  HSV_Ch[2].convertTo(Vch_normalized, CV_32F, 1.0 / 255.0);
-
-  cv::Mat mean_filtered_image;
-  cv::filter2D(Vch_normalized, mean_filtered_image, CV_32F, mean_kernel, cv::Point(-1, -1), 0.0,
-               cv::BORDER_DEFAULT);
-  mean_filtered_image = mean_filtered_image / (wy * wx);
-
-  cv::Mat Vch_normalized_borderExpanded;
-  cv::copyMakeBorder(Vch_normalized, Vch_normalized_borderExpanded, 0, wy, 0, wx,
-                     cv::BORDER_DEFAULT);
-  cv::Mat lvk(Vch_normalized.size(), CV_32F);
-  for (int m = 0; m < image.cols; m++) {
-    for (int n = 0; n < image.rows; n++) {
-      float lvk_mn = 0;
-      float fbark_mn = mean_filtered_image.at<float>(cv::Point(m, n));
-      for (int i = 0; i < wx; i++) {
-        for (int j = 0; j < wy; j++) {
-          float fk_minj = Vch_normalized_borderExpanded.at<float>(cv::Point(m + i, n + j));
-          float fk_fbark_diff = fk_minj - fbark_mn;
-          lvk_mn += cv::pow(fk_fbark_diff, 2.0);
+ScanResult scanVideo(cv::VideoCapture& cap, const cv::Rect& roi,
+                     const std::vector<NamedFocusMetric>& metrics, int numWorkers) {
+  portfolio::BoundedQueue<FrameJob> queue(2 * numWorkers);
+
+  std::thread decoder([&] {
+    int index = 0;
+    // A fresh Mat per frame: the queued buffer must not be reused by the next read
+    for (cv::Mat frame; cap.read(frame); frame = cv::Mat()) {
+      if (!queue.push(FrameJob{index++, std::move(frame)})) break;
+    }
+    queue.close();
+  });
+
+  std::vector<ScanResult> partial(numWorkers, ScanResult(metrics.size()));
+  std::vector<std::thread> workers;
+  for (int t = 0; t < numWorkers; ++t) {
+    workers.emplace_back([&, t] {
+      ScanResult& local = partial[t];
+      while (auto job = queue.pop()) {
+        const FocusInput input(job->frame(roi));
+        for (size_t m = 0; m < metrics.size(); ++m) {
+          auto start = std::chrono::steady_clock::now();
+          double score = metrics[m].fn(input);
+          auto elapsed = std::chrono::steady_clock::now() - start;
+          local.timeMs[m] += std::chrono::duration<double, std::milli>(elapsed).count();
+          BestFrame& b = local.best[m];
+          if (b.index < 0 || score > b.score || (score == b.score && job->index < b.index))
+            b = {score, job->index};
         }
+        ++local.frames;
       }
-      lvk.at<float>(cv::Point(m, n)) = lvk_mn;
-    }
+    });
   }
-  lvk = lvk / (wx * wy);
-  float mean_lvk = cv::sum(lvk)[0] / (lvk.cols * lvk.rows);
-  cv::Mat lvk_mean_lvk_diff = lvk - mean_lvk;
-  cv::Mat lvk_mean_lvk_diff_pow2;
-  cv::pow(lvk_mean_lvk_diff, 2.0, lvk_mean_lvk_diff_pow2);
-  float fmVk = cv::sum(lvk_mean_lvk_diff_pow2)[0] / (lvk.cols * lvk.rows);
-  return fmVk;
+
+  decoder.join();
+  for (auto& w : workers) w.join();
+
+  ScanResult result(metrics.size());
+  for (const auto& p : partial) result.merge(p);
+  return result;
 }
 
 /**
- * @brief Compute variance of gradient magnitude on V channel.
- * @param image BGR image
- * @return Sum of squared gradient magnitudes
+ * @brief Reads the given frames of a video, seeking when possible.
+ *
+ * Seeks with CAP_PROP_POS_FRAMES and falls back to a forward scan if the container does not
+ * support accurate seeking.
+ *
+ * @param videoPath Video file
+ * @param indices Frame indices to fetch
+ * @return Map from frame index to frame (missing if the frame could not be read)
  */
-double varGradMagnitude(const cv::Mat& image) {
-  cv::Mat hsv;
-  cv::cvtColor(image, hsv, cv::COLOR_BGR2HSV);
-  cv::Mat v;
-  cv::extractChannel(hsv, v, 2);
-  v.convertTo(v, CV_32F, 1.0 / 255.0);
-
-  cv::Mat gx, gy;
-  cv::Sobel(v, gx, CV_32F, 1, 0, 3);
-  cv::Sobel(v, gy, CV_32F, 0, 1, 3);
-
-  cv::Mat mag2 = gx.mul(gx) + gy.mul(gy);
-  return cv::sum(mag2)[0];
+std::map<int, cv::Mat> fetchFrames(const fs::path& videoPath, std::vector<int> indices) {
+  std::sort(indices.begin(), indices.end());
+  indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+  std::map<int, cv::Mat> frames;
+  cv::VideoCapture cap(videoPath.string());
+  if (!cap.isOpened()) return frames;
+
+  bool seekable = true;
+  for (int index : indices) {
+    cv::Mat frame;
+    if (!cap.set(cv::CAP_PROP_POS_FRAMES, index) ||
+        static_cast<int>(cap.get(cv::CAP_PROP_POS_FRAMES)) != index || !cap.read(frame)) {
+      seekable = false;
+      break;
+    }
+    frames[index] = frame;
+  }
+  if (seekable) return frames;
+
+  // Forward scan from the start
+  frames.clear();
+  cap.release();
+  cap.open(videoPath.string());
+  cv::Mat frame;
+  size_t next = 0;
+  for (int index = 0; next < indices.size() && cap.read(frame); ++index) {
+    if (index == indices[next]) {
+      frames[index] = frame.clone();
+      ++next;
+    }
+  }
+  return frames;
 }
 
+//----------------------------------------------------------------------------------
+// Coarse-to-fine search
+//----------------------------------------------------------------------------------
+
 /**
- * @brief Compute sum of modified Laplacian (Lovlac) on V channel.
- * @param image BGR image
- * @return Sum of absolute directional Laplacians
+ * @brief Random-access frame reader that grabs through short gaps and seeks across long ones.
  */
-double sumModifiedLaplacian(const cv::Mat& image) {
-  cv::Mat L_x_result;
-  cv::Mat L_y_result;
-
-  int kSize = 3;
-  cv::Mat HSV;
-  std::vector<cv::Mat> HSV_Ch;
-  cv::cvtColor(image, HSV, cv::COLOR_BGR2HSV);
-  split(HSV, HSV_Ch);
-
-  cv::Mat kernelx = cv::Mat::zeros(cv::Size(kSize, 1), CV_32F);
-  kernelx.at<float>(cv::Point(0, 0)) = -1.0;
-  kernelx.at<float>(cv::Point(1, 0)) = 2.0;
-  kernelx.at<float>(cv::Point(2, 0)) = -1.0;
-
-  cv::Mat kernely = cv::Mat::zeros(cv::Size(1, kSize), CV_32F);
-  kernely.at<float>(cv::Point(0, 0)) = -1.0;
-  kernely.at<float>(cv::Point(0, 1)) = 2.0;
-  kernely.at<float>(cv::Point(0, 2)) = -1.0;
-
-  cv::Mat Vch_normalized;
-  HSV_Ch[2].convertTo(Vch_normalized, CV_32F, 1.0 / 255.0);
-
-  cv::filter2D(Vch_normalized, L_x_result, CV_32F, kernelx, cv::Point(-1, -1), 0.0,
-               cv::BORDER_DEFAULT);
-  cv::filter2D(Vch_normalized, L_y_result, CV_32F, kernely, cv::Point(-1, -1), 0.0,
-               cv::BORDER_DEFAULT);
-
-  cv::Mat L_x_result_abs, L_y_result_abs;
-  L_x_result_abs = cv::abs(L_x_result);
-  L_y_result_abs = cv::abs(L_y_result);
-  double sum_abs_Lx, sum_abs_Ly;
-  sum_abs_Lx = cv::sum(L_x_result_abs)[0];
-  sum_abs_Ly = cv::sum(L_y_result_abs)[0];
-  double var = (sum_abs_Lx + sum_abs_Ly);
-
-  return var;
+class FrameReader {
+ public:
+  explicit FrameReader(cv::VideoCapture& cap) : cap_(cap) {}
+
+  /// Reads frame @p index into @p frame; returns false past the end or if seeking fails.
+  bool read(int index, cv::Mat& frame) {
+    const int gap = index - next_;
+    if (gap < 0 || gap > kMaxGrabGap) {
+      if (!cap_.set(cv::CAP_PROP_POS_FRAMES, index)) return false;
+    } else {
+      for (int i = 0; i < gap; ++i, ++decoded_)
+        if (!cap_.grab()) return false;
+    }
+    next_ = index + 1;
+    if (!cap_.read(frame)) return false;
+    ++decoded_;
+    return true;
+  }
+
+  /// Frames grabbed or read so far (frames decoded internally while seeking are not visible).
+  int decoded() const { return decoded_; }
+
+ private:
+  static constexpr int kMaxGrabGap = 8;  ///< Longer forward gaps are skipped by seeking
+
+  cv::VideoCapture& cap_;
+  int next_ = 0;
+  int decoded_ = 0;
+};
+
+/// Work done by searchVideo(), for comparison with an exhaustive scan.
+struct SearchStats {
+  int coarseScored = 0;  ///< Frames scored at the reduced level
+  int decoded = 0;       ///< Frames grabbed or read
+};
+
+/**
+ * @brief Finds each metric's best frame assuming a unimodal focus curve.
+ *
+ * Scores every @p step-th frame on the ROI reduced by @p level pyrDown steps, then refines
+ * around each metric's coarse peak at full resolution with a golden-section search over
+ * [peak − step, peak + step] (seeking with CAP_PROP_POS_FRAMES) and an exhaustive check of the
+ * last few frames. Full-resolution scores are cached, so metrics with nearby peaks share work.
+ *
+ * @param cap Opened, seekable capture
+ * @param roi Region evaluated in every frame
+ * @param metrics Metrics to evaluate
+ * @param step Coarse sampling stride in frames
+ * @param level Number of pyrDown steps of the coarse pass
+ * @param stats Receives the amount of work done
+ * @return Best frames; `frames` and `timeMs` cover the full-resolution evaluations only
+ */
+ScanResult searchVideo(cv::VideoCapture& cap, const cv::Rect& roi,
+                       const std::vector<NamedFocusMetric>& metrics, int step, int level,
+                       SearchStats& stats) {
+  const int total = static_cast<int>(cap.get(cv::CAP_PROP_FRAME_COUNT));
+  FrameReader reader(cap);
+  ScanResult result(metrics.size());
+  cv::Mat frame;
+
+  // Coarse pass
+  std::vector<BestFrame> coarse(metrics.size());
+  for (int index = 0; index < total; index += step) {
+    if (!reader.read(index, frame)) break;
+    cv::Mat small = frame(roi);
+    for (int l = 0; l < level; ++l) cv::pyrDown(small, small);
+    const FocusInput input(small);
+    for (size_t m = 0; m < metrics.size(); ++m) {
+      double score = metrics[m].fn(input);
+      if (coarse[m].index < 0 || score > coarse[m].score) coarse[m] = {score, index};
+    }
+    ++stats.coarseScored;
+  }
+
+  // Full-resolution scores of every metric, per frame
+  std::map<int, std::vector<double>> scored;
+  auto scoreAt = [&](int index, size_t m) {
+    auto it = scored.find(index);
+    if (it == scored.end()) {
+      std::vector<double> scores(metrics.size(), -std::numeric_limits<double>::infinity());
+      if (reader.read(index, frame)) {
+        const FocusInput input(frame(roi));
+        for (size_t k = 0; k < metrics.size(); ++k) {
+          auto start = std::chrono::steady_clock::now();
+          scores[k] = metrics[k].fn(input);
+          auto elapsed = std::chrono::steady_clock::now() - start;
+          result.timeMs[k] += std::chrono::duration<double, std::milli>(elapsed).count();
+        }
+        ++result.frames;
+      }
+      it = scored.emplace(index, std::move(scores)).first;
+    }
+    return it->second[m];
+  };
+
+  // Refinement around each coarse peak
+  constexpr double kInvPhi = 0.6180339887498949;
+  for (size_t m = 0; m < metrics.size(); ++m) {
+    if (coarse[m].index < 0) continue;
+    int lo = std::max(0, coarse[m].index - step);
+    int hi = std::min(total - 1, coarse[m].index + step);
+    while (hi - lo > 3) {
+      const int c = hi - static_cast<int>(std::lround((hi - lo) * kInvPhi));
+      const int d = lo + static_cast<int>(std::lround((hi - lo) * kInvPhi));
+      if (c >= d) break;
+      // On ties keep the earlier half, like the serial scan keeps the earliest maximum
+      if (scoreAt(c, m) >= scoreAt(d, m))
+        hi = d;
+      else
+        lo = c;
+    }
+    for (int index = lo; index <= hi; ++index) {
+      double score = scoreAt(index, m);
+      if (result.best[m].index < 0 || score > result.best[m].score)
+        result.best[m] = {score, index};
+    }
+  }
+
+  stats.decoded = reader.decoded();
+  return result;
 }
 
 int main(int argc, char* argv[]) {
+  // Split options from positional arguments
+  std::string metricList;
+  bool search = false;
+  int searchStep = 10, searchLevel = 2;
+  std::vector<std::string> args;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--metrics" && i + 1 < argc) {
+      metricList = argv[++i];
+    } else if (arg == "--search") {
+      search = true;
+    } else if (arg == "--step" && i + 1 < argc) {
+      searchStep = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--level" && i + 1 < argc) {
+      searchLevel = std::max(0, std::stoi(argv[++i]));
+    } else {
+      args.emplace_back(argv[i]);
+    }
+  }
+  std::vector<NamedFocusMetric> metrics;
+  if (!selectFocusMetrics(metricList, metrics)) {
+    std::cerr << "Available metrics:";
+    for (const auto& m : focusMetricRegistry()) std::cerr << " " << m.name;
+    std::cerr << std::endl;
+    return EXIT_FAILURE;
+  }
+
   // Open video
-  fs::path videoPath = (argc > 1 ? argv[1] : kDefaultVideo);
+  fs::path videoPath = (!args.empty() ? fs::path(args[0]) : kDefaultVideo);
   cv::VideoCapture cap(videoPath.string());
   if (!cap.isOpened()) {
     std::cerr << "ERROR: Cannot open video: " << videoPath << std::endl;
@@ -193,84 +373,60 @@ int main(int argc, char* argv[]) {
   // Optional ROI args
   int x = 0, y = 0, w = (int)cap.get(cv::CAP_PROP_FRAME_WIDTH),
       h = (int)cap.get(cv::CAP_PROP_FRAME_HEIGHT);
-  if (argc >= 6) {
-    x = std::stoi(argv[2]);
-    y = std::stoi(argv[3]);
-    w = std::stoi(argv[4]);
-    h = std::stoi(argv[5]);
+  if (args.size() >= 5) {
+    x = std::stoi(args[1]);
+    y = std::stoi(args[2]);
+    w = std::stoi(args[3]);
+    h = std::stoi(args[4]);
   }
   cv::Rect roi(x, y, w, h);
 
   int totalFrames = (int)cap.get(cv::CAP_PROP_FRAME_COUNT);
   std::cout << "Total frames: " << totalFrames << std::endl;
 
-  // Timing accumulators
-  double t1 = 0, t2 = 0, t3 = 0, t4 = 0;
-  // Best values & frames
-  double best1 = 0, best2 = 0, best3 = 0, best4 = 0;
-  // Frame #
-  int fbest1 = 0, fbest2 = 0, fbest3 = 0, fbest4 = 0;
-
-  cv::Mat f1, f2, f3, f4;
-  int idx = 0;
-
-  cv::Mat frame;
-  while (cap.read(frame)) {
-    cv::Mat crop = frame(roi);
-    auto start = std::chrono::high_resolution_clock::now();
-    double v1 = varAbsLaplacian(crop);
-    t1 += (std::chrono::high_resolution_clock::now() - start).count() * 1e-6;
-    start = std::chrono::high_resolution_clock::now();
-    double v2 = sumModifiedLaplacian(crop);
-    t2 += (std::chrono::high_resolution_clock::now() - start).count() * 1e-6;
-    start = std::chrono::high_resolution_clock::now();
-    double v3 = varLocal(crop);
-    t3 += (std::chrono::high_resolution_clock::now() - start).count() * 1e-6;
-    start = std::chrono::high_resolution_clock::now();
-    double v4 = varGradMagnitude(crop);
-    t4 += (std::chrono::high_resolution_clock::now() - start).count() * 1e-6;
-
-    if (v1 > best1) {
-      best1 = v1;
-      f1 = frame.clone();
-      fbest1 = idx;
+  ScanResult scan(metrics.size());
+  if (search) {
+    if (totalFrames <= 0) {
+      std::cerr << "ERROR: --search needs a seekable video with a known frame count" << std::endl;
+      return EXIT_FAILURE;
     }
-    if (v2 > best2) {
-      best2 = v2;
-      f2 = frame.clone();
-      fbest2 = idx;
-    }
-    if (v3 > best3) {
-      best3 = v3;
-      f3 = frame.clone();
-      fbest3 = idx;
-    }
-    if (v4 > best4) {
-      best4 = v4;
-      f4 = frame.clone();
-      fbest4 = idx;
-    }
-    idx++;
+    SearchStats stats;
+    scan = searchVideo(cap, roi, metrics, searchStep, searchLevel, stats);
+    std::cout << "Search: decoded " << stats.decoded << " of " << totalFrames << " frames, scored "
+              << stats.coarseScored << " at 1/" << (1 << searchLevel) << " resolution + "
+              << scan.frames << " at full resolution (exhaustive scan: " << totalFrames
+              << " at full resolution)" << std::endl;
+  } else {
+    // Score all frames in parallel, keeping only indices and scores
+    const int numWorkers = std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    scan = scanVideo(cap, roi, metrics, numWorkers);
+  }
+  const size_t numMetrics = metrics.size();
+  const int idx = scan.frames;
+  if (idx == 0) {
+    std::cerr << "ERROR: No frames decoded from " << videoPath << std::endl;
+    return EXIT_FAILURE;
   }
 
   // Report
   std::cout << "========================================" << std::endl;
-  std::cout << "Best frames (1..4): " << best1 << ", " << best2 << ", " << best3 << ", " << best4
-            << std::endl;
-  std::cout << "FrameNumber (1..4): " << best1 << ", " << best2 << ", " << best3 << ", " << best4
-            << std::endl;
-  std::cout << "Avg time per frame (ms):\n"
-            << " varAbsLaplacian:     " << (t1 / idx) << "\n"
-            << " sumModifiedLaplacian:" << (t2 / idx) << "\n"
-            << " varLocal:             " << (t3 / idx) << "\n"
-            << " varGradMagnitude:    " << (t4 / idx) << std::endl;
-
-  // Concatenate best frames 2x2
-  cv::Mat top, bottom, all;
-  cv::hconcat(f1, f2, top);
-  cv::hconcat(f3, f4, bottom);
-  cv::vconcat(top, bottom, all);
-  displayImage(all, "Best Focus Frames");
+  std::cout << "Metric                 best score    frame   avg ms/frame" << std::endl;
+  for (size_t m = 0; m < numMetrics; ++m) {
+    std::cout << std::left << std::setw(22) << metrics[m].name << std::right << std::setw(12)
+              << scan.best[m].score << std::setw(9) << scan.best[m].index << std::setw(14)
+              << scan.timeMs[m] / idx << std::endl;
+  }
+
+  // Fetch the winning frames and show them side by side
+  std::vector<int> winners;
+  for (const auto& b : scan.best) winners.push_back(b.index);
+  const std::map<int, cv::Mat> frames = fetchFrames(videoPath, winners);
+  std::vector<cv::Mat> found;
+  for (int index : winners) {
+    auto it = frames.find(index);
+    if (it != frames.end()) found.push_back(it->second);
+  }
+  if (!found.empty()) portfolio::showImage("Best Focus Frames", makeGrid(found));
 
   return EXIT_SUCCESS;
 }
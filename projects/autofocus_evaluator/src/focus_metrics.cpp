@@ -0,0 +1,122 @@
+/**
+ * @file focus_metrics.cpp
+ * @brief Focus metric implementations and the built-in metric registry.
+ */
+
+#include "focus_metrics.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <opencv2/imgproc.hpp>
+#include <sstream>
+#include <vector>
+
+FocusInput::FocusInput(const cv::Mat& bgr) {
+  cv::Mat channels[3];
+  cv::split(bgr, channels);
+  cv::max(channels[0], channels[1], v8_);
+  cv::max(v8_, channels[2], v8_);
+}
+
+double varAbsLaplacian(const FocusInput& in) {
+  cv::Mat lap;
+  cv::Laplacian(in.v8(), lap, CV_32F, 3, 1.0 / (255.0 * 3 * 2));
+  return lap.dot(lap);
+}
+
+double varLocal(const FocusInput& in, int ksize) {
+  const cv::Mat& v = in.v32();
+  cv::Mat vSq = v.mul(v);
+
+  const cv::Size window(std::max(ksize, 1), std::max(ksize, 1));
+  const int numStripes = std::max(1, std::min(v.rows / 16, cv::getNumThreads() * 4));
+  std::vector<double> sumLv(numStripes, 0.0), sumLvSq(numStripes, 0.0);
+
+  cv::parallel_for_(cv::Range(0, numStripes), [&](const cv::Range& range) {
+    for (int s = range.start; s < range.end; ++s) {
+      const cv::Range rows(v.rows * s / numStripes, v.rows * (s + 1) / numStripes);
+      cv::Mat mean, meanSq;
+      cv::boxFilter(v.rowRange(rows), mean, CV_32F, window, cv::Point(-1, -1), true,
+                    cv::BORDER_DEFAULT);
+      cv::boxFilter(vSq.rowRange(rows), meanSq, CV_32F, window, cv::Point(-1, -1), true,
+                    cv::BORDER_DEFAULT);
+
+      // Local variance, clamped against float cancellation in flat areas
+      cv::Mat lv = meanSq - mean.mul(mean);
+      cv::max(lv, 0.0, lv);
+      sumLv[s] = cv::sum(lv)[0];
+      sumLvSq[s] = lv.dot(lv);
+    }
+  });
+
+  double total = 0, totalSq = 0;
+  for (int s = 0; s < numStripes; ++s) {
+    total += sumLv[s];
+    totalSq += sumLvSq[s];
+  }
+  const double n = static_cast<double>(v.total());
+  const double meanLv = total / n;
+  return std::max(totalSq / n - meanLv * meanLv, 0.0);
+}
+
+double varGradMagnitude(const FocusInput& in) {
+  cv::Mat gx, gy;
+  cv::Sobel(in.v32(), gx, CV_32F, 1, 0, 3);
+  cv::Sobel(in.v32(), gy, CV_32F, 0, 1, 3);
+  return gx.dot(gx) + gy.dot(gy);
+}
+
+double sumModifiedLaplacian(const FocusInput& in) {
+  const cv::Mat kernelx = (cv::Mat_<float>(1, 3) << -1.0f, 2.0f, -1.0f);
+  const cv::Mat kernely = kernelx.t();
+
+  cv::Mat lx, ly;
+  cv::filter2D(in.v32(), lx, CV_32F, kernelx, cv::Point(-1, -1), 0.0, cv::BORDER_DEFAULT);
+  cv::filter2D(in.v32(), ly, CV_32F, kernely, cv::Point(-1, -1), 0.0, cv::BORDER_DEFAULT);
+  return cv::norm(lx, cv::NORM_L1) + cv::norm(ly, cv::NORM_L1);
+}
+
+//----------------------------------------------------------------------------------
+// Metric registry
+//----------------------------------------------------------------------------------
+
+std::vector<NamedFocusMetric>& focusMetricRegistry() {
+  static std::vector<NamedFocusMetric> registry = {
+      {"varAbsLaplacian", varAbsLaplacian},
+      {"sumModifiedLaplacian", sumModifiedLaplacian},
+      {"varLocal", [](const FocusInput& in) { return varLocal(in); }},
+      {"varGradMagnitude", varGradMagnitude},
+  };
+  return registry;
+}
+
+void registerFocusMetric(const std::string& name, FocusMetric fn) {
+  auto& registry = focusMetricRegistry();
+  for (auto& entry : registry) {
+    if (entry.name == name) {
+      entry.fn = std::move(fn);
+      return;
+    }
+  }
+  registry.push_back({name, std::move(fn)});
+}
+
+bool selectFocusMetrics(const std::string& list, std::vector<NamedFocusMetric>& selected) {
+  const auto& registry = focusMetricRegistry();
+  if (list.empty()) {
+    selected = registry;
+    return true;
+  }
+  std::stringstream ss(list);
+  std::string name;
+  while (std::getline(ss, name, ',')) {
+    auto it = std::find_if(registry.begin(), registry.end(),
+                           [&](const NamedFocusMetric& m) { return m.name == name; });
+    if (it == registry.end()) {
+      std::cerr << "ERROR: Unknown metric: " << name << std::endl;
+      return false;
+    }
+    selected.push_back(*it);
+  }
+  return !selected.empty();
+}
@@ -7,16 +7,25 @@
  *  2. Opens a resizable window where the user can click on blemishes.
  *  3. For each click, selects an optimal source patch based on minimal texture variance.
  *  4. Applies seamless cloning to remove the blemish in-place.
- *  5. Allows the user to press 'C' to reset the image or 'Esc' to exit.
+ *  5. Allows the user to press 'Z'/'Y' to undo/redo, 'C' to reset the image or 'Esc' to exit.
+ *
+ * Every edit is confined to a small rectangle around the click: the clone, the texture-index
+ * refresh, the undo record (the touched kTileSize tiles only) and the redraw of the downscaled
+ * preview, so click latency does not grow with the image size.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
+#include <deque>
 #include <filesystem>
 #include <iostream>
-#include <limits>
 #include <opencv2/opencv.hpp>
+#include <vector>
 
 #include "config.pch"
+#include "portfolio/image_io.hpp"
+#include "portfolio/texture_energy_index.hpp"
 
 //--------------------------------------------------------------------------------------
 // Configuration constants
@@ -28,58 +37,72 @@ static const std::string kOutputRelative = "../data/result.png";  ///< Relative
 static const std::string kWindowName = "Blemish Removal";  ///< Name of the interactive window
 static constexpr int kDefaultRad = 20;                     ///< Radius of blemish removal patch
 
-// Global image used by the mouse callback
+static constexpr double kEnergyScale = 1.0 / (255.0 * 3 * 2);  ///< Laplacian normalization
+static constexpr int kCloneMargin = 2;      ///< Destination ring kept around each clone
+static constexpr int kTileSize = 128;       ///< Granularity of undo records and reset
+static constexpr size_t kMaxUndo = 200;     ///< Oldest edits are forgotten beyond this
+static const cv::Size kMaxPreview = {1600, 1200};  ///< Preview is downscaled to fit this
+
+/// Pixels of one tile before and after an edit.
+struct TileEdit {
+  cv::Rect rect;
+  cv::Mat before;
+  cv::Mat after;
+};
+using EditRecord = std::vector<TileEdit>;
+
+// Global image used by the mouse callback, with its V channel and texture-energy index
 static cv::Mat g_sourceImage;
+static cv::Mat g_valuePlane;
+static portfolio::TextureEnergyIndex g_energy;
+
+// Editing state: pristine image, undo/redo stacks, tiles differing from the original
+static cv::Mat g_original;
+static std::deque<EditRecord> g_undo;
+static std::vector<EditRecord> g_redo;
+static std::vector<unsigned char> g_modifiedTiles;
+
+// Downscaled preview shown in the window, refreshed only where the image changed
+static cv::Mat g_preview;
+static double g_previewScale = 1.0;
+static bool g_needsRedraw = true;
 
 /**
- * @brief Loads an image from disk, exiting on failure.
- * @param path      Full filesystem path to the image.
- * @param flags     OpenCV imread flags (default: IMREAD_UNCHANGED).
- * @return          Loaded cv::Mat.
+ * @brief Writes the HSV value channel, max(B, G, R), of @p bgr into @p value.
+ * @param bgr       BGR image (or ROI).
+ * @param value     Preallocated 8-bit plane (or ROI) of the same size, written in place.
  */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-    std::cerr << "ERROR: Could not load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return img;
+void computeValuePlane(const cv::Mat& bgr, cv::Mat& value) {
+  cv::Mat channels[3];
+  cv::split(bgr, channels);
+  cv::max(channels[0], channels[1], value);
+  cv::max(value, channels[2], value);
 }
 
 /**
- * @brief Saves an image to disk, exiting on failure.
- * @param path Full path where the image will be written.
- * @param image The cv::Mat image to save.
- * @param params Optional imwrite parameters (e.g., compression level).
+ * @brief Rebuilds the value plane and its texture-energy index from g_sourceImage.
  */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Failed to save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
+void rebuildEnergyIndex() {
+  g_valuePlane.create(g_sourceImage.size(), CV_8U);
+  computeValuePlane(g_sourceImage, g_valuePlane);
+  g_energy.build(g_valuePlane, kEnergyScale);
 }
 
 /**
- * @brief Computes the sum of squared Laplacian responses (texture variance) in a patch.
- * @param patch     Input image patch (BGR color).
- * @return          Scalar variance measure.
+ * @brief Refreshes the value plane and the energy index after @p dirty changed.
  */
-double computePatchVariance(const cv::Mat& patch) {
-  cv::Mat hsv, lap, lap2;
-  std::vector<cv::Mat> channels;
-  cv::cvtColor(patch, hsv, cv::COLOR_BGR2HSV);
-  cv::split(hsv, channels);
-
-  // Compute Laplacian on V channel to estimate texture
-  cv::Laplacian(channels[2], lap, CV_32F, 3, 1.0 / (255.0 * 3 * 2), 0, cv::BORDER_DEFAULT);
-  cv::pow(lap, 2.0, lap2);
-
-  return cv::sum(lap2)[0];
+void updateEnergyIndex(const cv::Rect& dirty) {
+  cv::Mat value = g_valuePlane(dirty);
+  computeValuePlane(g_sourceImage(dirty), value);
+  g_energy.update(g_valuePlane, dirty);
 }
 
 /**
  * @brief Finds a nearby source patch with the lowest texture variance.
+ *
+ * Candidates have their centre on rings from 2·radius to 4·radius around the blemish, about
+ * radius/2 apart; each costs a few lookups in the texture-energy index of the V channel.
+ *
  * @param image     The full source image.
  * @param center    Center point of the blemish to remove.
  * @param radius    Radius of the blemish patch.
@@ -87,54 +110,178 @@ double computePatchVariance(const cv::Mat& patch) {
  */
 cv::Mat selectBestPatch(const cv::Mat& image, const cv::Point& center, int radius) {
   const int diameter = radius * 2 + 1;
-  cv::Mat bestPatch;
-  double minVariance = std::numeric_limits<double>::infinity();
+  const cv::Rect best = g_energy.lowestEnergyPatch(center, {diameter, diameter}, 2 * radius,
+                                                   4 * radius, std::max(1, radius / 2));
+  return best.empty() ? cv::Mat() : image(best).clone();
+}
 
-  // Eight compass directions (unit vectors)
-  static const std::vector<cv::Point2d> kDirs = {
-      {1, 0},  {0.7071, 0.7071},   {0, 1},  {-0.7071, 0.7071},
-      {-1, 0}, {-0.7071, -0.7071}, {0, -1}, {0.7071, -0.7071}};
+/**
+ * @brief Rectangles of the kTileSize grid tiles intersecting @p rect.
+ */
+std::vector<cv::Rect> tilesCovering(const cv::Rect& rect) {
+  std::vector<cv::Rect> tiles;
+  const cv::Rect bounds(0, 0, g_sourceImage.cols, g_sourceImage.rows);
+  const cv::Rect r = rect & bounds;
+  if (r.empty()) return tiles;
+  for (int ty = r.y / kTileSize; ty <= (r.br().y - 1) / kTileSize; ++ty)
+    for (int tx = r.x / kTileSize; tx <= (r.br().x - 1) / kTileSize; ++tx)
+      tiles.push_back(cv::Rect(tx * kTileSize, ty * kTileSize, kTileSize, kTileSize) & bounds);
+  return tiles;
+}
 
-  for (const auto& d : kDirs) {
-    cv::Point srcCenter{static_cast<int>(center.x + d.x * radius * 2),
-                        static_cast<int>(center.y + d.y * radius * 2)};
+/**
+ * @brief Rebuilds the preview pixels showing the image region @p dirty.
+ *
+ * The preview rectangle is rounded outwards and resampled from the matching source region, so
+ * a redraw costs the size of the edit rather than of the image.
+ */
+void updatePreview(const cv::Rect& dirty) {
+  if (g_previewScale == 1.0) {
+    g_sourceImage(dirty).copyTo(g_preview(dirty));
+  } else {
+    const cv::Rect previewBounds(0, 0, g_preview.cols, g_preview.rows);
+    const int x0 = static_cast<int>(dirty.x * g_previewScale);
+    const int y0 = static_cast<int>(dirty.y * g_previewScale);
+    const int x1 = static_cast<int>(std::ceil(dirty.br().x * g_previewScale));
+    const int y1 = static_cast<int>(std::ceil(dirty.br().y * g_previewScale));
+    const cv::Rect dst = cv::Rect(x0, y0, x1 - x0, y1 - y0) & previewBounds;
+    if (dst.empty()) return;
+    const cv::Rect bounds(0, 0, g_sourceImage.cols, g_sourceImage.rows);
+    const int sx0 = cvFloor(dst.x / g_previewScale), sy0 = cvFloor(dst.y / g_previewScale);
+    const cv::Rect src = cv::Rect(sx0, sy0, cvCeil(dst.br().x / g_previewScale) - sx0,
+                                  cvCeil(dst.br().y / g_previewScale) - sy0) &
+                         bounds;
+    cv::Mat out = g_preview(dst);
+    cv::resize(g_sourceImage(src), out, dst.size(), 0, 0, cv::INTER_AREA);
+  }
+  g_needsRedraw = true;
+}
 
-    // Define patch bounds
-    int x0 = srcCenter.x - radius;
-    int y0 = srcCenter.y - radius;
-    int x1 = srcCenter.x + radius + 1;
-    int y1 = srcCenter.y + radius + 1;
+/**
+ * @brief Rebuilds the full-size preview; used when an image is (re)loaded.
+ */
+void rebuildPreview() {
+  g_previewScale = std::min({1.0, static_cast<double>(kMaxPreview.width) / g_sourceImage.cols,
+                             static_cast<double>(kMaxPreview.height) / g_sourceImage.rows});
+  if (g_previewScale == 1.0) {
+    g_preview = g_sourceImage.clone();
+  } else {
+    cv::resize(g_sourceImage, g_preview, cv::Size(), g_previewScale, g_previewScale,
+               cv::INTER_AREA);
+  }
+  g_needsRedraw = true;
+}
 
-    // Skip if patch out of bounds
-    if (x0 < 0 || y0 < 0 || x1 > image.cols || y1 > image.rows) continue;
+/**
+ * @brief Propagates a change of @p dirty to the texture index, the tile flags and the preview.
+ */
+void refreshRegion(const cv::Rect& dirty) {
+  updateEnergyIndex(dirty);
+  const int tilesX = (g_sourceImage.cols + kTileSize - 1) / kTileSize;
+  for (const auto& tile : tilesCovering(dirty)) {
+    g_modifiedTiles[(tile.y / kTileSize) * tilesX + tile.x / kTileSize] =
+        cv::norm(g_sourceImage(tile), g_original(tile), cv::NORM_INF) > 0;
+  }
+  updatePreview(dirty);
+}
 
-    cv::Mat patch = image(cv::Range(y0, y1), cv::Range(x0, x1));
-    double var = computePatchVariance(patch);
+/**
+ * @brief Snapshots the tiles intersecting @p rect before they are edited.
+ */
+EditRecord beginEdit(const cv::Rect& rect) {
+  EditRecord record;
+  for (const auto& tile : tilesCovering(rect)) {
+    record.push_back({tile, g_sourceImage(tile).clone(), cv::Mat()});
+  }
+  return record;
+}
 
-    if (var < minVariance) {
-      minVariance = var;
-      bestPatch = patch.clone();
-    }
+/**
+ * @brief Captures the edited tiles, pushes @p record on the undo stack and refreshes @p dirty.
+ */
+void commitEdit(EditRecord record, const cv::Rect& dirty) {
+  for (auto& t : record) t.after = g_sourceImage(t.rect).clone();
+  g_undo.push_back(std::move(record));
+  if (g_undo.size() > kMaxUndo) g_undo.pop_front();
+  g_redo.clear();
+  refreshRegion(dirty);
+}
+
+/**
+ * @brief Writes the before (undo) or after (redo) pixels of every tile of @p record.
+ */
+void applyRecord(const EditRecord& record, bool after) {
+  for (const auto& t : record) {
+    (after ? t.after : t.before).copyTo(g_sourceImage(t.rect));
+    refreshRegion(t.rect);
   }
+}
+
+void undoEdit() {
+  if (g_undo.empty()) return;
+  applyRecord(g_undo.back(), false);
+  g_redo.push_back(std::move(g_undo.back()));
+  g_undo.pop_back();
+}
 
-  return bestPatch;
+void redoEdit() {
+  if (g_redo.empty()) return;
+  applyRecord(g_redo.back(), true);
+  g_undo.push_back(std::move(g_redo.back()));
+  g_redo.pop_back();
+}
+
+/**
+ * @brief Restores the original pixels of the modified tiles only, as an undoable edit.
+ */
+void resetImage() {
+  const int tilesX = (g_sourceImage.cols + kTileSize - 1) / kTileSize;
+  EditRecord record;
+  for (size_t i = 0; i < g_modifiedTiles.size(); ++i) {
+    if (!g_modifiedTiles[i]) continue;
+    const int tx = static_cast<int>(i) % tilesX, ty = static_cast<int>(i) / tilesX;
+    const cv::Rect tile = cv::Rect(tx * kTileSize, ty * kTileSize, kTileSize, kTileSize) &
+                          cv::Rect(0, 0, g_sourceImage.cols, g_sourceImage.rows);
+    record.push_back({tile, g_sourceImage(tile).clone(), g_original(tile).clone()});
+  }
+  if (record.empty()) return;
+  applyRecord(record, true);
+  g_undo.push_back(std::move(record));
+  if (g_undo.size() > kMaxUndo) g_undo.pop_front();
+  g_redo.clear();
 }
 
 /**
  * @brief Mouse event callback: performs seamless cloning on left-click.
+ *
+ * The click arrives in preview coordinates and is mapped back to the full-resolution image.
+ * The Poisson solve runs on the clone rectangle plus kCloneMargin only.
  */
 void onMouse(int event, int x, int y, int /*flags*/, void* /*userdata*/) {
   if (event != cv::EVENT_LBUTTONDOWN) return;
 
-  cv::Point center{x, y};
+  cv::Point center{cvRound(x / g_previewScale), cvRound(y / g_previewScale)};
   cv::Mat patch = selectBestPatch(g_sourceImage, center, kDefaultRad);
   if (patch.empty()) return;
 
+  const cv::Rect bounds(0, 0, g_sourceImage.cols, g_sourceImage.rows);
+  const cv::Rect cloneRect(center - cv::Point(kDefaultRad, kDefaultRad), patch.size());
+  if ((cloneRect & bounds) != cloneRect) return;  // seamlessClone needs the full patch inside
+  const cv::Rect roi = cv::Rect(cloneRect.x - kCloneMargin, cloneRect.y - kCloneMargin,
+                                cloneRect.width + 2 * kCloneMargin,
+                                cloneRect.height + 2 * kCloneMargin) &
+                       bounds;
+
   // Prepare binary mask for seamlessClone
   cv::Mat mask = cv::Mat::zeros(patch.size(), CV_8UC1);
   cv::circle(mask, cv::Point(kDefaultRad, kDefaultRad), kDefaultRad, cv::Scalar(255), cv::FILLED);
 
-  cv::seamlessClone(patch, g_sourceImage, mask, center, g_sourceImage, cv::NORMAL_CLONE);
+  EditRecord record = beginEdit(roi);
+  cv::Mat dst = g_sourceImage(roi);
+  cv::Mat blended;
+  cv::seamlessClone(patch, dst, mask, center - roi.tl(), blended, cv::NORMAL_CLONE);
+  blended.copyTo(dst);
+  commitEdit(std::move(record), roi);
 }
 
 /**
@@ -143,24 +290,33 @@ void onMouse(int event, int x, int y, int /*flags*/, void* /*userdata*/) {
  */
 void runBlemishRemoval(cv::Mat image) {
   g_sourceImage = image.clone();
+  g_original = image.clone();
+  const int tilesX = (image.cols + kTileSize - 1) / kTileSize;
+  const int tilesY = (image.rows + kTileSize - 1) / kTileSize;
+  g_modifiedTiles.assign(static_cast<size_t>(tilesX) * tilesY, 0);
+  rebuildEnergyIndex();
+  rebuildPreview();
   cv::namedWindow(kWindowName, cv::WINDOW_NORMAL);
   cv::resizeWindow(kWindowName, 1200, 900);
   cv::setMouseCallback(kWindowName, onMouse);
 
   std::cout << "Instructions:\n"
             << " - Left-click to remove blemish.\n"
+            << " - Press 'Z' to undo, 'Y' to redo.\n"
             << " - Press 'C' to reset image.\n"
             << " - Press 'Esc' to exit.\n";
 
-  cv::Mat original = image.clone();
   while (true) {
-    cv::imshow(kWindowName, g_sourceImage);
+    if (g_needsRedraw) {
+      cv::imshow(kWindowName, g_preview);
+      g_needsRedraw = false;
+    }
     int key = cv::waitKey(20) & 0xFF;
     if (key == 27)  // Esc
       break;
-    if (key == 'c' || key == 'C') {
-      original.copyTo(g_sourceImage);
-    }
+    if (key == 'c' || key == 'C') resetImage();
+    if (key == 'z' || key == 'Z') undoEdit();
+    if (key == 'y' || key == 'Y') redoEdit();
   }
   cv::destroyAllWindows();
 }
@@ -168,12 +324,12 @@ void runBlemishRemoval(cv::Mat image) {
 int main() {
   // Construct full path and load image
   std::filesystem::path inputImagePath = std::filesystem::path{kDataDir} / kInputRelative;
-  cv::Mat input = loadImageOrExit(inputImagePath, cv::IMREAD_COLOR);
+  cv::Mat input = portfolio::loadImageOrExit(inputImagePath, cv::IMREAD_COLOR);
 
   runBlemishRemoval(input);
 
   // Save image
   std::filesystem::path outputImagePath = std::filesystem::path{kDataDir} / kOutputRelative;
-  saveImageOrExit(outputImagePath, g_sourceImage);
+  portfolio::saveImageOrExit(outputImagePath, g_sourceImage);
   return EXIT_SUCCESS;
 }
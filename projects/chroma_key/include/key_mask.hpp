@@ -0,0 +1,68 @@
+/**
+ * @file key_mask.hpp
+ * @brief Chroma key masks: the HSV reference path and its BGR lookup-table equivalent, shared by
+ * chroma_key and portfolio_bench.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <opencv2/core.hpp>
+#include <vector>
+
+/**
+ * @brief Computes the HSV inRange bounds that select pixels close to the key color.
+ * @param keyBGR     Sampled key color in BGR.
+ * @param tolerance  Tolerance [%] for the color selection.
+ * @param lower      Output lower HSV bound.
+ * @param upper      Output upper HSV bound.
+ */
+void computeKeyRange(const cv::Vec3b& keyBGR, int tolerance, cv::Scalar& lower,
+                     cv::Scalar& upper);
+
+/**
+ * @brief Genera una máscara binaria donde los píxeles cercanos al color clave son blancos.
+ *
+ * The HSV copy of the frame lives in a per-thread pooled buffer, so repeated calls on frames of
+ * the same size do not allocate it again.
+ *
+ * @param frame      Fotograma BGR de entrada.
+ * @param keyBGR     Color clave muestreado en BGR.
+ * @param tolerance  Tolerancia [%] para la selección del color.
+ * @return           Máscara de un solo canal (CV_8U).
+ */
+cv::Mat createKeyMask(const cv::Mat& frame, const cv::Vec3b& keyBGR, int tolerance);
+
+/**
+ * @brief BGR → keep/drop lookup table equivalent to createKeyMask().
+ *
+ * Stores one bit per 24‐bit BGR color (2 MiB), set when the color falls inside the HSV key
+ * range. The table is rebuilt only when the key color or tolerance change, so per‐frame mask
+ * generation is a single lookup per pixel with no HSV conversion.
+ */
+class KeyColorTable {
+ public:
+  /**
+   * @brief Rebuilds the table if the key parameters differ from the last build.
+   * @param keyBGR     Sampled key color in BGR.
+   * @param tolerance  Tolerance [%] for the color selection.
+   * @return           True if the table was rebuilt.
+   */
+  bool update(const cv::Vec3b& keyBGR, int tolerance);
+
+  /**
+   * @brief Generates the key mask for a frame by table lookup.
+   * @param frame  BGR frame (CV_8UC3).
+   * @return       Single‐channel mask (CV_8U), 255 where the color matches the key.
+   */
+  cv::Mat createMask(const cv::Mat& frame) const;
+
+ private:
+  static constexpr std::size_t kWords = (std::size_t{1} << 24) / 64;
+
+  std::vector<std::uint64_t> bits_;
+  cv::Vec3b key_;
+  int tolerance_ = 0;
+  bool built_ = false;
+};
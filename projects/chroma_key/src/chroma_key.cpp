@@ -10,15 +10,35 @@
  *  4. Generates a binary key mask in HSV space, softens it, corrects green spill, and composites
  * the subject over a background.
  *  5. Displays the result in real time and loops the video when it ends.
+ *
+ * Decoding, keying and display run as separate pipeline stages (see runChromaKey()).
+ *
+ * Per-frame key masks come from a BGR lookup table (KeyColorTable) that is rebuilt only when the
+ * key color or tolerance change, on a background thread during playback. The "Fused" trackbar
+ * switches the spill correction and soft blend to a single fixed-point pass over the interleaved
+ * 8-bit frame (see compositeFused()).
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "config.pch"
+#include "key_mask.hpp"
+#include "portfolio/bounded_queue.hpp"
 
 //----------------------------------------------------------------------------------
 // Constants & Globals
@@ -36,6 +56,8 @@ int g_tolerance = 0;  ///< Key color tolerance [%]
 int g_softness = 0;   ///< Mask softness radius factor
 int g_colorCast = 0;  ///< Green‐spill correction strength [%]
 int g_seamless = 0;   ///< Use seamlessClone (1) or simple overlay (0)
+int g_fused = 0;      ///< Use the fused 8-bit compositor (1) or the reference float path (0)
+int g_seamlessLevel = 2;  ///< Pyramid level of the seamless solve (0 = exact full resolution)
 
 cv::Mat g_currentFrame;  ///< Last captured frame for mouse sampling
 
@@ -83,45 +105,17 @@ void onTrackbar(int value, void* userdata) { *static_cast<int*>(userdata) = valu
 //--------------------------------------------------------------------------------------
 
 /**
- * @brief Genera una máscara binaria donde los píxeles cercanos al color clave son blancos.
- * @param frame      Fotograma BGR de entrada.
- * @param keyBGR     Color clave muestreado en BGR.
- * @param tolerance  Tolerancia [%] para la selección del color.
- * @return           Máscara de un solo canal (CV_8U).
+ * @brief Converts a hard mask into a soft 8-bit mask (255 = foreground).
+ * @param maskHard   8‐bit single‐channel binary mask.
+ * @param softness   Softness factor (kernel radius = 2*softness+1).
+ * @return           8‐bit single‐channel mask [0..255].
  */
-cv::Mat createKeyMask(const cv::Mat& frame, const cv::Vec3b& keyBGR, int tolerance) {
-  // Convertir el color clave BGR → HSV
-  cv::Mat keyPix(1, 1, CV_8UC3, keyBGR);
-  cv::cvtColor(keyPix, keyPix, cv::COLOR_BGR2HSV);
-  cv::Vec3b keyHSV = keyPix.at<cv::Vec3b>(0, 0);
-
-  // Convertir fotograma a HSV
-  cv::Mat hsv;
-  cv::cvtColor(frame, hsv, cv::COLOR_BGR2HSV);
-
-  // Calc. de deltas en HSV según tolerancia
-  double tol = tolerance / 100.0;
-  int hDelta = static_cast<int>(180 * tol);
-  int sDelta = static_cast<int>(255 * tol);
-  int vDelta = static_cast<int>(255 * tol);
-
-  // Calcular límites inferior y superior, primero en int
-  int hLower = std::clamp<int>(static_cast<int>(keyHSV[0]) - hDelta, 0, 180);
-  int sLower = std::clamp<int>(static_cast<int>(keyHSV[1]) - sDelta, 0, 255);
-  int vLower = std::clamp<int>(static_cast<int>(keyHSV[2]) - vDelta, 0, 255);
-
-  int hUpper = std::clamp<int>(static_cast<int>(keyHSV[0]) + hDelta, 0, 180);
-  int sUpper = std::clamp<int>(static_cast<int>(keyHSV[1]) + sDelta, 0, 255);
-  int vUpper = std::clamp<int>(static_cast<int>(keyHSV[2]) + vDelta, 0, 255);
-
-  // Ahora construir cv::Scalar con paréntesis (evita warnings de lista inicializada)
-  cv::Scalar lower(hLower, sLower, vLower);
-  cv::Scalar upper(hUpper, sUpper, vUpper);
-
-  // Generar máscara
-  cv::Mat mask;
-  cv::inRange(hsv, lower, upper, mask);
-  return mask;
+cv::Mat softenMask8U(const cv::Mat& maskHard, int softness) {
+  int ksize = 2 * softness + 1;
+  cv::Mat inverted;
+  cv::bitwise_not(maskHard, inverted);
+  cv::GaussianBlur(inverted, inverted, cv::Size(ksize, ksize), 0);
+  return inverted;
 }
 
 /**
@@ -131,29 +125,11 @@ cv::Mat createKeyMask(const cv::Mat& frame, const cv::Vec3b& keyBGR, int toleran
  * @return           32‐bit single‐channel mask [0..1].
  */
 cv::Mat softenMask(const cv::Mat& maskHard, int softness) {
-  int ksize = 2 * softness + 1;
-  cv::Mat inverted;
-  cv::bitwise_not(maskHard, inverted);
-  cv::GaussianBlur(inverted, inverted, cv::Size(ksize, ksize), 0);
   cv::Mat maskFloat;
-  inverted.convertTo(maskFloat, CV_32F, 1.0 / 255.0);
+  softenMask8U(maskHard, softness).convertTo(maskFloat, CV_32F, 1.0 / 255.0);
   return maskFloat;
 }
 
-/**
- * @brief Saves an image to disk, exiting on failure.
- * @param path Full path where the image will be written.
- * @param image The cv::Mat image to save.
- * @param params Optional imwrite parameters (e.g., compression level).
- */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Failed to save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-}
-
 /**
  * @brief Attenuates green spill based on the soft mask.
  * @param frame         Original BGR frame.
@@ -233,17 +209,430 @@ cv::Mat compositeFrame(const cv::Mat& fg, const cv::Mat& maskSoft, const cv::Mat
   }
 }
 
+/**
+ * @brief Computes where seamlessClone() places the masked region.
+ *
+ * seamlessClone() first zeroes the mask's 1‐px border, then copies the bounding box of the
+ * remaining non‐zero pixels so that the box is centered on @p center. The border of @p mask8 is
+ * cleared the same way, so a mask touching the frame edge yields the box seamlessClone() uses
+ * and the caller pastes through the mask it actually applies.
+ *
+ * @param mask8    8‐bit mask (non‐zero = foreground); its border is set to 0.
+ * @param center   Destination center passed to seamlessClone().
+ * @param srcRect  Receives the bounding box in the source image (empty if nothing is left).
+ * @param dstRect  Receives the corresponding box in the destination image.
+ */
+void clonePlacement(cv::Mat& mask8, cv::Point center, cv::Rect& srcRect, cv::Rect& dstRect) {
+  cv::rectangle(mask8, cv::Rect(cv::Point(), mask8.size()), cv::Scalar(0), 1);
+  srcRect = cv::boundingRect(mask8);
+  dstRect = cv::Rect(center.x - srcRect.width / 2, center.y - srcRect.height / 2, srcRect.width,
+                     srcRect.height);
+}
+
+/**
+ * @brief Approximates the seamlessClone branch of compositeFrame() at a fraction of its cost.
+ *
+ * A Poisson clone equals the pasted foreground plus a smooth correction field that cancels the
+ * seam. The clone is solved on a copy downscaled by 2^level, the correction (clone − paste) is
+ * upsampled and added to a full‐resolution paste. Solve time drops by roughly 4^level, while
+ * foreground detail stays at full resolution; only the low‐frequency correction is approximate.
+ *
+ * @param fg        Foreground BGR image (green‐spill corrected).
+ * @param maskSoft  Soft mask [0..1].
+ * @param bg        Background BGR image (same size as fg).
+ * @param level     Quality/latency knob: 0 = exact solve, each step halves the solve resolution.
+ * @return          Composited BGR image.
+ */
+cv::Mat compositeSeamlessApprox(const cv::Mat& fg, const cv::Mat& maskSoft, const cv::Mat& bg,
+                                int level) {
+  if (level <= 0) return compositeFrame(fg, maskSoft, bg, true);
+
+  cv::Mat mask8;
+  maskSoft.convertTo(mask8, CV_8U, 255.0);
+
+  // Poisson solve on the reduced level
+  const double scale = 1.0 / (1 << level);
+  cv::Mat fgLo, bgLo, maskLo;
+  cv::resize(fg, fgLo, cv::Size(), scale, scale, cv::INTER_AREA);
+  cv::resize(bg, bgLo, fgLo.size(), 0, 0, cv::INTER_AREA);
+  cv::resize(mask8, maskLo, fgLo.size(), 0, 0, cv::INTER_AREA);
+  const cv::Point centerLo(bgLo.cols / 2, bgLo.rows / 2);
+  cv::Rect srcLo, dstLo;
+  clonePlacement(maskLo, centerLo, srcLo, dstLo);
+  if (srcLo.empty()) return bg.clone();
+
+  cv::Mat cloneLo;
+  cv::seamlessClone(fgLo, bgLo, maskLo, centerLo, cloneLo, cv::NORMAL_CLONE);
+
+  // Correction field = clone − plain paste, over the destination box
+  cv::Mat correctionLo;
+  cv::subtract(cloneLo(dstLo), fgLo(srcLo), correctionLo, cv::noArray(), CV_16S);
+
+  // Upsample the correction and apply it to the full-resolution paste
+  cv::Rect src, dst;
+  clonePlacement(mask8, cv::Point(bg.cols / 2, bg.rows / 2), src, dst);
+  if (src.empty()) return bg.clone();
+  cv::Mat correction;
+  cv::resize(correctionLo, correction, dst.size(), 0, 0, cv::INTER_LINEAR);
+  cv::Mat pasted;
+  cv::add(fg(src), correction, pasted, cv::noArray(), CV_8U);
+
+  cv::Mat output = bg.clone();
+  pasted.copyTo(output(dst), mask8(src));
+  return output;
+}
+
+/**
+ * @brief Fused spill correction + soft blend over interleaved 8‐bit BGR rows.
+ *
+ * Computes the same image as correctGreenSpill() followed by the simple‐blend branch of
+ * compositeFrame() (within ±1 LSB) without any float frame, channel split or merge. All the
+ * arithmetic is done in integers scaled by 255·255·200, so the only rounding steps are the two
+ * conversions back to 8 bits that the reference path also performs. Rows are processed in
+ * parallel stripes.
+ *
+ * @param frame         Original BGR frame (CV_8UC3).
+ * @param maskSoft8     Soft mask from softenMask8U() (CV_8U, 255 = foreground).
+ * @param bg            Background BGR image (same size as frame).
+ * @param colorCastPct  Green‐spill correction strength [%].
+ * @return              Composited BGR image.
+ */
+cv::Mat compositeFused(const cv::Mat& frame, const cv::Mat& maskSoft8, const cv::Mat& bg,
+                       int colorCastPct) {
+  CV_Assert(frame.type() == CV_8UC3 && bg.type() == CV_8UC3 && maskSoft8.type() == CV_8UC1);
+  CV_Assert(frame.size() == bg.size() && frame.size() == maskSoft8.size());
+
+  // One unit of the fixed-point foreground is 1 / (255 * 255 * 200): pixel * mask gives the
+  // 255 * 255 factor, the extra 200 keeps k * spill and k * spill / 2 integral for k in 1/100.
+  constexpr int kFgOne = 255 * 200;  // fixed-point value of one 8-bit step
+  const int cast = colorCastPct;
+
+  cv::Mat out(frame.size(), CV_8UC3);
+  cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+    for (int y = rows.start; y < rows.end; ++y) {
+      const uchar* f = frame.ptr<uchar>(y);
+      const uchar* b = bg.ptr<uchar>(y);
+      const uchar* m = maskSoft8.ptr<uchar>(y);
+      uchar* o = out.ptr<uchar>(y);
+      for (int x = 0; x < frame.cols; ++x, f += 3, b += 3, o += 3) {
+        const int a = m[x];
+        // Premultiplied foreground (correctGreenSpill multiplies every channel by the mask)
+        const int pb = f[0] * a, pg = f[1] * a, pr = f[2] * a;
+        const int spill = std::max(pg - std::max(pb, pr), 0);
+
+        // G -= k*spill (clamped to [0,1]); B,R += k*spill/2
+        const int gFix = std::clamp(200 * pg - 2 * spill * cast, 0, 255 * kFgOne);
+        const int bFix = 200 * pb + spill * cast;
+        const int rFix = 200 * pr + spill * cast;
+
+        // Back to 8 bits as convertTo(CV_8U, 255) would
+        const int fgB = std::min((bFix + kFgOne / 2) / kFgOne, 255);
+        const int fgG = (gFix + kFgOne / 2) / kFgOne;
+        const int fgR = std::min((rFix + kFgOne / 2) / kFgOne, 255);
+
+        // out = bg * (1 - m) + fg * m
+        const int ia = 255 - a;
+        o[0] = static_cast<uchar>((b[0] * ia + fgB * a + 127) / 255);
+        o[1] = static_cast<uchar>((b[1] * ia + fgG * a + 127) / 255);
+        o[2] = static_cast<uchar>((b[2] * ia + fgR * a + 127) / 255);
+      }
+    }
+  });
+  return out;
+}
+
+//--------------------------------------------------------------------------------------
+// Pipeline stages
+//--------------------------------------------------------------------------------------
+
+constexpr std::size_t kQueueCapacity = 4;  ///< Frames buffered between consecutive stages
+constexpr int kMaxWorkers = 4;             ///< Upper bound for the keying worker pool
+constexpr std::chrono::milliseconds kSnapshotInterval{1000};  ///< Min. time between snapshots
+constexpr std::chrono::seconds kStatsInterval{5};             ///< Pipeline report period
+
+/**
+ * @brief Parameters used to key one frame.
+ *
+ * The presenter (UI thread) snapshots the trackbar globals into this struct after every
+ * waitKey(), so worker threads never read values that HighGUI is writing.
+ */
+struct KeyParams {
+  cv::Vec3b keyBGR;
+  int tolerance = 0;
+  int softness = 0;
+  int colorCast = 0;
+  bool seamless = false;
+  bool fused = false;
+  int seamlessLevel = 0;  ///< See compositeSeamlessApprox()
+  /// Lookup table for keyBGR / tolerance; during playback it may lag a slider change briefly
+  std::shared_ptr<const KeyColorTable> table;
+};
+
+/**
+ * @brief Builds KeyColorTable instances on a background thread.
+ *
+ * A rebuild costs a 16M-colour conversion, far more than one frame period, so the presenter only
+ * posts the wanted key and picks the table up once it is ready. Requests posted while a build
+ * is running replace each other; only the latest one is built next.
+ */
+class AsyncKeyTableBuilder {
+ public:
+  AsyncKeyTableBuilder() : thread_([this] { run(); }) {}
+
+  ~AsyncKeyTableBuilder() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  /// Requests a table for @p key / @p tolerance, dropping any request not started yet.
+  void request(cv::Vec3b key, int tolerance) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pendingKey_ = key;
+      pendingTolerance_ = tolerance;
+      hasPending_ = true;
+    }
+    wake_.notify_one();
+  }
+
+  /// Returns the last table finished since the previous call, or nullptr.
+  std::shared_ptr<const KeyColorTable> takeReady() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return std::move(ready_);
+  }
+
+ private:
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] { return stop_ || hasPending_; });
+      if (stop_) break;
+      const cv::Vec3b key = pendingKey_;
+      const int tolerance = pendingTolerance_;
+      hasPending_ = false;
+      lock.unlock();
+      auto table = std::make_shared<KeyColorTable>();
+      table->update(key, tolerance);
+      lock.lock();
+      ready_ = std::move(table);
+    }
+  }
+
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  cv::Vec3b pendingKey_;
+  int pendingTolerance_ = 0;
+  bool hasPending_ = false;
+  std::shared_ptr<const KeyColorTable> ready_;
+  bool stop_ = false;
+  std::thread thread_;  ///< Started last, once every other member is initialised
+};
+
+/**
+ * @brief Reads the trackbar globals, rebuilding the lookup table only if the key changed.
+ *
+ * With a @p builder the rebuild runs in the background: the previous table stays in use until
+ * the new one is ready, so dragging a slider never stalls the presenter. Without one (or when
+ * there is no table yet) the table is built synchronously.
+ *
+ * @param previous  Parameters currently in use (its table is reused when still valid).
+ * @param builder   Optional background table builder.
+ * @return          Up-to-date parameters.
+ */
+KeyParams readTrackbarParams(const KeyParams& previous, AsyncKeyTableBuilder* builder = nullptr) {
+  KeyParams params = previous;
+  params.keyBGR = {static_cast<uchar>(g_keyB), static_cast<uchar>(g_keyG),
+                   static_cast<uchar>(g_keyR)};
+  params.tolerance = g_tolerance;
+  params.softness = g_softness;
+  params.colorCast = g_colorCast;
+  params.seamless = g_seamless != 0;
+  params.fused = g_fused != 0;
+  params.seamlessLevel = g_seamlessLevel;
+  const bool keyChanged =
+      params.keyBGR != previous.keyBGR || params.tolerance != previous.tolerance;
+  if (!params.table || (keyChanged && !builder)) {
+    auto table = std::make_shared<KeyColorTable>();
+    table->update(params.keyBGR, params.tolerance);
+    params.table = std::move(table);
+  } else if (keyChanged) {
+    builder->request(params.keyBGR, params.tolerance);
+  }
+  if (builder) {
+    if (auto ready = builder->takeReady()) params.table = std::move(ready);
+  }
+  return params;
+}
+
+/**
+ * @brief Thread-safe holder for the parameters published by the presenter.
+ */
+class SharedKeyParams {
+ public:
+  void set(KeyParams params) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    params_ = std::move(params);
+  }
+
+  KeyParams get() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return params_;
+  }
+
+ private:
+  mutable std::mutex mutex_;
+  KeyParams params_;
+};
+
+/**
+ * @brief Runs the full keying pipeline on one frame.
+ * @param frame   Green‐screen BGR frame.
+ * @param bg      Background BGR image (same size as frame), only read.
+ * @param params  Key parameters and lookup table to use.
+ * @return        Composited BGR image.
+ */
+cv::Mat processFrame(const cv::Mat& frame, const cv::Mat& bg, const KeyParams& params) {
+  cv::Mat keyMask = params.table->createMask(frame);
+  if (params.fused && !params.seamless) {
+    return compositeFused(frame, softenMask8U(keyMask, params.softness), bg, params.colorCast);
+  }
+  cv::Mat softMask = softenMask(keyMask, params.softness);
+  cv::Mat fgCorrect = correctGreenSpill(frame, softMask, params.colorCast);
+  if (params.seamless) {
+    return compositeSeamlessApprox(fgCorrect, softMask, bg, params.seamlessLevel);
+  }
+  return compositeFrame(fgCorrect, softMask, bg, false);
+}
+
+/**
+ * @brief Writes the latest composite to disk from a background thread, rate limited.
+ *
+ * submit() only hands over a Mat header, so the presenter never waits on JPEG encoding. Frames
+ * submitted faster than the interval replace each other; the last one is flushed on destruction.
+ */
+class AsyncSnapshotWriter {
+ public:
+  AsyncSnapshotWriter(std::filesystem::path path, std::chrono::milliseconds interval)
+      : path_(std::move(path)), interval_(interval), thread_([this] { run(); }) {}
+
+  ~AsyncSnapshotWriter() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_one();
+    thread_.join();
+  }
+
+  /// Queues @p image for writing; the image must not be modified afterwards.
+  void submit(const cv::Mat& image) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      pending_ = image;
+    }
+    wake_.notify_one();
+  }
+
+ private:
+  void run() {
+    auto nextWrite = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+      wake_.wait(lock, [&] { return stop_ || !pending_.empty(); });
+      if (!stop_) wake_.wait_until(lock, nextWrite, [&] { return stop_; });
+      if (pending_.empty()) {
+        if (stop_) break;
+        continue;
+      }
+      cv::Mat image = std::move(pending_);
+      pending_ = cv::Mat();
+      lock.unlock();
+      if (!cv::imwrite(path_.string(), image)) {
+        std::cerr << "ERROR: Failed to save snapshot: " << path_ << std::endl;
+      }
+      nextWrite = std::chrono::steady_clock::now() + interval_;
+      lock.lock();
+    }
+  }
+
+  const std::filesystem::path path_;
+  const std::chrono::milliseconds interval_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  cv::Mat pending_;
+  bool stop_ = false;
+  std::thread thread_;  ///< Started last, once every other member is initialised
+};
+
+/// Decoded frame travelling from the decoder to the workers.
+struct FrameJob {
+  long long index;  ///< Presentation order (gap-free: dropped frames never get an index)
+  cv::Mat frame;
+};
+
+/// Keyed frame travelling from a worker to the presenter.
+struct FrameResult {
+  long long index;
+  cv::Mat source;     ///< Original frame, shown in the options window and used for sampling
+  cv::Mat composite;  ///< Keyed output
+};
+
+/**
+ * @brief Counters shared by the pipeline stages.
+ */
+struct PipelineStats {
+  std::atomic<long long> decoded{0};       ///< Frames read from the video
+  std::atomic<long long> dropped{0};       ///< Frames discarded because the workers were busy
+  std::atomic<long long> presented{0};     ///< Frames shown
+  std::atomic<long long> workerBusyNs{0};  ///< Time spent keying, summed over workers
+  double decodeQueueFill = 0;              ///< Sum of decode-queue sizes sampled by the presenter
+  double resultQueueFill = 0;              ///< Sum of result-queue sizes sampled by the presenter
+  long long samples = 0;                   ///< Number of queue samples
+};
+
+/**
+ * @brief Prints stage occupancy and drop counts for the last reporting period.
+ */
+void reportPipeline(PipelineStats& stats, double seconds, int numWorkers) {
+  const long long presented = stats.presented.exchange(0);
+  const long long decoded = stats.decoded.exchange(0);
+  const long long dropped = stats.dropped.exchange(0);
+  const double busy = stats.workerBusyNs.exchange(0) * 1e-9 / (seconds * numWorkers);
+  const double samples = std::max<long long>(stats.samples, 1);
+  std::cout << "[pipeline] " << presented / seconds << " fps shown, " << decoded / seconds
+            << " fps decoded | decode queue " << stats.decodeQueueFill / samples << "/"
+            << kQueueCapacity << " | workers " << static_cast<int>(100 * busy) << "% busy x"
+            << numWorkers << " | result queue " << stats.resultQueueFill / samples << "/"
+            << kQueueCapacity << " | dropped " << dropped << std::endl;
+  stats.decodeQueueFill = stats.resultQueueFill = 0;
+  stats.samples = 0;
+}
+
 //--------------------------------------------------------------------------------------
 // Main processing loop
 //--------------------------------------------------------------------------------------
 
 /**
  * @brief Runs the interactive chroma‐key effect on a video file.
+ *
+ * Three stages connected by bounded queues:
+ *  1. Decoder thread: reads frames at the video's frame rate (looping at the end). When the
+ *     workers are saturated the frame is dropped instead of delaying playback.
+ *  2. Worker pool: keys frames in parallel with the parameters published by the presenter.
+ *  3. Presenter (this thread): restores frame order, shows results, handles HighGUI events and
+ *     hands composites to the asynchronous snapshot writer.
+ *
  * @param videoPath       Path to the green‐screen input video.
  * @param backgroundPath  Path to the replacement background image.
+ * @param writeSnapshots  Periodically save the composite next to the video as *.example.jpg
+ *                        (the `--snapshots` switch).
  */
 void runChromaKey(const std::filesystem::path& videoPath,
-                  const std::filesystem::path& backgroundPath) {
+                  const std::filesystem::path& backgroundPath, bool writeSnapshots = false) {
   // Open video
   cv::VideoCapture cap(videoPath.string(), cv::CAP_FFMPEG);
   if (!cap.isOpened()) {
@@ -277,56 +666,358 @@ void runChromaKey(const std::filesystem::path& videoPath,
   cv::createTrackbar("Softness", kOptionsWindow, nullptr, 10, onTrackbar, &g_softness);
   cv::createTrackbar("Color Cast", kOptionsWindow, nullptr, 100, onTrackbar, &g_colorCast);
   cv::createTrackbar("Seamless", kOptionsWindow, nullptr, 1, onTrackbar, &g_seamless);
+  cv::createTrackbar("Fused", kOptionsWindow, nullptr, 1, onTrackbar, &g_fused);
+  cv::createTrackbar("Seamless Level", kOptionsWindow, nullptr, 3, onTrackbar, &g_seamlessLevel);
   cv::setMouseCallback(kOptionsWindow, onMouseSampleColor);
 
   cv::namedWindow(kOutputWindow, cv::WINDOW_NORMAL);
   cv::resizeWindow(kOutputWindow, 640, 360);
 
+  const double fps = cap.get(cv::CAP_PROP_FPS);
+  const auto framePeriod = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(fps > 0 ? 1.0 / fps : 0.025));
+  const int numWorkers =
+      std::clamp(static_cast<int>(std::thread::hardware_concurrency()) / 2, 1, kMaxWorkers);
+
+  portfolio::BoundedQueue<FrameJob> decodedQueue(kQueueCapacity);
+  portfolio::BoundedQueue<FrameResult> resultQueue(kQueueCapacity);
+  PipelineStats stats;
+  SharedKeyParams sharedParams;
+  sharedParams.set(readTrackbarParams({}));
+  AsyncKeyTableBuilder tableBuilder;
+
+  std::unique_ptr<AsyncSnapshotWriter> snapshots;
+  if (writeSnapshots) {
+    snapshots = std::make_unique<AsyncSnapshotWriter>(
+        videoPath.parent_path() / (videoPath.stem().string() + ".example.jpg"), kSnapshotInterval);
+  }
+
+  // Stage 1: decoder, paced to the source frame rate
+  std::atomic<bool> stopDecoder{false};
+  std::thread decoder([&, next = std::move(frame)]() mutable {
+    long long index = 0;
+    auto deadline = std::chrono::steady_clock::now();
+    while (!stopDecoder) {
+      if (next.empty()) {
+        // restart video
+        cap.set(cv::CAP_PROP_POS_FRAMES, 0);
+        cap >> next;
+        if (next.empty()) break;
+      }
+      ++stats.decoded;
+
+      deadline = std::max(deadline + framePeriod, std::chrono::steady_clock::now() - framePeriod);
+      std::this_thread::sleep_until(deadline);
+      if (decodedQueue.tryPush(FrameJob{index, std::move(next)})) {
+        ++index;
+      } else if (!decodedQueue.closed()) {
+        ++stats.dropped;
+      }
+      // `next` was moved out, so the capture decodes into a fresh buffer
+      cap >> next;
+    }
+    decodedQueue.close();
+  });
+
+  // Stage 2: keying workers; the last one to finish closes the result queue
+  std::atomic<int> activeWorkers{numWorkers};
+  std::vector<std::thread> workers;
+  for (int i = 0; i < numWorkers; ++i) {
+    workers.emplace_back([&] {
+      while (auto job = decodedQueue.pop()) {
+        const KeyParams params = sharedParams.get();
+        auto start = std::chrono::steady_clock::now();
+        cv::Mat composite = processFrame(job->frame, bg, params);
+        stats.workerBusyNs += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                  std::chrono::steady_clock::now() - start)
+                                  .count();
+        if (!resultQueue.push(FrameResult{job->index, std::move(job->frame), std::move(composite)}))
+          break;
+      }
+      if (--activeWorkers == 0) resultQueue.close();
+    });
+  }
+
+  // Stage 3: presenter
+  std::map<long long, FrameResult> reorder;  // results that finished ahead of their turn
+  long long nextIndex = 0;
+  auto lastReport = std::chrono::steady_clock::now();
   bool running = true;
   while (running) {
-    // Loop frames
-    if (frame.empty()) {
-      // restart video
-      cap.set(cv::CAP_PROP_POS_FRAMES, 0);
-      cap >> frame;
-      if (frame.empty()) break;
+    if (auto result = resultQueue.popFor(std::chrono::milliseconds(5))) {
+      reorder.emplace(result->index, std::move(*result));
     }
+    stats.decodeQueueFill += decodedQueue.size();
+    stats.resultQueueFill += resultQueue.size();
+    ++stats.samples;
 
-    // Prepare for sampling
-    g_currentFrame = frame.clone();
-    cv::imshow(kOptionsWindow, frame);
-
-    // Processing pipeline
-    cv::Mat keyMask = createKeyMask(
-        frame, {static_cast<uchar>(g_keyB), static_cast<uchar>(g_keyG), static_cast<uchar>(g_keyR)},
-        g_tolerance);
-    cv::Mat softMask = softenMask(keyMask, g_softness);
-    cv::Mat fgCorrect = correctGreenSpill(frame, softMask, g_colorCast);
-    cv::Mat composite = compositeFrame(fgCorrect, softMask, bg, g_seamless != 0);
+    auto it = reorder.find(nextIndex);
+    if (it != reorder.end()) {
+      FrameResult shown = std::move(it->second);
+      reorder.erase(it);
+      ++nextIndex;
 
-    cv::imshow(kOutputWindow, composite);
+      // Prepare for sampling (the frame is never written again, so no copy is needed)
+      g_currentFrame = shown.source;
+      cv::imshow(kOptionsWindow, shown.source);
+      cv::imshow(kOutputWindow, shown.composite);
+      if (snapshots) snapshots->submit(shown.composite);
+      ++stats.presented;
+    } else if (resultQueue.closed() && resultQueue.size() == 0) {
+      break;  // video could not be restarted
+    }
 
-    // Read next frame & handle key
-    char c = static_cast<char>(cv::waitKey(25));
+    // Handle key and pick up trackbar changes
+    char c = static_cast<char>(cv::waitKey(1));
     if (c == 27)  // Esc
       running = false;
-    auto dir = videoPath.parent_path();
-    auto stem = videoPath.stem().string();
-    std::string new_file_name = stem + ".example.jpg";
-    saveImageOrExit(dir / new_file_name, composite);
-    cap >> frame;
+    sharedParams.set(readTrackbarParams(sharedParams.get(), &tableBuilder));
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastReport >= kStatsInterval) {
+      reportPipeline(stats, std::chrono::duration<double>(now - lastReport).count(), numWorkers);
+      lastReport = now;
+    }
   }
 
+  // Shut the stages down: closing both queues unblocks every thread
+  stopDecoder = true;
+  decodedQueue.close();
+  resultQueue.close();
+  decoder.join();
+  for (auto& w : workers) w.join();
+  snapshots.reset();  // flushes the last snapshot
+
   cv::destroyAllWindows();
 }
 
+//--------------------------------------------------------------------------------------
+// Headless batch rendering
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Options for the headless `--render` mode.
+ */
+struct RenderOptions {
+  std::filesystem::path video;       ///< Green‐screen input video
+  std::filesystem::path background;  ///< Replacement background image
+  std::filesystem::path output;      ///< Output video (written with cv::VideoWriter)
+  KeyParams params;                  ///< Fixed key parameters (table built by the caller)
+  int workers = 0;                   ///< Worker threads (0 = one per hardware thread)
+};
+
+/**
+ * @brief Limits the number of frames in flight between the decoder and the writer.
+ *
+ * Workers can finish out of order; without a bound the writer's reorder buffer would grow
+ * whenever one frame is slow. acquire() blocks the decoder until the writer has released a slot.
+ */
+class InFlightWindow {
+ public:
+  explicit InFlightWindow(int size) : free_(size) {}
+
+  void acquire() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&] { return free_ > 0; });
+    --free_;
+  }
+
+  void release() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      ++free_;
+    }
+    released_.notify_one();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable released_;
+  int free_;
+};
+
+/**
+ * @brief Keys a whole video without any GUI and writes the composite to a video file.
+ *
+ * A decoder thread feeds N worker threads; the calling thread reassembles the results in order
+ * and writes them. The resized background is shared read-only by all workers and every frame is
+ * decoded into its own buffer, so memory grows with the in-flight window, not the worker count.
+ *
+ * @param opts  Input/output paths, key parameters and worker count.
+ * @return      EXIT_SUCCESS, or EXIT_FAILURE if an input cannot be read or the output written.
+ */
+int renderChromaKey(const RenderOptions& opts) {
+  cv::VideoCapture cap(opts.video.string(), cv::CAP_FFMPEG);
+  if (!cap.isOpened()) {
+    std::cerr << "ERROR: Cannot open video: " << opts.video << std::endl;
+    return EXIT_FAILURE;
+  }
+  const cv::Size frameSize(static_cast<int>(cap.get(cv::CAP_PROP_FRAME_WIDTH)),
+                           static_cast<int>(cap.get(cv::CAP_PROP_FRAME_HEIGHT)));
+  const double fps = cap.get(cv::CAP_PROP_FPS) > 0 ? cap.get(cv::CAP_PROP_FPS) : 25.0;
+
+  cv::Mat bg = cv::imread(opts.background.string(), cv::IMREAD_COLOR);
+  if (bg.empty()) {
+    std::cerr << "ERROR: Cannot load background: " << opts.background << std::endl;
+    return EXIT_FAILURE;
+  }
+  cv::resize(bg, bg, frameSize, 0, 0, cv::INTER_AREA);
+
+  cv::VideoWriter writer(opts.output.string(), cv::VideoWriter::fourcc('m', 'p', '4', 'v'), fps,
+                         frameSize);
+  if (!writer.isOpened()) {
+    std::cerr << "ERROR: Cannot open output video: " << opts.output << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  const int numWorkers =
+      opts.workers > 0 ? opts.workers
+                       : std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+  // Enough frames in flight to keep every worker busy while the writer waits for a slow one
+  const int window = 2 * numWorkers + static_cast<int>(kQueueCapacity);
+
+  portfolio::BoundedQueue<FrameJob> decodedQueue(kQueueCapacity);
+  portfolio::BoundedQueue<FrameResult> resultQueue(kQueueCapacity);
+  InFlightWindow inFlight(window);
+  const auto start = std::chrono::steady_clock::now();
+
+  // Decoder: blocking pushes, no frame is ever dropped
+  std::thread decoder([&] {
+    long long index = 0;
+    while (true) {
+      inFlight.acquire();
+      cv::Mat frame;
+      if (!cap.read(frame) || !decodedQueue.push(FrameJob{index++, std::move(frame)})) break;
+    }
+    decodedQueue.close();
+  });
+
+  std::atomic<int> activeWorkers{numWorkers};
+  std::vector<std::thread> workers;
+  for (int i = 0; i < numWorkers; ++i) {
+    workers.emplace_back([&] {
+      while (auto job = decodedQueue.pop()) {
+        cv::Mat composite = processFrame(job->frame, bg, opts.params);
+        if (!resultQueue.push(FrameResult{job->index, cv::Mat(), std::move(composite)})) break;
+      }
+      if (--activeWorkers == 0) resultQueue.close();
+    });
+  }
+
+  // Writer: restore decode order
+  std::map<long long, cv::Mat> reorder;
+  long long nextIndex = 0;
+  while (auto result = resultQueue.pop()) {
+    reorder.emplace(result->index, std::move(result->composite));
+    for (auto it = reorder.find(nextIndex); it != reorder.end(); it = reorder.find(nextIndex)) {
+      writer.write(it->second);
+      reorder.erase(it);
+      ++nextIndex;
+      inFlight.release();
+    }
+  }
+
+  decoder.join();
+  for (auto& w : workers) w.join();
+  writer.release();
+
+  const double seconds =
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  std::cout << "Rendered " << nextIndex << " frames to " << opts.output << " in " << seconds
+            << " s (" << nextIndex / seconds << " fps, " << numWorkers << " workers)" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Parses `--render <video> <background> <output> [options]`.
+ * @param argc, argv  Command line (argv[1] is "--render").
+ * @param opts        Receives the parsed options; the key table is built here.
+ * @return            True on success, false on malformed input.
+ */
+bool parseRenderOptions(int argc, char* argv[], RenderOptions& opts) {
+  if (argc < 5) return false;
+  opts.video = argv[2];
+  opts.background = argv[3];
+  opts.output = argv[4];
+
+  KeyParams& p = opts.params;
+  p.keyBGR = {0, 255, 0};
+  p.tolerance = 20;
+  p.softness = 2;
+  p.colorCast = 50;
+  try {
+    for (int i = 5; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--key" && hasValue) {
+        int b, g, r;
+        if (std::sscanf(argv[++i], "%d,%d,%d", &b, &g, &r) != 3) return false;
+        p.keyBGR = {cv::saturate_cast<uchar>(b), cv::saturate_cast<uchar>(g),
+                    cv::saturate_cast<uchar>(r)};
+      } else if (arg == "--tolerance" && hasValue) {
+        p.tolerance = std::clamp(std::stoi(argv[++i]), 0, 100);
+      } else if (arg == "--softness" && hasValue) {
+        p.softness = std::clamp(std::stoi(argv[++i]), 0, 10);
+      } else if (arg == "--color-cast" && hasValue) {
+        p.colorCast = std::clamp(std::stoi(argv[++i]), 0, 100);
+      } else if (arg == "--workers" && hasValue) {
+        opts.workers = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--seamless") {
+        p.seamless = true;
+      } else if (arg == "--seamless-level" && hasValue) {
+        p.seamless = true;
+        p.seamlessLevel = std::clamp(std::stoi(argv[++i]), 0, 3);
+      } else if (arg == "--fused") {
+        p.fused = true;
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+
+  auto table = std::make_shared<KeyColorTable>();
+  table->update(p.keyBGR, p.tolerance);
+  p.table = std::move(table);
+  return true;
+}
+
 //--------------------------------------------------------------------------------------
 // Entry point
 //--------------------------------------------------------------------------------------
 
-int main() {
+int main(int argc, char* argv[]) {
+  // Headless render mode
+  if (argc > 1 && std::string(argv[1]) == "--render") {
+    RenderOptions opts;
+    if (!parseRenderOptions(argc, argv, opts)) {
+      std::cerr << "Usage: " << argv[0]
+                << " --render <video> <background> <output> [--key B,G,R] [--tolerance %]"
+                   " [--softness N] [--color-cast %] [--workers N] [--seamless]"
+                   " [--seamless-level 0-3] [--fused]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    return renderChromaKey(opts);
+  }
+
+  // Interactive demos; snapshots are only written on request
+  bool writeSnapshots = false;
+  for (int i = 1; i < argc; ++i) {
+    if (std::string(argv[i]) == "--snapshots") {
+      writeSnapshots = true;
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--snapshots]" << std::endl
+                << "       " << argv[0]
+                << " --render <video> <background> <output> [options]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
   // First demo
-  runChromaKey(kDataDir / "../data" / "greenscreen-asteroid.mp4", kDataDir / "../data" / "IF1.jpg");
+  runChromaKey(kDataDir / "../data" / "greenscreen-asteroid.mp4", kDataDir / "../data" / "IF1.jpg",
+               writeSnapshots);
 
   // Reset parameters
   g_keyR = g_keyG = g_keyB = 0;
@@ -334,7 +1025,7 @@ int main() {
 
   // Second demo
   runChromaKey(kDataDir / "../data" / "greenscreen-demo.mp4",
-               kDataDir / "../data" / "times-square.jpg");
+               kDataDir / "../data" / "times-square.jpg", writeSnapshots);
 
   return EXIT_SUCCESS;
 }
\ No newline at end of file
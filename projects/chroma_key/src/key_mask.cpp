@@ -0,0 +1,105 @@
+/**
+ * @file key_mask.cpp
+ * @brief Chroma key mask implementations.
+ */
+
+#include "key_mask.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include "portfolio/mat_pool.hpp"
+
+void computeKeyRange(const cv::Vec3b& keyBGR, int tolerance, cv::Scalar& lower,
+                     cv::Scalar& upper) {
+  // Convertir el color clave BGR → HSV
+  cv::Mat keyPix(1, 1, CV_8UC3, keyBGR);
+  cv::cvtColor(keyPix, keyPix, cv::COLOR_BGR2HSV);
+  cv::Vec3b keyHSV = keyPix.at<cv::Vec3b>(0, 0);
+
+  // Calc. de deltas en HSV según tolerancia
+  double tol = tolerance / 100.0;
+  int hDelta = static_cast<int>(180 * tol);
+  int sDelta = static_cast<int>(255 * tol);
+  int vDelta = static_cast<int>(255 * tol);
+
+  // Calcular límites inferior y superior, primero en int
+  int hLower = std::clamp<int>(static_cast<int>(keyHSV[0]) - hDelta, 0, 180);
+  int sLower = std::clamp<int>(static_cast<int>(keyHSV[1]) - sDelta, 0, 255);
+  int vLower = std::clamp<int>(static_cast<int>(keyHSV[2]) - vDelta, 0, 255);
+
+  int hUpper = std::clamp<int>(static_cast<int>(keyHSV[0]) + hDelta, 0, 180);
+  int sUpper = std::clamp<int>(static_cast<int>(keyHSV[1]) + sDelta, 0, 255);
+  int vUpper = std::clamp<int>(static_cast<int>(keyHSV[2]) + vDelta, 0, 255);
+
+  // Ahora construir cv::Scalar con paréntesis (evita warnings de lista inicializada)
+  lower = cv::Scalar(hLower, sLower, vLower);
+  upper = cv::Scalar(hUpper, sUpper, vUpper);
+}
+
+cv::Mat createKeyMask(const cv::Mat& frame, const cv::Vec3b& keyBGR, int tolerance) {
+  cv::Scalar lower, upper;
+  computeKeyRange(keyBGR, tolerance, lower, upper);
+
+  // Convertir fotograma a HSV (buffer reutilizado por hilo)
+  portfolio::MatPool::Lease hsv = portfolio::MatPool::local().acquire(frame.size(), CV_8UC3);
+  cv::cvtColor(frame, *hsv, cv::COLOR_BGR2HSV);
+
+  // Generar máscara
+  cv::Mat mask;
+  cv::inRange(*hsv, lower, upper, mask);
+  return mask;
+}
+
+bool KeyColorTable::update(const cv::Vec3b& keyBGR, int tolerance) {
+  if (built_ && keyBGR == key_ && tolerance == tolerance_) return false;
+
+  cv::Scalar lower, upper;
+  computeKeyRange(keyBGR, tolerance, lower, upper);
+  bits_.assign(kWords, 0);
+
+  // One 256×256 plane of (g, r) colors per blue value, classified with the exact same
+  // cvtColor + inRange calls as the reference path.
+  cv::parallel_for_(cv::Range(0, 256), [&](const cv::Range& blues) {
+    cv::Mat plane(256, 256, CV_8UC3), hsv, mask;
+    for (int b = blues.start; b < blues.end; ++b) {
+      for (int g = 0; g < 256; ++g) {
+        cv::Vec3b* row = plane.ptr<cv::Vec3b>(g);
+        for (int r = 0; r < 256; ++r) row[r] = cv::Vec3b(b, g, r);
+      }
+      cv::cvtColor(plane, hsv, cv::COLOR_BGR2HSV);
+      cv::inRange(hsv, lower, upper, mask);
+
+      // Words of different blue planes never overlap, so stripes write independently
+      std::uint64_t* words = bits_.data() + (static_cast<std::size_t>(b) << 10);
+      for (int g = 0; g < 256; ++g) {
+        const uchar* m = mask.ptr<uchar>(g);
+        for (int r = 0; r < 256; ++r) {
+          if (m[r]) words[(g << 2) | (r >> 6)] |= std::uint64_t{1} << (r & 63);
+        }
+      }
+    }
+  });
+
+  key_ = keyBGR;
+  tolerance_ = tolerance;
+  built_ = true;
+  return true;
+}
+
+cv::Mat KeyColorTable::createMask(const cv::Mat& frame) const {
+  CV_Assert(built_ && frame.type() == CV_8UC3);
+  cv::Mat mask(frame.size(), CV_8UC1);
+  cv::parallel_for_(cv::Range(0, frame.rows), [&](const cv::Range& rows) {
+    for (int y = rows.start; y < rows.end; ++y) {
+      const uchar* p = frame.ptr<uchar>(y);
+      uchar* m = mask.ptr<uchar>(y);
+      for (int x = 0; x < frame.cols; ++x, p += 3) {
+        const std::uint32_t idx =
+            (std::uint32_t{p[0]} << 16) | (std::uint32_t{p[1]} << 8) | std::uint32_t{p[2]};
+        m[x] = ((bits_[idx >> 6] >> (idx & 63)) & 1) ? 255 : 0;
+      }
+    }
+  });
+  return mask;
+}
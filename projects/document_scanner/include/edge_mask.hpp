@@ -0,0 +1,30 @@
+/**
+ * @file edge_mask.hpp
+ * @brief Page-outline edge mask, shared by document_scanner and portfolio_bench.
+ */
+
+#pragma once
+
+#include <opencv2/core.hpp>
+
+/// Long side, in pixels, of the photos the edge mask settings were tuned at.
+constexpr double kEdgeMaskReferenceLongSide = 3264;
+
+/**
+* @brief Computes a cleaned edge mask from the input intensity image.
+*
+* Steps:
+*  1. Applies Gaussian blur to the V channel to suppress high‐frequency noise.
+*  2. Runs Canny edge detector on the blurred image.
+*  3. Performs morphological closing (cross‐shaped kernel) to close small gaps.
+*  4. Performs dilation to thicken and connect edges.
+*
+* The blur and morphology settings were tuned on kEdgeMaskReferenceLongSide images;
+* @p paramScale shrinks them for smaller inputs so the mask keeps the same shape relative to
+* the page. The blurred intermediate lives in a per-thread pooled buffer.
+*
+* @param graySrc     Grayscale or single‐channel intensity image (CV_8U).
+* @param paramScale  Input resolution relative to the tuning resolution.
+* @return            Binary edge mask (CV_8U) with white edges on black background.
+*/
+cv::Mat computeEdgeMask(const cv::Mat& graySrc, double paramScale = 1.0);
@@ -13,16 +13,43 @@
  *  8. Displays the original and the corrected images side‐by‐side for visual verification.
  *
  * Note: All intermediate windows are resizable (1200×900) for inspection. The final side‐by‐side result is shown in “Scanned vs. Original.”
+ *
+ * Video mode (--video [file|camera index], camera 0 by default) runs the full detector only to
+ * acquire the document, then tracks its four corners with pyramidal Lucas–Kanade flow. A frame
+ * falls back to full detection when the forward–backward check or the quad geometry rejects the
+ * track, and a periodic re-detection bounds drift. Press S to save the current scan, Esc to quit.
+ *
+ * Detection runs on a copy downscaled to kDetectMaxSide (blur and morphology scaled to match);
+ * only the four corners are mapped back and refined with cornerSubPix at full resolution.
+ *
+ * Batch mode (--batch) scans a whole directory headlessly: decoder threads prefetch pages, a
+ * worker pool detects and warps them, and encoder threads write `scanned_<name>`, reporting
+ * pages/sec and the load of each stage.
+ *
+ * Usage:
+ *   ./document_scanner [--video [source]]
+ *   ./document_scanner --batch <input_dir> <output_dir> [--workers N] [--decoders N]
+ *                      [--encoders N] [--prefetch N]
  */
 
+ #include <algorithm>
+ #include <atomic>
+ #include <cctype>
+ #include <chrono>
  #include <cstdlib>
  #include <filesystem>
+ #include <iomanip>
  #include <iostream>
+ #include <string>
+ #include <thread>
  #include <vector>
  #include <cmath>
  
  #include <opencv2/opencv.hpp>
  #include "config.pch"  // Defines DATA_DIR macro
+ #include "edge_mask.hpp"
+ #include "portfolio/bounded_queue.hpp"
+ #include "portfolio/image_io.hpp"
  
  //--------------------------------------------------------------------------------------
  // Configuration constants
@@ -41,115 +68,24 @@
   "../data/doc6.jpg"
 };
 
-// Gaussian blur parameters for low‐pass filtering on V channel
-static constexpr int    kGaussianKernelSize = 17;   ///< must be odd (e.g., 17×17)
-static constexpr double kGaussianSigma      = 3.3;  ///< standard deviation for Gaussian
-
-// Canny edge‐detector thresholds
-static constexpr double kCannyThresholdLow  = 25;
-static constexpr double kCannyThresholdHigh = 40;
-static constexpr int    kCannyAperture      = 3;    ///< the Sobel operator aperture size
-static constexpr bool   kCannyL2Grad        = false;///< whether to use L2 gradient norm
-static constexpr double kPerimeterEps       = 0.1;
-
-// Morphological post‐processing parameters
-static constexpr int MorphKSize  = 3;   ///< structuring element size (3×3)
-static constexpr int kCloseSteps = 10;  ///< number of iterations for morphological close
-static constexpr int kDilateSteps= 6;   ///< number of iterations for dilation
-
-//--------------------------------------------------------------------------------------
-// Utility functions
-//--------------------------------------------------------------------------------------
-
-/**
-* @brief Loads an image from disk, exiting on failure.
-* @param path   Full filesystem path to the image.
-* @param flags  OpenCV imread flags (default: IMREAD_COLOR).
-* @return       Loaded cv::Mat.
-*/
-static cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_COLOR) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-      std::cerr << "ERROR: Could not load image: " << path << std::endl;
-      std::exit(EXIT_FAILURE);
-  }
-  return img;
-}
+// Contour approximation tolerance, relative to the perimeter
+static constexpr double kPerimeterEps = 0.1;
 
-/**
-* @brief Saves an image to disk, exiting on failure.
-* @param path    Full filesystem path for output.
-* @param image   Image to write.
-* @param params  Optional imwrite parameters.
-*/
-static void saveImageOrExit(const std::filesystem::path& path,
-                          const cv::Mat& image,
-                          const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-      std::cerr << "ERROR: Could not save image: " << path << std::endl;
-      std::exit(EXIT_FAILURE);
-  }
-}
+// Multi-resolution detection
+static constexpr int    kDetectMaxSide     = 1024;  ///< long side of the detection copy
+static constexpr double kRefineRadius      = 4.0;   ///< sub-pixel search radius, detection pixels
 
-/**
-* @brief Displays an image in a resizable window until any key is pressed.
-* @param windowName  Title for the window.
-* @param image       Image to display.
-*/
-static void showImage(const std::string& windowName, const cv::Mat& image) {
-  cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-  cv::resizeWindow(windowName, 1200, 900);
-  cv::imshow(windowName, image);
-  cv::waitKey(0);
-  cv::destroyWindow(windowName);
-}
+// Corner tracking (video mode)
+static constexpr int    kTrackWindow        = 21;   ///< LK search window side
+static constexpr int    kTrackLevels        = 3;    ///< LK pyramid levels above the base
+static constexpr double kMaxFbError         = 1.0;  ///< max forward–backward drift, pixels
+static constexpr double kMaxAreaChange      = 0.2;  ///< max relative quad area change per frame
+static constexpr int    kRedetectInterval   = 30;   ///< frames between drift-bounding detections
 
 //--------------------------------------------------------------------------------------
 // Core image‐processing functions
 //--------------------------------------------------------------------------------------
 
-/**
-* @brief Computes a cleaned edge mask from the input intensity image.
-*
-* Steps:
-*  1. Applies Gaussian blur to the V channel to suppress high‐frequency noise.
-*  2. Runs Canny edge detector on the blurred image.
-*  3. Performs morphological closing (cross‐shaped kernel) to close small gaps.
-*  4. Performs dilation to thicken and connect edges.
-*
-* @param graySrc  Grayscale or single‐channel intensity image (CV_8U).
-* @return         Binary edge mask (CV_8U) with white edges on black background.
-*/
-static cv::Mat computeEdgeMask(const cv::Mat& graySrc) {
-  cv::Mat blurred;
-  cv::GaussianBlur(graySrc, blurred,
-                   cv::Size(kGaussianKernelSize, kGaussianKernelSize),
-                   kGaussianSigma, kGaussianSigma);
-  // Optional: uncomment to inspect blurred result
-  // showImage("Blurred V Channel", blurred);
-
-  cv::Mat edges;
-  cv::Canny(blurred, edges,
-            kCannyThresholdLow, kCannyThresholdHigh,
-            kCannyAperture, kCannyL2Grad);
-
-  // Morphological closing (CROSS) to close small gaps in edges
-  cv::Mat kernel = cv::getStructuringElement(
-      cv::MorphShapes::MORPH_CROSS,
-      cv::Size(MorphKSize, MorphKSize)
-  );
-  cv::morphologyEx(edges, edges,
-                   cv::MorphTypes::MORPH_CLOSE,
-                   kernel, cv::Point(-1, -1), kCloseSteps);
-
-  // Dilate to thicken edges
-  cv::morphologyEx(edges, edges,
-                   cv::MorphTypes::MORPH_DILATE,
-                   kernel, cv::Point(-1, -1), kDilateSteps);
-
-  return edges;
-}
-
 /**
 * @brief Finds the largest quadrilateral contour in a binary edge mask.
 *
@@ -196,19 +132,19 @@ static std::vector<cv::Point> findLargestQuad(const cv::Mat& edges) {
 * @param pts   Input vector of 4 points (unordered).
 * @return      Ordered vector of 4 points: [TL, TR, BL, BR]. If size ≠ 4, returns empty.
 */
-static std::vector<cv::Point> sortCorners(const std::vector<cv::Point>& pts) {
+static std::vector<cv::Point2f> sortCorners(const std::vector<cv::Point2f>& pts) {
   if (pts.size() != 4) {
       return {};  // invalid input
   }
   // Copy and sort by y ascending
-  std::vector<cv::Point> sorted = pts;
+  std::vector<cv::Point2f> sorted = pts;
   std::sort(sorted.begin(), sorted.end(),
-            [](const cv::Point& a, const cv::Point& b) {
+            [](const cv::Point2f& a, const cv::Point2f& b) {
                 return a.y < b.y;
             });
   // Top two are sorted[0], sorted[1]; bottom two are sorted[2], sorted[3]
-  std::vector<cv::Point> top{ sorted[0], sorted[1] };
-  std::vector<cv::Point> bot{ sorted[2], sorted[3] };
+  std::vector<cv::Point2f> top{ sorted[0], sorted[1] };
+  std::vector<cv::Point2f> bot{ sorted[2], sorted[3] };
   // Sort top by x ascending → top-left, top-right
   if (top[0].x > top[1].x) std::swap(top[0], top[1]);
   // Sort bottom by x ascending → bottom-left, bottom-right
@@ -227,15 +163,13 @@ static std::vector<cv::Point> sortCorners(const std::vector<cv::Point>& pts) {
 * @param sortedCorners  Vector of 4 points ordered [TL, TR, BL, BR].
 * @return               cv::Size(width, height) for output warp. If input size ≠ 4, returns zero size.
 */
-static cv::Size computeDocumentSize(const std::vector<cv::Point>& sortedCorners) {
+static cv::Size computeDocumentSize(const std::vector<cv::Point2f>& sortedCorners) {
   if (sortedCorners.size() != 4) {
       std::cerr << "ERROR: computeDocumentSize requires exactly 4 ordered corners.\n";
       return {};
   }
-  auto dist = [](const cv::Point& p1, const cv::Point& p2) {
-      double dx = static_cast<double>(p2.x - p1.x);
-      double dy = static_cast<double>(p2.y - p1.y);
-      return std::sqrt(dx*dx + dy*dy);
+  auto dist = [](const cv::Point2f& p1, const cv::Point2f& p2) {
+      return static_cast<double>(cv::norm(p2 - p1));
   };
   // Top‐left to bottom‐left, and top‐right to bottom‐right
   double h1 = dist(sortedCorners[0], sortedCorners[2]);
@@ -256,17 +190,11 @@ static cv::Size computeDocumentSize(const std::vector<cv::Point>& sortedCorners)
 * @param docSize        Desired output size (width, height).
 * @return               3×3 homography matrix (CV_64F). Empty Mat if input invalid.
 */
-static cv::Mat computeHomography(const std::vector<cv::Point>& sortedCorners,
+static cv::Mat computeHomography(const std::vector<cv::Point2f>& sortedCorners,
                                const cv::Size& docSize) {
   if (sortedCorners.size() != 4 || docSize.width == 0 || docSize.height == 0) {
       return {};
   }
-  // Source points (float)
-  std::vector<cv::Point2f> srcPts(4);
-  for (int i = 0; i < 4; ++i) {
-      srcPts[i] = { static_cast<float>(sortedCorners[i].x),
-                    static_cast<float>(sortedCorners[i].y) };
-  }
   // Destination points: (0,0), (W,0), (0,H), (W,H)
   std::vector<cv::Point2f> dstPts = {
       { 0.0f,             0.0f            },  // TL
@@ -275,38 +203,513 @@ static cv::Mat computeHomography(const std::vector<cv::Point>& sortedCorners,
       { static_cast<float>(docSize.width), static_cast<float>(docSize.height) }  // BR
   };
   // Use getPerspectiveTransform (4‐point correspondences)
-  return cv::getPerspectiveTransform(srcPts, dstPts);
+  return cv::getPerspectiveTransform(sortedCorners, dstPts);
+}
+
+/**
+* @brief Extracts the V (intensity) channel of a BGR image.
+*/
+static cv::Mat valueChannel(const cv::Mat& colorImg) {
+  cv::Mat hsv, vChannel;
+  cv::cvtColor(colorImg, hsv, cv::COLOR_BGR2HSV);
+  cv::extractChannel(hsv, vChannel, 2);  // V is channel index 2
+  return vChannel;
+}
+
+/**
+* @brief Refines corners to sub‐pixel accuracy on the full‐resolution V channel.
+*
+* Only a window around each corner is converted, so the full image is never processed. A
+* corner whose refinement leaves the search window (no corner structure nearby) keeps its
+* mapped position.
+*
+* @param colorImg  Full‐resolution BGR image.
+* @param corners   Corners to refine, in place.
+* @param radius    Search half‐size in full‐resolution pixels.
+*/
+static void refineCorners(const cv::Mat& colorImg, std::vector<cv::Point2f>& corners,
+                          int radius) {
+  const cv::Rect bounds(0, 0, colorImg.cols, colorImg.rows);
+  const cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 30, 0.01);
+  for (auto& corner : corners) {
+      // Window plus the border cornerSubPix samples around it
+      const int half = 2 * radius + 2;
+      const cv::Rect roi = cv::Rect(cvRound(corner.x) - half, cvRound(corner.y) - half,
+                                    2 * half + 1, 2 * half + 1) & bounds;
+      // cornerSubPix needs the window plus a 2-px border on each side
+      if (roi.width < 2 * radius + 5 || roi.height < 2 * radius + 5) {
+          continue;  // too close to the border to refine
+      }
+      std::vector<cv::Point2f> local{ corner - cv::Point2f(roi.tl()) };
+      cv::cornerSubPix(valueChannel(colorImg(roi)), local, cv::Size(radius, radius),
+                       cv::Size(-1, -1), criteria);
+      const cv::Point2f refined = local[0] + cv::Point2f(roi.tl());
+      if (cv::norm(refined - corner) <= radius) {
+          corner = refined;
+      }
+  }
+}
+
+/**
+* @brief Runs the still-image detector (V channel → edge mask → largest quad) on a copy
+*        downscaled to kDetectMaxSide, then maps the corners back and refines them.
+*
+* @param colorImg  BGR input frame.
+* @param corners   Output: four full‐resolution corners in [TL, TR, BL, BR] order.
+* @return          True if a quadrilateral was found.
+*/
+static bool detectDocument(const cv::Mat& colorImg, std::vector<cv::Point2f>& corners) {
+  const int longSide = std::max(colorImg.cols, colorImg.rows);
+  const double scale = std::min(1.0, static_cast<double>(kDetectMaxSide) / longSide);
+  cv::Mat small = colorImg;
+  if (scale < 1.0) {
+      cv::resize(colorImg, small, cv::Size(), scale, scale, cv::INTER_AREA);
+  }
+  const double paramScale = longSide * scale / kEdgeMaskReferenceLongSide;
+  auto quad = findLargestQuad(computeEdgeMask(valueChannel(small), paramScale));
+  if (quad.size() != 4) {
+      return false;
+  }
+  std::vector<cv::Point2f> quadF;
+  for (const auto& p : quad) {
+      quadF.emplace_back(static_cast<float>(p.x / scale), static_cast<float>(p.y / scale));
+  }
+  corners = sortCorners(quadF);
+  refineCorners(colorImg, corners, std::max(2, cvRound(kRefineRadius / scale)));
+  return true;
+}
+
+/**
+* @brief Warps the document bounded by @p sortedCorners to a fronto‐parallel image.
+* @return Scanned image, empty if the corners are degenerate.
+*/
+static cv::Mat warpDocument(const cv::Mat& colorImg,
+                            const std::vector<cv::Point2f>& sortedCorners) {
+  cv::Size docSize = computeDocumentSize(sortedCorners);
+  cv::Mat H = computeHomography(sortedCorners, docSize);
+  if (H.empty()) {
+      return {};
+  }
+  cv::Mat warped;
+  cv::warpPerspective(colorImg, warped, H, docSize);
+  return warped;
+}
+
+//--------------------------------------------------------------------------------------
+// Video mode: temporal corner tracking
+//--------------------------------------------------------------------------------------
+
+/**
+* @brief Tracks the four corners from @p prevGray to @p gray with pyramidal LK flow.
+*
+* A track is accepted only if every corner passes the forward–backward check (tracking the
+* result back must land within kMaxFbError of the start), the quad stays convex with the
+* same TL/TR/BR/BL winding, and its area changes by less than kMaxAreaChange. Corner order
+* is preserved, so no re-sorting is needed while tracking.
+*
+* @param prevPyr   LK pyramid of the previous frame.
+* @param pyr       LK pyramid of the current frame.
+* @param corners   In: previous corners [TL, TR, BL, BR]; out: tracked corners on success.
+* @return          True if the track is trusted.
+*/
+static bool trackCorners(const std::vector<cv::Mat>& prevPyr, const std::vector<cv::Mat>& pyr,
+                         std::vector<cv::Point2f>& corners) {
+  const cv::Size window(kTrackWindow, kTrackWindow);
+  const cv::TermCriteria criteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS, 20, 0.03);
+  std::vector<cv::Point2f> forward, backward;
+  std::vector<uchar> statusF, statusB;
+  std::vector<float> err;
+  cv::calcOpticalFlowPyrLK(prevPyr, pyr, corners, forward, statusF, err, window, kTrackLevels,
+                           criteria);
+  cv::calcOpticalFlowPyrLK(pyr, prevPyr, forward, backward, statusB, err, window, kTrackLevels,
+                           criteria);
+  for (size_t i = 0; i < corners.size(); ++i) {
+      if (!statusF[i] || !statusB[i] || cv::norm(backward[i] - corners[i]) > kMaxFbError) {
+          return false;
+      }
+  }
+
+  // Geometry: polygon order TL, TR, BR, BL must stay convex and keep a stable area
+  auto polygon = [](const std::vector<cv::Point2f>& c) {
+      return std::vector<cv::Point2f>{ c[0], c[1], c[3], c[2] };
+  };
+  const auto before = polygon(corners);
+  const auto after = polygon(forward);
+  if (!cv::isContourConvex(after)) {
+      return false;
+  }
+  const double areaBefore = cv::contourArea(before);
+  const double areaAfter = cv::contourArea(after);
+  if (areaBefore <= 0 || std::abs(areaAfter - areaBefore) > kMaxAreaChange * areaBefore) {
+      return false;
+  }
+  corners = forward;
+  return true;
+}
+
+/**
+* @brief Live scanning loop over a video file or camera.
+*
+* @param source  Video file path, or a camera index given as digits.
+* @return        Process exit code.
+*/
+static int runVideo(const std::string& source) {
+  cv::VideoCapture cap;
+  const bool isCamera = !source.empty() &&
+                        std::all_of(source.begin(), source.end(),
+                                    [](unsigned char c) { return std::isdigit(c) != 0; });
+  if (isCamera) {
+      cap.open(std::stoi(source));
+  } else {
+      cap.open(source);
+  }
+  if (!cap.isOpened()) {
+      std::cerr << "ERROR: Cannot open video source: " << source << std::endl;
+      return EXIT_FAILURE;
+  }
+
+  const std::string frameWindow = "Document Tracking";
+  const std::string scanWindow = "Scanned";
+  cv::namedWindow(frameWindow, cv::WINDOW_NORMAL);
+  cv::resizeWindow(frameWindow, 1200, 900);
+  cv::namedWindow(scanWindow, cv::WINDOW_NORMAL);
+
+  cv::Mat frame, gray;
+  std::vector<cv::Mat> pyr, prevPyr;
+  std::vector<cv::Point2f> corners;
+  bool locked = false;
+  int sinceDetection = 0, frames = 0, detections = 0, tracked = 0, saved = 0;
+  double totalMs = 0;
+  const cv::Size window(kTrackWindow, kTrackWindow);
+
+  while (cap.read(frame)) {
+      auto start = std::chrono::steady_clock::now();
+      cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+      cv::buildOpticalFlowPyramid(gray, pyr, window, kTrackLevels);
+
+      // Track while locked; detect to acquire, after a rejected track, or to bound drift
+      bool ok = locked && trackCorners(prevPyr, pyr, corners);
+      if (ok) {
+          ++tracked;
+      }
+      if (!ok || ++sinceDetection >= kRedetectInterval) {
+          std::vector<cv::Point2f> detected;
+          if (detectDocument(frame, detected)) {
+              corners = detected;
+              ok = true;
+          }
+          ++detections;
+          sinceDetection = 0;
+      }
+      locked = ok;
+      std::swap(prevPyr, pyr);
+
+      cv::Mat scanned = locked ? warpDocument(frame, corners) : cv::Mat();
+      totalMs += std::chrono::duration<double, std::milli>(
+                     std::chrono::steady_clock::now() - start).count();
+      ++frames;
+
+      if (locked) {
+          std::vector<cv::Point> outline;
+          for (int i : { 0, 1, 3, 2 }) {
+              outline.emplace_back(cvRound(corners[i].x), cvRound(corners[i].y));
+          }
+          cv::polylines(frame, outline, true, cv::Scalar(0, 255, 0), 3, cv::LINE_AA);
+      }
+      cv::imshow(frameWindow, frame);
+      if (!scanned.empty()) {
+          cv::imshow(scanWindow, scanned);
+      }
+
+      const int key = cv::waitKey(1) & 0xFF;
+      if (key == 27) {
+          break;
+      }
+      if ((key == 's' || key == 'S') && !scanned.empty()) {
+          std::filesystem::path outputPath =
+              kDataDir / cv::format("scanned_frame_%04d.jpg", ++saved);
+          portfolio::saveImageOrExit(outputPath, scanned);
+          std::cout << "Saved " << outputPath << std::endl;
+      }
+  }
+
+  if (frames > 0) {
+      std::cout << frames << " frames, " << detections << " full detections, " << tracked
+                << " tracked, " << totalMs / frames << " ms/frame" << std::endl;
+  }
+  cv::destroyAllWindows();
+  return EXIT_SUCCESS;
+}
+
+//--------------------------------------------------------------------------------------
+// Batch mode
+//--------------------------------------------------------------------------------------
+
+/// Paths and thread counts of the headless batch mode.
+struct BatchOptions {
+  std::filesystem::path inputDir;
+  std::filesystem::path outputDir;
+  int workers = 0;   ///< Detection/warp threads, 0 = one per hardware thread
+  int decoders = 1;  ///< Prefetch/decode threads
+  int encoders = 1;  ///< Encode/write threads
+  int prefetch = 0;  ///< Decoded pages kept ahead of the workers, 0 = 2 per worker
+};
+
+/**
+* @brief Parses `--batch <input_dir> <output_dir> [options]`; returns false on bad input.
+*/
+static bool parseBatchOptions(int argc, char* argv[], BatchOptions& opts) {
+  if (argc < 4) {
+      return false;
+  }
+  opts.inputDir = argv[2];
+  opts.outputDir = argv[3];
+  try {
+      for (int i = 4; i < argc; ++i) {
+          const std::string arg = argv[i];
+          const bool hasValue = i + 1 < argc;
+          if (arg == "--workers" && hasValue) {
+              opts.workers = std::max(0, std::stoi(argv[++i]));
+          } else if (arg == "--decoders" && hasValue) {
+              opts.decoders = std::max(1, std::stoi(argv[++i]));
+          } else if (arg == "--encoders" && hasValue) {
+              opts.encoders = std::max(1, std::stoi(argv[++i]));
+          } else if (arg == "--prefetch" && hasValue) {
+              opts.prefetch = std::max(0, std::stoi(argv[++i]));
+          } else {
+              return false;
+          }
+      }
+  } catch (const std::exception&) {
+      return false;
+  }
+  return true;
+}
+
+/// Busy time of one pipeline stage, accumulated per thread and merged after the run.
+struct StageStats {
+  int count = 0;
+  double totalMs = 0;
+  double maxMs = 0;
+
+  void add(double ms) {
+      ++count;
+      totalMs += ms;
+      maxMs = std::max(maxMs, ms);
+  }
+  void merge(const StageStats& o) {
+      count += o.count;
+      totalMs += o.totalMs;
+      maxMs = std::max(maxMs, o.maxMs);
+  }
+};
+
+/// Milliseconds elapsed since @p start.
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/**
+* @brief Prints one stage line: mean/max latency per page and utilization of the stage threads.
+*
+* A utilization near 100 % marks the stage that bounds throughput.
+*/
+static void reportStage(const std::string& name, const std::vector<StageStats>& perThread,
+                        double wallMs) {
+  StageStats s;
+  for (const auto& t : perThread) {
+      s.merge(t);
+  }
+  const double mean = s.count > 0 ? s.totalMs / s.count : 0.0;
+  const double busy = 100.0 * s.totalMs / std::max(wallMs * perThread.size(), 1e-9);
+  std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(6) << s.count << " pages  mean " << std::setw(8)
+            << mean << " ms  max " << std::setw(8) << s.maxMs << " ms  " << perThread.size()
+            << " thread(s) " << std::setw(5) << busy << " % busy" << std::defaultfloat
+            << std::endl;
+}
+
+/// Sorted list of the image files directly inside @p dir.
+static std::vector<std::filesystem::path> listImages(const std::filesystem::path& dir,
+                                                     std::error_code& ec) {
+  std::vector<std::filesystem::path> images;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+      std::string ext = entry.path().extension().string();
+      std::transform(ext.begin(), ext.end(), ext.begin(),
+                     [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+      if (entry.is_regular_file() &&
+          (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" ||
+           ext == ".tif" || ext == ".tiff")) {
+          images.push_back(entry.path());
+      }
+  }
+  std::sort(images.begin(), images.end());
+  return images;
+}
+
+/**
+* @brief Scans every page of a directory with a three-stage pipeline.
+*
+* Decoder threads read ahead into a bounded queue, so at most `prefetch` decoded pages wait in
+* memory. Workers run detectDocument() and warpDocument(); the scans go to a second bounded
+* queue drained by encoder threads, keeping imwrite off the workers. The last thread of each
+* stage closes the queue it feeds. Pages without a detectable document are reported and skipped.
+*
+* @return EXIT_SUCCESS if every page that holds a document was written.
+*/
+static int runBatch(const BatchOptions& opts) {
+  std::error_code ec;
+  const std::vector<std::filesystem::path> inputs = listImages(opts.inputDir, ec);
+  if (ec) {
+      std::cerr << "ERROR: Cannot read directory " << opts.inputDir << std::endl;
+      return EXIT_FAILURE;
+  }
+  std::filesystem::create_directories(opts.outputDir, ec);
+
+  const int numWorkers = std::max(1, opts.workers > 0
+                                         ? opts.workers
+                                         : static_cast<int>(std::thread::hardware_concurrency()));
+  const size_t prefetch = opts.prefetch > 0 ? opts.prefetch : 2 * numWorkers;
+  // Parallelism comes from the page pool; nested OpenCV threads would only oversubscribe
+  if (numWorkers > 1) {
+      cv::setNumThreads(1);
+  }
+
+  struct Decoded {
+      size_t index;
+      cv::Mat image;
+  };
+  struct Encode {
+      std::filesystem::path path;
+      cv::Mat image;
+  };
+  portfolio::BoundedQueue<Decoded> decodedQueue(prefetch);
+  portfolio::BoundedQueue<Encode> encodeQueue(prefetch);
+
+  std::vector<StageStats> decodeStats(opts.decoders), processStats(numWorkers),
+      encodeStats(opts.encoders);
+  std::atomic<size_t> nextInput{0};
+  std::atomic<int> decodersLeft{opts.decoders}, workersLeft{numWorkers};
+  std::atomic<int> written{0}, failed{0}, undetected{0};
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int d = 0; d < opts.decoders; ++d) {
+      threads.emplace_back([&, d] {
+          for (size_t i = nextInput++; i < inputs.size(); i = nextInput++) {
+              const auto t0 = std::chrono::steady_clock::now();
+              cv::Mat image = cv::imread(inputs[i].string(), cv::IMREAD_COLOR);
+              decodeStats[d].add(elapsedMs(t0));
+              if (image.empty()) {
+                  std::cerr << "ERROR: Could not load image: " << inputs[i] << std::endl;
+                  failed += 1;
+                  continue;
+              }
+              if (!decodedQueue.push({i, std::move(image)})) {
+                  break;
+              }
+          }
+          if (--decodersLeft == 0) {
+              decodedQueue.close();
+          }
+      });
+  }
+
+  for (int w = 0; w < numWorkers; ++w) {
+      threads.emplace_back([&, w] {
+          while (auto job = decodedQueue.pop()) {
+              const auto t0 = std::chrono::steady_clock::now();
+              std::vector<cv::Point2f> corners;
+              cv::Mat warped;
+              try {
+                  if (detectDocument(job->image, corners)) {
+                      warped = warpDocument(job->image, corners);
+                  }
+              } catch (const cv::Exception& e) {
+                  // One bad page must not terminate the whole job
+                  processStats[w].add(elapsedMs(t0));
+                  std::cerr << "ERROR: Could not scan " << inputs[job->index] << ": " << e.what()
+                            << std::endl;
+                  failed += 1;
+                  continue;
+              }
+              processStats[w].add(elapsedMs(t0));
+              if (warped.empty()) {
+                  std::cerr << "WARNING: No quadrilateral detected in " << inputs[job->index]
+                            << "\n";
+                  undetected += 1;
+                  continue;
+              }
+              const std::string name = inputs[job->index].filename().string();
+              encodeQueue.push({opts.outputDir / ("scanned_" + name), std::move(warped)});
+          }
+          if (--workersLeft == 0) {
+              encodeQueue.close();
+          }
+      });
+  }
+
+  for (int e = 0; e < opts.encoders; ++e) {
+      threads.emplace_back([&, e] {
+          while (auto job = encodeQueue.pop()) {
+              const auto t0 = std::chrono::steady_clock::now();
+              const bool ok = cv::imwrite(job->path.string(), job->image);
+              encodeStats[e].add(elapsedMs(t0));
+              if (ok) {
+                  written += 1;
+              } else {
+                  std::cerr << "ERROR: Could not save image: " << job->path << std::endl;
+                  failed += 1;
+              }
+          }
+      });
+  }
+  for (auto& t : threads) {
+      t.join();
+  }
+
+  const double wallMs = elapsedMs(start);
+  std::cout << "Scanned " << written << " of " << inputs.size() << " pages in "
+            << wallMs / 1000.0 << " s (" << written * 1000.0 / std::max(wallMs, 1e-9)
+            << " pages/s), " << undetected << " without a document" << std::endl;
+  reportStage("decode", decodeStats, wallMs);
+  reportStage("scan", processStats, wallMs);
+  reportStage("encode", encodeStats, wallMs);
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 //--------------------------------------------------------------------------------------
 // Main program
 //--------------------------------------------------------------------------------------
 
-int main() {
+int main(int argc, char* argv[]) {
+  if (argc > 1 && std::string(argv[1]) == "--video") {
+      return runVideo(argc > 2 ? argv[2] : "0");
+  }
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+      BatchOptions opts;
+      if (!parseBatchOptions(argc, argv, opts)) {
+          std::cerr << "Usage: " << argv[0] << " --batch <input_dir> <output_dir> [--workers N]"
+                    << " [--decoders N] [--encoders N] [--prefetch N]" << std::endl;
+          return EXIT_FAILURE;
+      }
+      return runBatch(opts);
+  }
+
   // Iterate over each sample document image
   for (const auto& relPath : kInputRelativePaths) {
       std::filesystem::path fullPath = kDataDir / relPath;
-      cv::Mat colorImg = loadImageOrExit(fullPath, cv::IMREAD_COLOR);
-
-      // Step 1: Convert BGR → HSV and extract V channel (intensity)
-      cv::Mat hsv, vChannel;
-      cv::cvtColor(colorImg, hsv, cv::COLOR_BGR2HSV);
-      cv::extractChannel(hsv, vChannel, 2);  // V is channel index 2
+      cv::Mat colorImg = portfolio::loadImageOrExit(fullPath, cv::IMREAD_COLOR);
 
-      // Step 2: Compute clean edge mask using Canny + morphology
-      cv::Mat edgeMask = computeEdgeMask(vChannel);
-      //showImage("Clean Edge Mask", edgeMask);
-
-      // Step 3: Find the largest quadrilateral contour (document boundary)
-      auto quad = findLargestQuad(edgeMask);
-      if (quad.size() != 4) {
+      // Steps 1–4: V channel → edge mask → largest quad on a downscaled copy, then corners
+      // sorted to [TL, TR, BL, BR] and refined at full resolution
+      std::vector<cv::Point2f> sortedCorners;
+      if (!detectDocument(colorImg, sortedCorners)) {
           std::cerr << "WARNING: No quadrilateral detected in " << fullPath << "\n";
           continue;
       }
 
-      // Step 4: Sort corner points to [TL, TR, BL, BR]
-      auto sortedCorners = sortCorners(quad);
-
       // Step 5: Compute output document size
       cv::Size docSize = computeDocumentSize(sortedCorners);
       if (docSize.width == 0 || docSize.height == 0) {
@@ -332,11 +735,11 @@ int main() {
       cv::Mat sideBySide;
       cv::hconcat(colorImg, resizedWarped, sideBySide);
 
-      showImage("Original vs. Scanned", sideBySide);
+      portfolio::showImage("Original vs. Scanned", sideBySide);
 
       // (Optional) Save the scanned output to disk
       std::filesystem::path outputPath = fullPath.parent_path() / ("scanned_" + fullPath.filename().string());
-      saveImageOrExit(outputPath, warped);
+      portfolio::saveImageOrExit(outputPath, warped);
   }
 
   return EXIT_SUCCESS;
@@ -0,0 +1,62 @@
+/**
+ * @file edge_mask.cpp
+ * @brief Page-outline edge mask implementation and its tuning constants.
+ */
+
+#include "edge_mask.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+#include "portfolio/mat_pool.hpp"
+
+// Gaussian blur parameters for low‐pass filtering on V channel
+static constexpr int    kGaussianKernelSize = 17;   ///< must be odd (e.g., 17×17)
+static constexpr double kGaussianSigma      = 3.3;  ///< standard deviation for Gaussian
+
+// Canny edge‐detector thresholds
+static constexpr double kCannyThresholdLow  = 25;
+static constexpr double kCannyThresholdHigh = 40;
+static constexpr int    kCannyAperture      = 3;    ///< the Sobel operator aperture size
+static constexpr bool   kCannyL2Grad        = false;///< whether to use L2 gradient norm
+
+// Morphological post‐processing parameters
+static constexpr int MorphKSize  = 3;   ///< structuring element size (3×3)
+static constexpr int kCloseSteps = 10;  ///< number of iterations for morphological close
+static constexpr int kDilateSteps= 6;   ///< number of iterations for dilation
+
+cv::Mat computeEdgeMask(const cv::Mat& graySrc, double paramScale) {
+  const int kernelSize = std::max(3, cvRound(kGaussianKernelSize * paramScale) | 1);
+  const double sigma = kGaussianSigma * paramScale;
+  const int closeSteps = std::max(1, cvRound(kCloseSteps * paramScale));
+  const int dilateSteps = std::max(1, cvRound(kDilateSteps * paramScale));
+
+  portfolio::MatPool::Lease blurred =
+      portfolio::MatPool::local().acquire(graySrc.size(), graySrc.type());
+  cv::GaussianBlur(graySrc, *blurred,
+                   cv::Size(kernelSize, kernelSize),
+                   sigma, sigma);
+  // Optional: uncomment to inspect blurred result
+  // portfolio::showImage("Blurred V Channel", *blurred);
+
+  cv::Mat edges;
+  cv::Canny(*blurred, edges,
+            kCannyThresholdLow, kCannyThresholdHigh,
+            kCannyAperture, kCannyL2Grad);
+
+  // Morphological closing (CROSS) to close small gaps in edges
+  cv::Mat kernel = cv::getStructuringElement(
+      cv::MorphShapes::MORPH_CROSS,
+      cv::Size(MorphKSize, MorphKSize)
+  );
+  cv::morphologyEx(edges, edges,
+                   cv::MorphTypes::MORPH_CLOSE,
+                   kernel, cv::Point(-1, -1), closeSteps);
+
+  // Dilate to thicken edges
+  cv::morphologyEx(edges, edges,
+                   cv::MorphTypes::MORPH_DILATE,
+                   kernel, cv::Point(-1, -1), dilateSteps);
+
+  return edges;
+}
@@ -5,48 +5,56 @@
  * This tool:
  *  1. Loads a 3-channel image stored as three stacked grayscale regions.
  *  2. Splits it into blue, green, and red channels (top, middle, bottom).
- *  3. Detects ORB features and descriptors on each channel.
- *  4. Matches features (green↔blue, green↔red), filters by quality.
- *  5. Estimates homographies via RANSAC and warps blue and red onto green.
+ *  3. Detects ORB features and descriptors on a pyramid level of each channel, in parallel.
+ *  4. Matches features (blue→green, red→green) with FLANN LSH kNN and a ratio test.
+ *  5. Estimates homographies via RANSAC, scales them to full resolution and refines them
+ *     there with ECC, then warps blue and red onto green.
  *  6. Merges channels back into a color image and displays comparison.
+ *  7. Prints the runtime of every stage.
  *
  * Usage:
- *   ./feature_alignment [input_image]
+ *   ./feature_alignment [input_image] [--level N] [--no-refine]
+ *   ./feature_alignment --batch <input_dir> <output_dir> [--workers N] [--memory-mb N]
+ *                       [--tile N] [--proxy-side N] [--no-refine]
  *
- * If input_image is not provided, defaults to DATA_DIR/../data/emir.jpg
+ * If input_image is not provided, defaults to DATA_DIR/../data/emir.jpg. Without --level the
+ * detection level is the first one whose longest side is at most kDetectMaxSide.
  */
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <opencv2/calib3d.hpp>
 #include <opencv2/core.hpp>
 #include <opencv2/features2d.hpp>
+#include <opencv2/flann.hpp>
 #include <opencv2/highgui.hpp>
+#include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc.hpp>
+#include <opencv2/video/tracking.hpp>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "config.pch"  // Defines DATA_DIR macro
+#include "portfolio/image_io.hpp"
 
 static const std::filesystem::path kDefaultInput =
     std::filesystem::path(DATA_DIR) / "../data/emir.jpg";
 static constexpr int kMaxFeatures = 20000;
-static constexpr float kGoodMatchRate = 0.005f;
-
-/**
- * @brief Load an image or exit on failure.
- * @param path Filesystem path to image
- * @param flags imread flags (default: unchanged)
- * @return Loaded cv::Mat
- */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_GRAYSCALE) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-    std::cerr << "ERROR: Failed to load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return img;
-}
+static constexpr float kRatioTest = 0.75f;     ///< Lowe ratio between best and second match
+static constexpr int kDetectMaxSide = 1600;    ///< Longest channel side used for detection
+static constexpr int kEccIterations = 50;
+static constexpr double kEccEpsilon = 1e-6;
 
 /**
  * @brief Display a vector of images in a single window grid.
@@ -73,6 +81,57 @@ void displayGrid(const std::vector<cv::Mat>& images, int rows, int cols,
   cv::destroyWindow(winName);
 }
 
+//--------------------------------------------------------------------------------------
+// Alignment engine
+//--------------------------------------------------------------------------------------
+
+/// Tunables of alignChannels().
+struct AlignOptions {
+  int level = -1;       ///< Pyramid level used for detection, -1 = from kDetectMaxSide
+  bool refine = true;   ///< Refine each homography with ECC at full resolution
+};
+
+/// Keypoints and descriptors of one channel, in the coordinates of its detection level.
+struct ChannelFeatures {
+  cv::Mat image;  ///< Channel at the detection level
+  std::vector<cv::KeyPoint> keypoints;
+  cv::Mat descriptors;
+};
+
+/// Wall time of each stage of alignChannels(), in milliseconds.
+struct AlignTimings {
+  double detect = 0;      ///< Pyramid + ORB, all channels in parallel
+  double match = 0;       ///< LSH index + kNN + ratio test
+  double homography = 0;  ///< RANSAC
+  double refine = 0;      ///< ECC at full resolution
+};
+
+/// Everything alignChannels() estimates: homographies map blue/red onto green.
+struct AlignmentResult {
+  int level = 0;
+  std::array<ChannelFeatures, 3> features;  ///< Blue, green, red
+  std::vector<cv::DMatch> matchesBG, matchesRG;  ///< Query = blue/red, train = green
+  cv::Mat H_BtoG, H_RtoG;
+  bool refinedB = false, refinedR = false;
+  AlignTimings timings;
+};
+
+/// Milliseconds elapsed since @p start.
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+/**
+ * @brief First pyramid level whose longest side is at most @p maxSide.
+ */
+int detectionLevel(const cv::Size& size, int maxSide) {
+  int level = 0;
+  for (int side = std::max(size.width, size.height); side > maxSide; side = (side + 1) / 2)
+    ++level;
+  return level;
+}
+
 /**
  * @brief Detect ORB keypoints and descriptors.
  * @param img Input image
@@ -86,47 +145,525 @@ void detectAndCompute(const cv::Mat& img, std::vector<cv::KeyPoint>& keypoints,
 }
 
 /**
- * @brief Match descriptors and keep the top percentage by score.
- * @param desc1 Descriptors of image 1 (query)
- * @param desc2 Descriptors of image 2 (train)
- * @param matches Output filtered matches
+ * @brief Builds pyramid level @p level of every channel and detects ORB features on it.
+ *
+ * Channels are independent, so each runs in its own parallel_for_ iteration with its own ORB.
  */
-void matchAndFilter(const cv::Mat& desc1, const cv::Mat& desc2, std::vector<cv::DMatch>& matches) {
-  cv::Ptr<cv::DescriptorMatcher> matcher =
-      cv::DescriptorMatcher::create(cv::DescriptorMatcher::BRUTEFORCE_HAMMING);
-  matcher->match(desc1, desc2, matches);
-  std::sort(matches.begin(), matches.end(),
-            [](auto& a, auto& b) { return a.distance < b.distance; });
-  int nGood = static_cast<int>(matches.size() * kGoodMatchRate);
-  matches.resize(std::max(nGood, 1));
+void detectPyramidFeatures(const std::array<cv::Mat, 3>& channels, int level,
+                           std::array<ChannelFeatures, 3>& features) {
+  cv::parallel_for_(cv::Range(0, 3), [&](const cv::Range& r) {
+    for (int c = r.start; c < r.end; ++c) {
+      cv::Mat img = channels[c];
+      for (int l = 0; l < level; ++l) cv::pyrDown(img, img);
+      features[c].image = img;
+      detectAndCompute(img, features[c].keypoints, features[c].descriptors);
+    }
+  });
+}
+
+/**
+ * @brief Matches @p query against the trained LSH index, keeping matches that pass the ratio
+ *        test.
+ * @param matcher FLANN matcher already trained on the train descriptors
+ * @param query Descriptors to look up
+ * @param matches Output matches (queryIdx into @p query, trainIdx into the index)
+ */
+void matchAndFilter(cv::FlannBasedMatcher& matcher, const cv::Mat& query,
+                    std::vector<cv::DMatch>& matches) {
+  matches.clear();
+  if (query.empty()) return;
+  std::vector<std::vector<cv::DMatch>> knn;
+  matcher.knnMatch(query, knn, 2);
+  for (const auto& m : knn) {
+    // LSH may return a single neighbour; it cannot be disambiguated, so skip it
+    if (m.size() == 2 && m[0].distance < kRatioTest * m[1].distance) matches.push_back(m[0]);
+  }
 }
 
 /**
  * @brief Compute homography from matched keypoints.
- * @param kp1 Keypoints of image 1 (query)
- * @param kp2 Keypoints of image 2 (train)
+ * @param kpSrc Keypoints of the image being mapped (query)
+ * @param kpDst Keypoints of the reference image (train)
  * @param matches Filtered matches
- * @return 3x3 homography matrix
+ * @return 3x3 homography mapping src onto dst, empty if it cannot be estimated
  */
-cv::Mat computeHomography(const std::vector<cv::KeyPoint>& kp1,
-                          const std::vector<cv::KeyPoint>& kp2,
+cv::Mat computeHomography(const std::vector<cv::KeyPoint>& kpSrc,
+                          const std::vector<cv::KeyPoint>& kpDst,
                           const std::vector<cv::DMatch>& matches) {
-  std::vector<cv::Point2f> pts1, pts2;
-  pts1.reserve(matches.size());
-  pts2.reserve(matches.size());
+  if (matches.size() < 4) return {};
+  std::vector<cv::Point2f> ptsSrc, ptsDst;
+  ptsSrc.reserve(matches.size());
+  ptsDst.reserve(matches.size());
   for (const auto& m : matches) {
-    pts1.push_back(kp1[m.queryIdx].pt);
-    pts2.push_back(kp2[m.trainIdx].pt);
+    ptsSrc.push_back(kpSrc[m.queryIdx].pt);
+    ptsDst.push_back(kpDst[m.trainIdx].pt);
+  }
+  return cv::findHomography(ptsSrc, ptsDst, cv::RANSAC);
+}
+
+/**
+ * @brief Converts a homography estimated between images downscaled by @p factor into one between
+ *        the full-resolution images: S·H·S⁻¹ with S = diag(factor, factor, 1).
+ */
+cv::Mat scaleHomography(const cv::Mat& H, double factor) {
+  cv::Mat S = (cv::Mat_<double>(3, 3) << factor, 0, 0, 0, factor, 0, 0, 0, 1);
+  return S * H * S.inv();
+}
+
+/**
+ * @brief Refines @p H (mapping @p input onto @p templ) with ECC at the images' resolution.
+ *
+ * ECC estimates the warp from template to input coordinates, i.e. H⁻¹. On failure to converge
+ * @p H is left unchanged.
+ *
+ * @return True if ECC converged
+ */
+bool refineHomographyECC(const cv::Mat& templ, const cv::Mat& input, cv::Mat& H) {
+  cv::Mat inv = H.inv(), warp;
+  inv /= inv.at<double>(2, 2);
+  inv.convertTo(warp, CV_32F);
+  try {
+    cv::findTransformECC(templ, input, warp, cv::MOTION_HOMOGRAPHY,
+                         cv::TermCriteria(cv::TermCriteria::COUNT | cv::TermCriteria::EPS,
+                                          kEccIterations, kEccEpsilon),
+                         cv::noArray(), 5);
+  } catch (const cv::Exception& e) {
+    std::cerr << "WARNING: ECC refinement failed, keeping feature homography: " << e.what()
+              << std::endl;
+    return false;
   }
-  return cv::findHomography(pts2, pts1, cv::RANSAC);
+  cv::Mat refined;
+  warp.convertTo(refined, CV_64F);
+  H = refined.inv();
+  return true;
+}
+
+/**
+ * @brief Estimates the homographies mapping blue and red onto green.
+ *
+ * Features come from a pyramid level (all channels in parallel), matches from one LSH index
+ * built on the green descriptors and queried by blue and red, and the RANSAC homographies are
+ * scaled back to full resolution before the optional ECC refinement there.
+ */
+AlignmentResult alignChannels(const cv::Mat& blue, const cv::Mat& green, const cv::Mat& red,
+                              const AlignOptions& opts) {
+  AlignmentResult res;
+  res.level = opts.level >= 0 ? opts.level : detectionLevel(green.size(), kDetectMaxSide);
+
+  auto t0 = std::chrono::steady_clock::now();
+  detectPyramidFeatures({blue, green, red}, res.level, res.features);
+  res.timings.detect = elapsedMs(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  cv::FlannBasedMatcher matcher(cv::makePtr<cv::flann::LshIndexParams>(12, 20, 2),
+                                cv::makePtr<cv::flann::SearchParams>(50));
+  if (!res.features[1].descriptors.empty()) {
+    matcher.add(std::vector<cv::Mat>{res.features[1].descriptors});
+    matcher.train();
+    matchAndFilter(matcher, res.features[0].descriptors, res.matchesBG);
+    matchAndFilter(matcher, res.features[2].descriptors, res.matchesRG);
+  }
+  res.timings.match = elapsedMs(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  const double factor = static_cast<double>(1 << res.level);
+  auto estimate = [&](int c, const std::vector<cv::DMatch>& matches, const char* name) {
+    cv::Mat H = computeHomography(res.features[c].keypoints, res.features[1].keypoints, matches);
+    if (H.empty()) {
+      std::cerr << "WARNING: Not enough " << name << " matches (" << matches.size()
+                << "), using identity" << std::endl;
+      return cv::Mat(cv::Mat::eye(3, 3, CV_64F));
+    }
+    return scaleHomography(H, factor);
+  };
+  res.H_BtoG = estimate(0, res.matchesBG, "blue");
+  res.H_RtoG = estimate(2, res.matchesRG, "red");
+  res.timings.homography = elapsedMs(t0);
+
+  if (opts.refine) {
+    t0 = std::chrono::steady_clock::now();
+    res.refinedB = refineHomographyECC(green, blue, res.H_BtoG);
+    res.refinedR = refineHomographyECC(green, red, res.H_RtoG);
+    res.timings.refine = elapsedMs(t0);
+  }
+  return res;
+}
+
+/// Prints one "stage  ms" line.
+static void printStage(const std::string& name, double ms) {
+  std::cout << "  " << std::left << std::setw(12) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(10) << ms << " ms" << std::defaultfloat
+            << std::endl;
+}
+
+//--------------------------------------------------------------------------------------
+// Batch mode
+//--------------------------------------------------------------------------------------
+
+/// Paths and limits of the headless batch mode.
+struct BatchOptions {
+  std::filesystem::path inputDir;
+  std::filesystem::path outputDir;
+  int workers = 2;          ///< Plates processed concurrently
+  size_t memoryMB = 4096;   ///< Budget for decoded plates and outputs across all workers
+  int tile = 1024;          ///< Side of the output tiles warped and merged at a time
+  int proxySide = 2400;     ///< Longest channel side of the copy used for estimation
+  bool refine = true;       ///< ECC refinement on the proxy
+};
+
+/**
+ * @brief Parses `--batch <input_dir> <output_dir> [options]`; returns false on bad input.
+ */
+bool parseBatchOptions(int argc, char* argv[], BatchOptions& opts) {
+  if (argc < 4) return false;
+  opts.inputDir = argv[2];
+  opts.outputDir = argv[3];
+  try {
+    for (int i = 4; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--no-refine") {
+        opts.refine = false;
+      } else if (arg == "--workers" && hasValue) {
+        opts.workers = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--memory-mb" && hasValue) {
+        opts.memoryMB = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--tile" && hasValue) {
+        opts.tile = std::max(64, std::stoi(argv[++i]));
+      } else if (arg == "--proxy-side" && hasValue) {
+        opts.proxySide = std::max(256, std::stoi(argv[++i]));
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Counting semaphore over bytes shared by the batch workers.
+ *
+ * A request larger than the whole budget is granted once nothing else is held, so an
+ * oversized plate runs alone instead of deadlocking.
+ */
+class MemoryBudget {
+ public:
+  explicit MemoryBudget(size_t capacity) : capacity_(capacity) {}
+
+  /// Blocks until @p bytes fit; returns the amount actually reserved.
+  size_t acquire(size_t bytes) {
+    bytes = std::min(bytes, capacity_);
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&] { return used_ + bytes <= capacity_; });
+    used_ += bytes;
+    return bytes;
+  }
+
+  void release(size_t bytes) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      used_ -= bytes;
+    }
+    released_.notify_all();
+  }
+
+ private:
+  const size_t capacity_;
+  size_t used_ = 0;
+  std::mutex mutex_;
+  std::condition_variable released_;
+};
+
+/**
+ * @brief Reads the pixel size of an image from its file header, without decoding it.
+ *
+ * Understands JPEG (first SOFn marker), PNG (IHDR), BMP (info header) and classic TIFF (first
+ * IFD), the formats runBatch() accepts.
+ *
+ * @return False if the format is not recognized or the header is malformed.
+ */
+bool readImageSize(const std::filesystem::path& path, cv::Size& size) {
+  static const unsigned char kPngSignature[] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+  std::ifstream in(path, std::ios::binary);
+  unsigned char sig[8] = {};
+  if (!in.read(reinterpret_cast<char*>(sig), sizeof(sig))) return false;
+
+  // Unsigned reads of 1..4 bytes, big or little endian
+  auto read = [&](int bytes, bool bigEndian, uint32_t& v) {
+    unsigned char b[4] = {};
+    if (!in.read(reinterpret_cast<char*>(b), bytes)) return false;
+    v = 0;
+    for (int k = 0; k < bytes; ++k) v |= uint32_t{b[k]} << (8 * (bigEndian ? bytes - 1 - k : k));
+    return true;
+  };
+  uint32_t w = 0, h = 0;
+
+  if (sig[0] == 0xFF && sig[1] == 0xD8) {  // JPEG: walk the markers up to the frame header
+    in.seekg(2);
+    uint32_t byte = 0, len = 0;
+    while (read(1, true, byte)) {
+      if (byte != 0xFF) return false;
+      do {
+        if (!read(1, true, byte)) return false;
+      } while (byte == 0xFF);
+      if (byte == 0x01 || (byte >= 0xD0 && byte <= 0xD8)) continue;  // no length field
+      if (!read(2, true, len) || len < 2) return false;
+      const bool sof = byte >= 0xC0 && byte <= 0xCF && byte != 0xC4 && byte != 0xC8 &&
+                       byte != 0xCC;
+      if (sof) {
+        uint32_t precision = 0;
+        if (!read(1, true, precision) || !read(2, true, h) || !read(2, true, w)) return false;
+        break;
+      }
+      in.seekg(len - 2, std::ios::cur);
+    }
+  } else if (std::equal(sig, sig + 8, kPngSignature)) {  // PNG: IHDR comes first
+    in.seekg(16);
+    if (!read(4, true, w) || !read(4, true, h)) return false;
+  } else if (sig[0] == 'B' && sig[1] == 'M') {  // BMP: core (12 bytes) or info header
+    uint32_t headerSize = 0;
+    in.seekg(14);
+    if (!read(4, false, headerSize)) return false;
+    if (headerSize == 12) {
+      if (!read(2, false, w) || !read(2, false, h)) return false;
+    } else {
+      if (!read(4, false, w) || !read(4, false, h)) return false;
+      h = static_cast<uint32_t>(std::abs(static_cast<int32_t>(h)));  // negative = top-down
+    }
+  } else if ((sig[0] == 'I' && sig[1] == 'I' && sig[2] == 42 && sig[3] == 0) ||
+             (sig[0] == 'M' && sig[1] == 'M' && sig[2] == 0 && sig[3] == 42)) {  // TIFF
+    const bool be = sig[0] == 'M';
+    uint32_t ifd = 0, entries = 0;
+    in.seekg(4);
+    if (!read(4, be, ifd)) return false;
+    in.seekg(ifd);
+    if (!read(2, be, entries)) return false;
+    for (uint32_t e = 0; e < entries && (w == 0 || h == 0); ++e) {
+      uint32_t tag = 0, type = 0, count = 0, value = 0;
+      if (!read(2, be, tag) || !read(2, be, type) || !read(4, be, count)) return false;
+      // SHORT values sit left-justified in the 4-byte value field
+      if (type == 3) {
+        if (!read(2, be, value)) return false;
+        in.seekg(2, std::ios::cur);
+      } else if (!read(4, be, value)) {
+        return false;
+      }
+      if (tag == 256) w = value;
+      if (tag == 257) h = value;
+    }
+  } else {
+    return false;
+  }
+
+  if (w == 0 || h == 0 || w > INT32_MAX || h > INT32_MAX) return false;
+  size = cv::Size(static_cast<int>(w), static_cast<int>(h));
+  return true;
+}
+
+/// Wall time of each stage of one plate, in milliseconds.
+struct PlateTimings {
+  double wait = 0;      ///< Blocked on the memory budget
+  double decode = 0;
+  double estimate = 0;  ///< Proxy + alignChannels()
+  double warp = 0;      ///< Tiled warp + merge
+  double encode = 0;
+
+  void merge(const PlateTimings& o) {
+    wait += o.wait;
+    decode += o.decode;
+    estimate += o.estimate;
+    warp += o.warp;
+    encode += o.encode;
+  }
+};
+
+/**
+ * @brief Warps blue and red with their homographies and merges them with green into @p out,
+ *        one @p tile × @p tile block at a time.
+ *
+ * For a tile at origin o, warping with T(−o)·H renders exactly that block, so the only
+ * full-resolution buffers are the input channels and the BGR output itself.
+ */
+void warpMergeTiled(const cv::Mat& blue, const cv::Mat& green, const cv::Mat& red,
+                    const cv::Mat& H_BtoG, const cv::Mat& H_RtoG, int tile, cv::Mat& out) {
+  out.create(green.size(), CV_8UC3);
+  cv::Mat tileB, tileR;
+  const int fromTo[] = {0, 0, 1, 1, 2, 2};
+  for (int y = 0; y < green.rows; y += tile) {
+    for (int x = 0; x < green.cols; x += tile) {
+      const cv::Rect r = cv::Rect(x, y, tile, tile) & cv::Rect(0, 0, green.cols, green.rows);
+      const cv::Mat T = (cv::Mat_<double>(3, 3) << 1, 0, -x, 0, 1, -y, 0, 0, 1);
+      cv::warpPerspective(blue, tileB, T * H_BtoG, r.size());
+      cv::warpPerspective(red, tileR, T * H_RtoG, r.size());
+      const cv::Mat src[] = {tileB, green(r), tileR};
+      cv::Mat dst = out(r);
+      cv::mixChannels(src, 3, &dst, 1, fromTo, 3);
+    }
+  }
+}
+
+/**
+ * @brief Aligns every stacked plate of a directory without any window.
+ *
+ * Each worker takes the next plate, reads its size from the file header (readImageSize()),
+ * reserves the plate plus its output from the shared MemoryBudget, then decodes it at full
+ * resolution; nothing is decoded outside a reservation.
+ * Homographies are estimated on a proxy whose longest side is `proxySide` and scaled up; the
+ * full-resolution output is produced by warpMergeTiled() and written before the reservation is
+ * released.
+ *
+ * @return EXIT_SUCCESS if every plate was written.
+ */
+int runBatch(const BatchOptions& opts) {
+  std::vector<std::filesystem::path> plates;
+  std::error_code ec;
+  for (const auto& entry : std::filesystem::directory_iterator(opts.inputDir, ec)) {
+    const std::string ext = entry.path().extension().string();
+    if (entry.is_regular_file() && (ext == ".jpg" || ext == ".jpeg" || ext == ".png" ||
+                                    ext == ".tif" || ext == ".tiff" || ext == ".bmp")) {
+      plates.push_back(entry.path());
+    }
+  }
+  if (ec) {
+    std::cerr << "ERROR: Cannot read directory " << opts.inputDir << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::sort(plates.begin(), plates.end());
+  std::filesystem::create_directories(opts.outputDir, ec);
+
+  // Plates run concurrently; nested OpenCV threads would only oversubscribe
+  if (opts.workers > 1) cv::setNumThreads(1);
+
+  MemoryBudget budget(opts.memoryMB << 20);
+  std::atomic<size_t> next{0};
+  std::atomic<int> written{0}, failed{0};
+  std::vector<PlateTimings> perWorker(opts.workers);
+  std::mutex logMutex;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> workers;
+  for (int wkr = 0; wkr < opts.workers; ++wkr) {
+    workers.emplace_back([&, wkr] {
+      for (size_t i = next++; i < plates.size(); i = next++) {
+        const auto& path = plates[i];
+        PlateTimings t;
+
+        // Reserve stacked input + BGR output (same byte count) + tile scratch. A plate whose
+        // header cannot be read reserves the whole budget, so its decode still runs alone.
+        auto t0 = std::chrono::steady_clock::now();
+        cv::Size plateSize;
+        const size_t plateBytes = readImageSize(path, plateSize)
+                                      ? static_cast<size_t>(plateSize.width) * plateSize.height
+                                      : SIZE_MAX / 4;
+        const size_t tileBytes = static_cast<size_t>(opts.tile) * opts.tile * 3;
+        const size_t reserved = budget.acquire(2 * plateBytes + tileBytes);
+        t.wait = elapsedMs(t0);
+
+        bool ok = false;
+        cv::Mat H_BtoG, H_RtoG;
+        try {
+          t0 = std::chrono::steady_clock::now();
+          cv::Mat stacked = cv::imread(path.string(), cv::IMREAD_GRAYSCALE);
+          t.decode = elapsedMs(t0);
+          if (stacked.rows >= 3) {
+            const int h = stacked.rows / 3, w = stacked.cols;
+            const cv::Mat blue = stacked(cv::Rect(0, 0, w, h));
+            const cv::Mat green = stacked(cv::Rect(0, h, w, h));
+            const cv::Mat red = stacked(cv::Rect(0, 2 * h, w, h));
+
+            // Estimate on the proxy, then scale to full resolution
+            t0 = std::chrono::steady_clock::now();
+            const double scale =
+                std::min(1.0, static_cast<double>(opts.proxySide) / std::max(w, h));
+            std::array<cv::Mat, 3> proxy;
+            const cv::Mat* channels[] = {&blue, &green, &red};
+            for (int c = 0; c < 3; ++c) {
+              if (scale < 1.0)
+                cv::resize(*channels[c], proxy[c], cv::Size(), scale, scale, cv::INTER_AREA);
+              else
+                proxy[c] = *channels[c];
+            }
+            AlignOptions align;
+            align.refine = opts.refine;
+            AlignmentResult res = alignChannels(proxy[0], proxy[1], proxy[2], align);
+            H_BtoG = scaleHomography(res.H_BtoG, 1.0 / scale);
+            H_RtoG = scaleHomography(res.H_RtoG, 1.0 / scale);
+            t.estimate = elapsedMs(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            cv::Mat aligned;
+            warpMergeTiled(blue, green, red, H_BtoG, H_RtoG, opts.tile, aligned);
+            t.warp = elapsedMs(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            const auto out = opts.outputDir / path.filename();
+            ok = cv::imwrite(out.string(), aligned);
+            t.encode = elapsedMs(t0);
+            if (!ok) std::cerr << "ERROR: Failed to save image: " << out << std::endl;
+          } else {
+            std::cerr << "ERROR: Failed to load image: " << path << std::endl;
+          }
+        } catch (const cv::Exception& e) {
+          std::cerr << "ERROR: " << path << ": " << e.what() << std::endl;
+        }
+        budget.release(reserved);
+
+        (ok ? written : failed) += 1;
+        perWorker[wkr].merge(t);
+        std::lock_guard<std::mutex> lock(logMutex);
+        std::cout << path.filename().string() << std::fixed << std::setprecision(1)
+                  << ": wait " << t.wait << " ms, decode " << t.decode << " ms, estimate "
+                  << t.estimate << " ms, warp " << t.warp << " ms, encode " << t.encode
+                  << " ms" << std::defaultfloat << std::endl;
+      }
+    });
+  }
+  for (auto& th : workers) th.join();
+
+  PlateTimings total;
+  for (const auto& t : perWorker) total.merge(t);
+  const double wallMs = elapsedMs(start);
+  std::cout << "Aligned " << written << " of " << plates.size() << " plates in "
+            << wallMs / 1000.0 << " s with " << opts.workers << " workers ("
+            << written * 60000.0 / std::max(wallMs, 1e-9) << " plates/min)" << std::endl;
+  printStage("wait", total.wait);
+  printStage("decode", total.decode);
+  printStage("estimate", total.estimate);
+  printStage("warp+merge", total.warp);
+  printStage("encode", total.encode);
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
 int main(int argc, char* argv[]) {
-  // Determine input path
-  std::filesystem::path inputPath = (argc > 1) ? argv[1] : kDefaultInput;
+  // Headless batch mode
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    BatchOptions opts;
+    if (!parseBatchOptions(argc, argv, opts)) {
+      std::cerr << "Usage: " << argv[0] << " --batch <input_dir> <output_dir> [--workers N]"
+                << " [--memory-mb N] [--tile N] [--proxy-side N] [--no-refine]" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return runBatch(opts);
+  }
+
+  // Parse options
+  std::filesystem::path inputPath = kDefaultInput;
+  AlignOptions opts;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    if (arg == "--level" && i + 1 < argc) {
+      opts.level = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--no-refine") {
+      opts.refine = false;
+    } else {
+      inputPath = arg;
+    }
+  }
 
   // Load grayscale image with three stacked channels
-  cv::Mat stacked = loadImageOrExit(inputPath);
+  cv::Mat stacked = portfolio::loadImageOrExit(inputPath, cv::IMREAD_GRAYSCALE);
 
   int h = stacked.rows / 3;
   int w = stacked.cols;
@@ -137,39 +674,42 @@ int main(int argc, char* argv[]) {
   cv::Mat red = stacked(cv::Rect(0, 2 * h, w, h));
   displayGrid({blue, green, red}, 1, 3, "Channels");
 
-  // Detect and compute features
-  std::vector<cv::KeyPoint> kpB, kpG, kpR;
-  cv::Mat descB, descG, descR;
-  detectAndCompute(blue, kpB, descB);
-  detectAndCompute(green, kpG, descG);
-  detectAndCompute(red, kpR, descR);
+  // Detect, match, estimate and refine
+  AlignmentResult res = alignChannels(blue, green, red, opts);
+  const auto& [fB, fG, fR] = res.features;
 
-  // Draw keypoints
+  // Draw keypoints (detection level)
   cv::Mat imKB, imKG, imKR;
-  cv::drawKeypoints(blue, kpB, imKB, cv::Scalar(255));
-  cv::drawKeypoints(green, kpG, imKG, cv::Scalar(0, 255));
-  cv::drawKeypoints(red, kpR, imKR, cv::Scalar(0, 0, 255));
+  cv::drawKeypoints(fB.image, fB.keypoints, imKB, cv::Scalar(255));
+  cv::drawKeypoints(fG.image, fG.keypoints, imKG, cv::Scalar(0, 255));
+  cv::drawKeypoints(fR.image, fR.keypoints, imKR, cv::Scalar(0, 0, 255));
   displayGrid({imKB, imKG, imKR}, 1, 3, "Keypoints");
 
-  // Match and filter
-  std::vector<cv::DMatch> matchesBG, matchesRG;
-  matchAndFilter(descG, descB, matchesBG);
-  matchAndFilter(descG, descR, matchesRG);
-
   // Draw matches
   cv::Mat mBG, mRG;
-  cv::drawMatches(green, kpG, blue, kpB, matchesBG, mBG);
-  cv::drawMatches(green, kpG, red, kpR, matchesRG, mRG);
-  displayGrid({mBG, mRG}, 1, 2, "Matches G-B | G-R");
-
-  // Compute homographies
-  cv::Mat H_BtoG = computeHomography(kpG, kpB, matchesBG);
-  cv::Mat H_RtoG = computeHomography(kpG, kpR, matchesRG);
+  cv::drawMatches(fB.image, fB.keypoints, fG.image, fG.keypoints, res.matchesBG, mBG);
+  cv::drawMatches(fR.image, fR.keypoints, fG.image, fG.keypoints, res.matchesRG, mRG);
+  displayGrid({mBG, mRG}, 1, 2, "Matches B-G | R-G");
 
   // Warp channels
+  auto t0 = std::chrono::steady_clock::now();
   cv::Mat blueWarp, redWarp;
-  cv::warpPerspective(blue, blueWarp, H_BtoG, cv::Size(w, h));
-  cv::warpPerspective(red, redWarp, H_RtoG, cv::Size(w, h));
+  cv::warpPerspective(blue, blueWarp, res.H_BtoG, cv::Size(w, h));
+  cv::warpPerspective(red, redWarp, res.H_RtoG, cv::Size(w, h));
+  const double warpMs = elapsedMs(t0);
+
+  std::cout << "Channels " << w << "x" << h << ", detection level " << res.level << " ("
+            << fG.image.cols << "x" << fG.image.rows << "), keypoints B/G/R "
+            << fB.keypoints.size() << "/" << fG.keypoints.size() << "/" << fR.keypoints.size()
+            << ", matches B-G " << res.matchesBG.size() << ", R-G " << res.matchesRG.size()
+            << ", ECC " << (opts.refine ? (res.refinedB && res.refinedR ? "ok" : "partial")
+                                        : "off")
+            << std::endl;
+  printStage("detect", res.timings.detect);
+  printStage("match", res.timings.match);
+  printStage("homography", res.timings.homography);
+  printStage("refine", res.timings.refine);
+  printStage("warp", warpMs);
   displayGrid({blueWarp, redWarp}, 1, 2, "Warped Channels");
 
   // Merge and compare
@@ -180,4 +720,4 @@ int main(int argc, char* argv[]) {
   displayGrid({mergedOriginal, mergedAligned}, 1, 2, "Original vs Aligned");
 
   return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
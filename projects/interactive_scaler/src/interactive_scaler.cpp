@@ -10,6 +10,10 @@
  *
  * If no input is provided, defaults to DATA_DIR + "/truth.png".
  * If no output is provided, saves to "scaled_output.png" in current directory when pressing 's'.
+ *
+ * The window shows a viewport of at most 1200×900 into the scaled image, rendered from a mip
+ * pyramid (portfolio::PreviewEngine); drag with the left button to pan. The full-resolution
+ * resize runs only when saving.
  */
 
 #include <filesystem>
@@ -19,6 +23,8 @@
 #include <vector>
 
 #include "config.pch"  // defines DATA_DIR as a string literal
+#include "portfolio/image_io.hpp"
+#include "portfolio/preview_engine.hpp"
 
 // Global constants and variables
 static const std::filesystem::path kDefaultInput =
@@ -26,55 +32,61 @@ static const std::filesystem::path kDefaultInput =
 static const int kMaxScale = 100;  ///< Trackbar max value for scale percentage
 static const int kMaxType = 1;     ///< 0: Scale up, 1: Scale down
 
-static cv::Mat originalImage;  ///< The loaded original image
-static cv::Mat currentScaled;  ///< The most recent scaled image
+static cv::Mat originalImage;           ///< The loaded original image
+static portfolio::PreviewEngine preview;  ///< Viewport into the scaled image
 static std::string windowName = "Resize Image";
 static int scalePercent = 0;              ///< Trackbar position (0..kMaxScale)
 static int scaleType = 0;                 ///< Trackbar position (0 or 1)
 static std::filesystem::path outputPath;  ///< Where to save when user presses 's'
+static cv::Point dragOrigin;              ///< Last mouse position while panning
+static bool dragging = false;
 
 /**
- * @brief Loads an image and exits if it fails.
- * @param path   Filesystem path to load
- * @param flags  imread flags (default: IMREAD_UNCHANGED)
- * @return cv::Mat loaded image
+ * @brief Scale factor selected by the trackbars: up or down.
  */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-    std::cerr << "ERROR: Could not load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return img;
+double currentFactor() {
+  return (scaleType == 0) ? (1.0 + scalePercent / 100.0)
+                          : std::max(0.01, 1.0 - scalePercent / 100.0);
 }
 
 /**
- * @brief Saves an image and exits if it fails.
- * @param path    Destination path
- * @param image   cv::Mat to write
- * @param params  Optional imwrite parameters
+ * @brief Callback for trackbar events: changes the preview zoom (only the viewport is rendered).
+ * @param, void*  Unused
+ */
+void onScaleChange(int, void*) { preview.setZoom(currentFactor()); }
+
+/**
+ * @brief Mouse callback: left-button drag pans the viewport.
  */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Failed to save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
+void onMouse(int event, int x, int y, int /*flags*/, void* /*userdata*/) {
+  switch (event) {
+    case cv::EVENT_LBUTTONDOWN:
+      dragging = true;
+      dragOrigin = {x, y};
+      break;
+    case cv::EVENT_MOUSEMOVE:
+      if (dragging) {
+        preview.panBy(cv::Point2d(x - dragOrigin.x, y - dragOrigin.y));
+        dragOrigin = {x, y};
+      }
+      break;
+    case cv::EVENT_LBUTTONUP:
+      dragging = false;
+      break;
+    default:
+      break;
   }
-  std::cout << "Saved scaled image to: " << path << std::endl;
 }
 
 /**
- * @brief Callback for trackbar events: rescales and displays the image.
- * @param, void*  Unused
+ * @brief Resizes the full-resolution original with the current factor and saves it.
  */
-void onScaleChange(int, void*) {
-  // Determine scale factor: up or down
-  double factor =
-      (scaleType == 0) ? (1.0 + scalePercent / 100.0) : std::max(0.01, 1.0 - scalePercent / 100.0);
-
-  // Resize with INTER_LINEAR interpolation
-  cv::resize(originalImage, currentScaled, cv::Size(), factor, factor, cv::INTER_LINEAR);
-  cv::imshow(windowName, currentScaled);
+void saveScaled() {
+  const double factor = currentFactor();
+  cv::Mat scaled;
+  cv::resize(originalImage, scaled, cv::Size(), factor, factor, cv::INTER_LINEAR);
+  portfolio::saveImageOrExit(outputPath, scaled, {cv::IMWRITE_PNG_COMPRESSION, 3});
+  std::cout << "Saved scaled image to: " << outputPath << std::endl;
 }
 
 int main(int argc, char* argv[]) {
@@ -83,26 +95,29 @@ int main(int argc, char* argv[]) {
   outputPath =
       (argc > 2 ? std::filesystem::path(argv[2]) : std::filesystem::path("scaled_output.png"));
 
-  // Load image
-  originalImage = loadImageOrExit(inputPath);
+  // Load image and build its preview pyramid
+  originalImage = portfolio::loadImageOrExit(inputPath);
+  preview.reset(originalImage);
 
   // Create display window and sliders
   cv::namedWindow(windowName, cv::WINDOW_AUTOSIZE);
   cv::createTrackbar("Scale (%)", windowName, &scalePercent, kMaxScale, onScaleChange);
   cv::createTrackbar("Mode (0=up,1=down)", windowName, &scaleType, kMaxType, onScaleChange);
+  cv::setMouseCallback(windowName, onMouse);
 
   // Initial display
   onScaleChange(0, nullptr);
-  std::cout << "Press 's' to save, ESC to exit." << std::endl;
+  std::cout << "Press 's' to save, ESC to exit. Drag to pan." << std::endl;
 
-  // Event loop
+  // Event loop: redraw only when the zoom or pan changed
   while (true) {
+    if (preview.render()) cv::imshow(windowName, preview.frame());
     int key = cv::waitKey(20);
     if (key == 27) {  // ESC
       break;
     }
     if (key == 's' || key == 'S') {
-      saveImageOrExit(outputPath, currentScaled, {cv::IMWRITE_PNG_COMPRESSION, 3});
+      saveScaled();
     }
   }
   return 0;
@@ -9,50 +9,79 @@
  *  3. Uses OpenCV's Stitcher to stitch the images into a single panorama.
  *  4. Writes the stitched panorama to the output file.
  *  5. Reports any errors encountered during processing.
+ *
+ * With --bounded, the high-level Stitcher is replaced by a pipeline built from the
+ * cv::detail stages that never holds more than the shots overlapping one region at full or
+ * warped resolution: images are decoded one at a time to build registration/seam proxies,
+ * seams and gains are found pair by pair, and the panorama is composed tile by tile,
+ * re-reading only the sources that overlap the current tile.
+ *
+ * The bounded pipeline can keep its features, seam proxies and pairwise matches in an on-disk
+ * cache (--cache DIR), so re-running on a grown set only processes the new images and pairs.
+ * --range N matches each image only with its N successors in file order (both modes).
+ * --compare-single also composes the bounded panorama with one blender, as cv::Stitcher does,
+ * and prints how much the tiled composition differs from it.
+ *
+ * Usage:
+ *   ./panorama_stitching [input_dir] [--ext .jpeg] [--output file] [--registration-mp X]
+ *                        [--seam-mp X] [--compositing-mp X] [--range N] [--bounded]
+ *                        [--tile N] [--cache DIR] [--compare-single]
+ *
+ * Resolutions are in megapixels; a negative compositing resolution keeps the original size.
  */
 
 #include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <map>
 #include <opencv2/opencv.hpp>
+#include <opencv2/stitching/detail/autocalib.hpp>
+#include <opencv2/stitching/detail/blenders.hpp>
+#include <opencv2/stitching/detail/exposure_compensate.hpp>
+#include <opencv2/stitching/detail/matchers.hpp>
+#include <opencv2/stitching/detail/motion_estimators.hpp>
+#include <opencv2/stitching/detail/seam_finders.hpp>
+#include <opencv2/stitching/detail/util.hpp>
+#include <opencv2/stitching/detail/warpers.hpp>
+#include <opencv2/stitching/warpers.hpp>
+#include <string>
 #include <vector>
 
 #include "config.pch"
+#include "portfolio/image_io.hpp"
 
 static const std::string kDataDir = DATA_DIR;       ///< Base data directory (defined in config.pch)
 static const std::string kInputSubdir = "scene";    ///< Subdirectory under data directory to scan
 static const std::string kFileExtension = ".jpeg";  ///< Target image file extension
 static const std::string kOutputFilename = "panorama.jpg";  ///< Output panorama filename
 
-/**
- * @brief Loads an image from disk, exiting on failure.
- * @param path Full path to the image file.
- * @param flags Imread flags (default: IMREAD_UNCHANGED).
- * @return Loaded cv::Mat image.
- */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat image = cv::imread(path.string(), flags);
-  if (image.empty()) {
-    std::cerr << "ERROR: Failed to load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return image;
-}
+static constexpr float kMatchConfidence = 0.3f;  ///< BestOf2NearestMatcher threshold (ORB)
+static constexpr double kConfidenceThresh = 1.0;  ///< Pairs kept in the biggest component
+static constexpr float kBlendStrength = 5.f;  ///< Multi-band blend width, % of panorama size
+static constexpr int kMaxBlendBands = 5;  ///< Band cap (MultiBandBlender default), fixes tile pad
+static constexpr double kAssembleMaxMegapix = 150.0;  ///< Larger panoramas stay as tiles
+static constexpr int kOrbFeatures = 500;  ///< ORB budget per image (Stitcher default)
 
-/**
- * @brief Saves an image to disk, exiting on failure.
- * @param path Full path where the image will be written.
- * @param image The cv::Mat image to save.
- * @param params Optional imwrite parameters (e.g., compression level).
- */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Failed to save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-}
+/// Command-line settings shared by both stitching modes.
+struct StitchOptions {
+  std::filesystem::path inputDir;
+  std::string extension = kFileExtension;
+  std::filesystem::path output;
+  double registrationMP = 0.6;  ///< Feature/registration resolution (Stitcher default)
+  double seamMP = 0.1;          ///< Seam estimation resolution (Stitcher default)
+  double compositingMP = -1.0;  ///< Compositing resolution, < 0 keeps the original size
+  bool bounded = false;         ///< Use the memory-bounded tiled pipeline
+  bool compareSingle = false;   ///< Also compose with one blender and report the difference
+  int tileSize = 2048;          ///< Tile side of the bounded compositor, pixels
+  int matchRange = 0;           ///< Match only images at most this far apart, 0 = all pairs
+  std::filesystem::path cacheDir;  ///< Feature/match cache of the bounded mode, empty = off
+};
 
 /**
  * @brief Retrieves all regular files with a specified extension in a directory.
@@ -79,20 +108,800 @@ void collectImageFiles(const std::filesystem::path& directory, const std::string
   }
 }
 
-int main() {
-  // Build full input directory path
-  std::filesystem::path inputDir = std::filesystem::path{kDataDir} / kInputSubdir;
+/// Milliseconds elapsed since @p start.
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+//--------------------------------------------------------------------------------------
+// Memory-bounded pipeline
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief Per-image state of the bounded pipeline. No full-resolution pixels are kept; for
+ *        compositing the source is decoded again from @p path.
+ */
+struct BoundedImage {
+  std::filesystem::path path;
+  std::string hash;  ///< Content hash, set when the cache is enabled
+  cv::Size fullSize;
+  cv::detail::ImageFeatures features;  ///< Registration-scale features
+  cv::Mat seamImage;                   ///< Seam-scale proxy, released after seam estimation
+  cv::Mat seamMask;                    ///< Warped seam mask at seam scale
+  cv::detail::CameraParams camera;
+  cv::Rect composeRoi;  ///< Warped footprint in panorama coordinates at compositing scale
+};
+
+/// Resolution scale that brings @p size down to @p megapix (1 if already smaller or mp < 0).
+static double scaleFor(const cv::Size& size, double megapix) {
+  if (megapix <= 0) return 1.0;
+  return std::min(1.0, std::sqrt(megapix * 1e6 / size.area()));
+}
+
+/// Intrinsics of @p camera as CV_32F, as the warpers expect.
+static cv::Mat intrinsics32F(const cv::detail::CameraParams& camera) {
+  cv::Mat K;
+  camera.K().convertTo(K, CV_32F);
+  return K;
+}
+
+//--------------------------------------------------------------------------------------
+// Feature / match cache
+//--------------------------------------------------------------------------------------
+
+/**
+ * @brief 64-bit FNV-1a hash of a file's content, as 16 hex digits; empty if unreadable.
+ */
+std::string hashFile(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return {};
+  std::uint64_t h = 14695981039346656037ull;
+  std::vector<char> buffer(1 << 20);
+  while (in) {
+    in.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    for (std::streamsize i = 0; i < in.gcount(); ++i) {
+      h ^= static_cast<unsigned char>(buffer[i]);
+      h *= 1099511628211ull;
+    }
+  }
+  return cv::format("%016llx", static_cast<unsigned long long>(h));
+}
+
+/**
+ * @brief Cache directory layout. Entries are named after the content hash of their image(s)
+ *        and the settings that produced them, so edited images or changed settings miss
+ *        instead of returning stale data.
+ */
+struct StitchCache {
+  std::filesystem::path dir;
+  std::string settings;  ///< Detector, matcher and resolution settings
+
+  explicit StitchCache(const StitchOptions& opts)
+      : dir(opts.cacheDir),
+        settings(cv::format("orb%d_r%.3f_s%.3f_c%.2f", kOrbFeatures, opts.registrationMP,
+                            opts.seamMP, kMatchConfidence)) {}
+
+  bool enabled() const { return !dir.empty(); }
+  std::filesystem::path featurePath(const std::string& hash) const {
+    return dir / (hash + "_" + settings + ".features.yml.gz");
+  }
+  std::filesystem::path seamPath(const std::string& hash) const {
+    return dir / (hash + "_" + settings + ".seam.png");
+  }
+  std::filesystem::path matchPath(const std::string& from, const std::string& to) const {
+    return dir / (from + "_" + to + "_" + settings + ".matches.yml.gz");
+  }
+};
+
+/**
+ * @brief Loads the features and seam proxy of @p image.hash.
+ * @param workScale Registration scale the entry must have been computed with; < 0 accepts the
+ *        stored one and returns it (together with @p seamScale)
+ * @return False on a miss or a scale mismatch
+ */
+bool loadCachedImage(const StitchCache& cache, BoundedImage& image, double& workScale,
+                     double& seamScale) {
+  cv::FileStorage fs;
+  try {
+    if (!fs.open(cache.featurePath(image.hash).string(), cv::FileStorage::READ)) return false;
+    double storedWork = -1, storedSeam = -1;
+    fs["work_scale"] >> storedWork;
+    fs["seam_scale"] >> storedSeam;
+    if (workScale >= 0 &&
+        (std::abs(storedWork - workScale) > 1e-9 || std::abs(storedSeam - seamScale) > 1e-9))
+      return false;
+    cv::Mat descriptors;
+    fs["full_size"] >> image.fullSize;
+    fs["img_size"] >> image.features.img_size;
+    fs["keypoints"] >> image.features.keypoints;
+    fs["descriptors"] >> descriptors;
+    image.features.descriptors = descriptors.getUMat(cv::ACCESS_READ).clone();
+    image.seamImage = cv::imread(cache.seamPath(image.hash).string(), cv::IMREAD_COLOR);
+    if (image.seamImage.empty() || image.fullSize.empty()) return false;
+    workScale = storedWork;
+    seamScale = storedSeam;
+  } catch (const cv::Exception&) {
+    return false;  // corrupt entry: recompute and overwrite
+  }
+  return true;
+}
+
+void saveCachedImage(const StitchCache& cache, const BoundedImage& image, double workScale,
+                     double seamScale) {
+  cv::FileStorage fs(cache.featurePath(image.hash).string(), cv::FileStorage::WRITE);
+  fs << "work_scale" << workScale << "seam_scale" << seamScale;
+  fs << "full_size" << image.fullSize << "img_size" << image.features.img_size;
+  cv::write(fs, "keypoints", image.features.keypoints);
+  fs << "descriptors" << image.features.descriptors.getMat(cv::ACCESS_READ);
+  cv::imwrite(cache.seamPath(image.hash).string(), image.seamImage);
+}
+
+/// Loads the matches of (@p from → @p to); indices are filled in by the caller.
+bool loadCachedMatch(const StitchCache& cache, const std::string& from, const std::string& to,
+                     cv::detail::MatchesInfo& info) {
+  cv::FileStorage fs;
+  try {
+    if (!fs.open(cache.matchPath(from, to).string(), cv::FileStorage::READ)) return false;
+    fs["matches"] >> info.matches;
+    fs["inliers_mask"] >> info.inliers_mask;
+    fs["num_inliers"] >> info.num_inliers;
+    fs["H"] >> info.H;
+    fs["confidence"] >> info.confidence;
+  } catch (const cv::Exception&) {
+    return false;
+  }
+  return true;
+}
+
+void saveCachedMatch(const StitchCache& cache, const std::string& from, const std::string& to,
+                     const cv::detail::MatchesInfo& info) {
+  cv::FileStorage fs(cache.matchPath(from, to).string(), cv::FileStorage::WRITE);
+  cv::write(fs, "matches", info.matches);
+  fs << "inliers_mask" << info.inliers_mask << "num_inliers" << info.num_inliers << "H"
+     << info.H << "confidence" << info.confidence;
+}
+
+/// The (to → from) counterpart of @p info, as FeaturesMatcher stores it.
+cv::detail::MatchesInfo reverseMatches(const cv::detail::MatchesInfo& info) {
+  cv::detail::MatchesInfo dual = info;
+  std::swap(dual.src_img_idx, dual.dst_img_idx);
+  if (!info.H.empty()) dual.H = info.H.inv();
+  for (auto& m : dual.matches) std::swap(m.queryIdx, m.trainIdx);
+  return dual;
+}
+
+/**
+ * @brief Decodes every image once to compute registration features and a seam-scale proxy.
+ *
+ * Scales are derived from the first readable image, as the Stitcher does. Only one full image
+ * is alive at a time.
+ */
+bool buildProxies(const std::vector<std::filesystem::path>& files, const StitchOptions& opts,
+                  const StitchCache& cache, std::vector<BoundedImage>& images, double& workScale,
+                  double& seamScale) {
+  cv::Ptr<cv::Feature2D> finder = cv::ORB::create(kOrbFeatures);
+  images.clear();
+  workScale = seamScale = -1;
+  int hits = 0;
+  for (const auto& path : files) {
+    // Cached images need no decode at all
+    std::string hash;
+    if (cache.enabled()) {
+      BoundedImage cached;
+      cached.path = path;
+      cached.hash = hash = hashFile(path);
+      if (!hash.empty() && loadCachedImage(cache, cached, workScale, seamScale)) {
+        cached.features.img_idx = static_cast<int>(images.size());
+        images.push_back(std::move(cached));
+        ++hits;
+        continue;
+      }
+    }
+
+    cv::Mat full = cv::imread(path.string());
+    if (full.empty()) {
+      std::cerr << "WARNING: Skipping invalid image: " << path << std::endl;
+      continue;
+    }
+    if (workScale < 0) {
+      workScale = scaleFor(full.size(), opts.registrationMP);
+      seamScale = scaleFor(full.size(), opts.seamMP);
+    }
+    BoundedImage image;
+    image.path = path;
+    image.hash = hash;
+    image.fullSize = full.size();
+    cv::Mat work;
+    cv::resize(full, work, cv::Size(), workScale, workScale, cv::INTER_LINEAR_EXACT);
+    cv::detail::computeImageFeatures(finder, work, image.features);
+    image.features.img_idx = static_cast<int>(images.size());
+    cv::resize(full, image.seamImage, cv::Size(), seamScale, seamScale, cv::INTER_LINEAR_EXACT);
+    if (!image.hash.empty()) saveCachedImage(cache, image, workScale, seamScale);
+    images.push_back(std::move(image));
+  }
+  if (cache.enabled()) {
+    std::cout << "Features: " << hits << " of " << images.size() << " images from cache"
+              << std::endl;
+  }
+  return images.size() >= 2;
+}
+
+/**
+ * @brief Pairwise matching restricted to the pairs allowed by `matchRange`; cached pairs are
+ *        loaded, the others computed in one masked matcher call and stored.
+ * @param pairwise Output in FeaturesMatcher layout: n×n entries, both directions filled
+ */
+void matchPairs(const std::vector<BoundedImage>& images,
+                const std::vector<cv::detail::ImageFeatures>& features, const StitchOptions& opts,
+                const StitchCache& cache, std::vector<cv::detail::MatchesInfo>& pairwise) {
+  const int n = static_cast<int>(features.size());
+  cv::Mat_<uchar> todo(n, n, static_cast<uchar>(0));
+  std::vector<std::pair<int, int>> cachedPairs;
+  std::vector<cv::detail::MatchesInfo> cachedInfos;
+  int computed = 0;
+  for (int i = 0; i < n; ++i) {
+    for (int j = i + 1; j < n; ++j) {
+      if (opts.matchRange > 0 && j - i > opts.matchRange) continue;
+      cv::detail::MatchesInfo info;
+      if (cache.enabled() && !images[i].hash.empty() && !images[j].hash.empty() &&
+          loadCachedMatch(cache, images[i].hash, images[j].hash, info)) {
+        cachedPairs.emplace_back(i, j);
+        cachedInfos.push_back(std::move(info));
+      } else {
+        todo(i, j) = 1;
+        ++computed;
+      }
+    }
+  }
+
+  if (computed > 0) {
+    cv::detail::BestOf2NearestMatcher matcher(false, kMatchConfidence);
+    matcher(features, pairwise, todo.getUMat(cv::ACCESS_READ));
+    matcher.collectGarbage();
+  } else {
+    pairwise.assign(static_cast<size_t>(n) * n, cv::detail::MatchesInfo());
+  }
+
+  for (int i = 0; i < n; ++i) {
+    for (int j = i + 1; j < n; ++j) {
+      if (todo(i, j) && !images[i].hash.empty() && !images[j].hash.empty())
+        saveCachedMatch(cache, images[i].hash, images[j].hash, pairwise[i * n + j]);
+    }
+  }
+  for (size_t k = 0; k < cachedPairs.size(); ++k) {
+    const auto [i, j] = cachedPairs[k];
+    cv::detail::MatchesInfo& info = pairwise[i * n + j];
+    info = cachedInfos[k];
+    info.src_img_idx = i;
+    info.dst_img_idx = j;
+    pairwise[j * n + i] = reverseMatches(info);
+  }
+  if (cache.enabled() || opts.matchRange > 0) {
+    std::cout << "Matches: " << computed << " pairs computed, " << cachedPairs.size()
+              << " from cache" << std::endl;
+  }
+}
+
+/**
+ * @brief Matches all pairs, keeps the biggest connected component, and estimates and
+ *        bundle-adjusts the cameras.
+ * @param images Reduced in place to the images of the biggest component
+ * @param warpedScale Output: median focal length, the warper scale at registration resolution
+ */
+bool estimateCameras(std::vector<BoundedImage>& images, const StitchOptions& opts,
+                     const StitchCache& cache, float& warpedScale) {
+  std::vector<cv::detail::ImageFeatures> features;
+  for (const auto& image : images) features.push_back(image.features);
+
+  std::vector<cv::detail::MatchesInfo> pairwise;
+  matchPairs(images, features, opts, cache, pairwise);
+
+  const std::vector<int> keep =
+      cv::detail::leaveBiggestComponent(features, pairwise, static_cast<float>(kConfidenceThresh));
+  if (keep.size() < 2) return false;
+  if (keep.size() < images.size()) {
+    std::cerr << "WARNING: " << images.size() - keep.size()
+              << " image(s) do not overlap the panorama and are skipped" << std::endl;
+  }
+  std::vector<BoundedImage> kept;
+  for (int i : keep) kept.push_back(std::move(images[i]));
+  images.swap(kept);
+
+  std::vector<cv::detail::CameraParams> cameras;
+  cv::detail::HomographyBasedEstimator estimator;
+  if (!estimator(features, pairwise, cameras)) return false;
+  for (auto& camera : cameras) {
+    cv::Mat R;
+    camera.R.convertTo(R, CV_32F);
+    camera.R = R;
+  }
+  cv::Ptr<cv::detail::BundleAdjusterBase> adjuster = cv::makePtr<cv::detail::BundleAdjusterRay>();
+  adjuster->setConfThresh(kConfidenceThresh);
+  if (!(*adjuster)(features, pairwise, cameras)) return false;
+
+  std::vector<double> focals;
+  for (const auto& camera : cameras) focals.push_back(camera.focal);
+  std::sort(focals.begin(), focals.end());
+  const size_t n = focals.size();
+  warpedScale = static_cast<float>(n % 2 == 1 ? focals[n / 2]
+                                              : (focals[n / 2 - 1] + focals[n / 2]) * 0.5);
+
+  std::vector<cv::Mat> rotations;
+  for (const auto& camera : cameras) rotations.push_back(camera.R.clone());
+  cv::detail::waveCorrect(rotations, cv::detail::WAVE_CORRECT_HORIZ);
+  for (size_t i = 0; i < images.size(); ++i) {
+    images[i].camera = cameras[i];
+    images[i].camera.R = rotations[i];
+  }
+  return true;
+}
+
+/**
+ * @brief Spherical warper that can build its remap tables for part of a footprint.
+ *
+ * RotationWarper::warp() always renders a whole footprint. The tiled compositor renders each
+ * source one tile-sized overlap at a time instead, with the same backward projection, so
+ * cropping the full warp and warping only the crop give the same pixels.
+ */
+class RoiSphericalWarper : public cv::detail::SphericalWarper {
+ public:
+  using cv::detail::SphericalWarper::SphericalWarper;
+
+  /**
+   * @brief Remap tables of the warped pixels in @p dstRoi (panorama coordinates).
+   * @param xmap Output CV_32F source x of every pixel of @p dstRoi
+   * @param ymap Output CV_32F source y of every pixel of @p dstRoi
+   */
+  void buildRoiMaps(const cv::Mat& K, const cv::Mat& R, const cv::Rect& dstRoi, cv::Mat& xmap,
+                    cv::Mat& ymap) {
+    projector_.setCameraParams(K, R);
+    xmap.create(dstRoi.size(), CV_32F);
+    ymap.create(dstRoi.size(), CV_32F);
+    for (int v = 0; v < dstRoi.height; ++v) {
+      float* xs = xmap.ptr<float>(v);
+      float* ys = ymap.ptr<float>(v);
+      for (int u = 0; u < dstRoi.width; ++u) {
+        projector_.mapBackward(static_cast<float>(dstRoi.x + u), static_cast<float>(dstRoi.y + v),
+                               xs[u], ys[u]);
+      }
+    }
+  }
+};
+
+/// Seam-scale warp of one proxy, alive only while the pairs that involve it are processed.
+struct SeamProxy {
+  cv::Mat image;      ///< CV_8UC3, for the gain statistics
+  cv::Mat footprint;  ///< Warped all-255 mask
+  cv::UMat imageF;    ///< CV_32FC3, for the graph cut
+};
+
+/**
+ * @brief Fits exposure gains and finds graph-cut seams, one overlapping pair at a time.
+ *
+ * GainCompensator and GraphCutSeamFinder both work on overlapping pairs, but expect every
+ * warped proxy at once. Here the pairs are visited in the same order (i ≤ j) with only the
+ * warped proxies of the current overlap group alive. A warped proxy is dropped as soon as the
+ * next image does not overlap it, and warped again if a later pair needs it. The seam masks
+ * carry over between pairs as they do inside GraphCutSeamFinder, and the gain system is
+ * accumulated with GainCompensator's own formulas, so both results match the all-at-once
+ * stages. Afterwards the unwarped proxies are released, leaving the small seam mask per image.
+ *
+ * @return Exposure compensator to apply while compositing
+ */
+cv::Ptr<cv::detail::ExposureCompensator> estimateSeams(std::vector<BoundedImage>& images,
+                                                       float warpedScale, double seamWorkAspect) {
+  RoiSphericalWarper warper(static_cast<float>(warpedScale * seamWorkAspect));
+  const int n = static_cast<int>(images.size());
+  std::vector<cv::Mat> Ks(n);
+  std::vector<cv::Rect> rois(n);
+  for (int i = 0; i < n; ++i) {
+    Ks[i] = intrinsics32F(images[i].camera);
+    const float swa = static_cast<float>(seamWorkAspect);
+    Ks[i].at<float>(0, 0) *= swa;
+    Ks[i].at<float>(0, 2) *= swa;
+    Ks[i].at<float>(1, 1) *= swa;
+    Ks[i].at<float>(1, 2) *= swa;
+    rois[i] = warper.warpRoi(images[i].seamImage.size(), Ks[i], images[i].camera.R);
+  }
+
+  std::map<int, SeamProxy> proxies;
+  std::vector<cv::UMat> seamMasks(n);  // start as the footprint, then cut by every pair
+  auto proxy = [&](int i) -> SeamProxy& {
+    auto it = proxies.find(i);
+    if (it != proxies.end()) return it->second;
+    SeamProxy& p = proxies[i];
+    const cv::Mat& R = images[i].camera.R;
+    warper.warp(images[i].seamImage, Ks[i], R, cv::INTER_LINEAR, cv::BORDER_REFLECT, p.image);
+    const cv::Mat ones(images[i].seamImage.size(), CV_8U, cv::Scalar::all(255));
+    warper.warp(ones, Ks[i], R, cv::INTER_NEAREST, cv::BORDER_CONSTANT, p.footprint);
+    p.image.convertTo(p.imageF, CV_32F);
+    if (seamMasks[i].empty()) p.footprint.copyTo(seamMasks[i]);
+    return p;
+  };
+
+  // Gain statistics as in GainCompensator::feed(): overlap sizes N and mean intensities I
+  cv::Mat_<int> N(n, n, 0);
+  cv::Mat_<double> I(n, n, 0.0);
+  std::vector<bool> skip(n, true);
+  cv::detail::GraphCutSeamFinder seamFinder(cv::detail::GraphCutSeamFinderBase::COST_COLOR);
+  for (int i = 0; i < n; ++i) {
+    for (int j = i; j < n; ++j) {
+      const cv::Rect overlap = rois[i] & rois[j];
+      if (overlap.empty()) continue;
+      SeamProxy& a = proxy(i);
+      SeamProxy& b = proxy(j);
+      const cv::Rect ra = overlap - rois[i].tl(), rb = overlap - rois[j].tl();
+
+      const cv::Mat intersect = (a.footprint(ra) == 255) & (b.footprint(rb) == 255);
+      const int count = cv::countNonZero(intersect);
+      N(i, j) = N(j, i) = std::max(1, count);
+      if (count > 0) {
+        if (i != j) skip[i] = skip[j] = false;
+        const cv::Mat subA = a.image(ra), subB = b.image(rb);
+        double sumA = 0, sumB = 0;
+        for (int y = 0; y < overlap.height; ++y) {
+          const cv::Vec3b* pa = subA.ptr<cv::Vec3b>(y);
+          const cv::Vec3b* pb = subB.ptr<cv::Vec3b>(y);
+          const uchar* m = intersect.ptr<uchar>(y);
+          for (int x = 0; x < overlap.width; ++x) {
+            if (!m[x]) continue;
+            sumA += cv::norm(pa[x]);
+            sumB += cv::norm(pb[x]);
+          }
+        }
+        I(i, j) = sumA / N(i, j);
+        I(j, i) = sumB / N(i, j);
+      }
+
+      if (j > i) {
+        std::vector<cv::UMat> src{a.imageF, b.imageF};
+        std::vector<cv::UMat> masks{seamMasks[i], seamMasks[j]};  // shallow: cut in place
+        seamFinder.find(src, {rois[i].tl(), rois[j].tl()}, masks);
+      }
+    }
+
+    // Keep only the warped proxies that the next image's pairs use
+    for (auto it = proxies.begin(); it != proxies.end();) {
+      const int k = it->first;
+      const bool next = k > i && i + 1 < n && (k == i + 1 || !(rois[k] & rois[i + 1]).empty());
+      it = next ? std::next(it) : proxies.erase(it);
+    }
+  }
+
+  // Gain system of GainCompensator (alpha = 0.01, beta = 100) over the overlapping images
+  const double alpha = 0.01, beta = 100;
+  std::vector<int> eq;
+  for (int i = 0; i < n; ++i) {
+    if (!skip[i]) eq.push_back(i);
+  }
+  std::vector<cv::Mat> gains(n);
+  for (auto& g : gains) g = cv::Mat(1, 1, CV_64F, cv::Scalar(1.0));
+  if (!eq.empty()) {
+    const int m = static_cast<int>(eq.size());
+    cv::Mat_<double> A(m, m, 0.0), b(m, 1, 0.0), solved;
+    for (int ki = 0; ki < m; ++ki) {
+      for (int kj = 0; kj < m; ++kj) {
+        const int i = eq[ki], j = eq[kj];
+        b(ki, 0) += beta * N(i, j);
+        A(ki, ki) += beta * N(i, j);
+        if (j == i) continue;
+        A(ki, ki) += 2 * alpha * I(i, j) * I(i, j) * N(i, j);
+        A(ki, kj) -= 2 * alpha * I(i, j) * I(j, i) * N(i, j);
+      }
+    }
+    cv::solve(A, b, solved);
+    for (int ki = 0; ki < m; ++ki) gains[eq[ki]].at<double>(0, 0) = solved(ki, 0);
+  }
+  cv::Ptr<cv::detail::GainCompensator> compensator = cv::makePtr<cv::detail::GainCompensator>();
+  compensator->setMatGains(gains);
+
+  for (int i = 0; i < n; ++i) {
+    seamMasks[i].copyTo(images[i].seamMask);
+    images[i].seamImage.release();
+  }
+  return compensator;
+}
+
+/// A source decoded at compositing scale, kept while consecutive tiles overlap it.
+struct ComposeSource {
+  cv::Mat image;  ///< CV_8UC3, unwarped
+  cv::Mat ones;   ///< All-255 mask of image.size(); its warp is the footprint mask
+  cv::Mat seam;   ///< Dilated seam mask scaled to the footprint (composeRoi.size())
+};
+
+/**
+ * @brief Decodes and scales source @p image for compositing.
+ * @throws std::runtime_error If the source can no longer be read
+ */
+ComposeSource loadComposeSource(const BoundedImage& image, double composeScale) {
+  ComposeSource source;
+  source.image = cv::imread(image.path.string());
+  if (source.image.empty())
+    throw std::runtime_error("Failed to reload image: " + image.path.string());
+  if (composeScale < 1.0) {
+    cv::resize(source.image, source.image, cv::Size(), composeScale, composeScale,
+               cv::INTER_LINEAR_EXACT);
+  }
+  source.ones = cv::Mat(source.image.size(), CV_8U, cv::Scalar::all(255));
+  cv::Mat dilated;
+  cv::dilate(image.seamMask, dilated, cv::Mat());
+  cv::resize(dilated, source.seam, image.composeRoi.size(), 0, 0, cv::INTER_LINEAR_EXACT);
+  return source;
+}
+
+/**
+ * @brief Warps the part of source @p index that falls in @p roi, ready for the blender.
+ * @param roi Part of the source footprint, in panorama coordinates
+ * @param image16 Output CV_16SC3 warped, exposure-compensated pixels
+ * @param mask Output footprint mask restricted by the seam
+ */
+void renderSource(const BoundedImage& image, int index, const ComposeSource& source,
+                  RoiSphericalWarper& warper, cv::detail::ExposureCompensator& compensator,
+                  const cv::Rect& roi, cv::Mat& image16, cv::Mat& mask) {
+  cv::Mat xmap, ymap, warped;
+  warper.buildRoiMaps(intrinsics32F(image.camera), image.camera.R, roi, xmap, ymap);
+  cv::remap(source.image, warped, xmap, ymap, cv::INTER_LINEAR, cv::BORDER_REFLECT);
+  cv::remap(source.ones, mask, xmap, ymap, cv::INTER_NEAREST, cv::BORDER_CONSTANT);
+  compensator.apply(index, roi.tl(), warped, mask);
+  warped.convertTo(image16, CV_16S);
+  mask &= source.seam(roi - image.composeRoi.tl());
+}
+
+/**
+ * @brief Reference composition with one blender over the whole panorama, as cv::Stitcher does.
+ *
+ * Every source's pyramid stays in the blender, so memory grows with the shot count; this only
+ * exists to check the tiled composition against it (--compare-single).
+ */
+cv::Mat composeSingle(const std::vector<BoundedImage>& images, double composeScale,
+                      RoiSphericalWarper& warper, cv::detail::ExposureCompensator& compensator,
+                      const cv::Rect& pano, int bands) {
+  cv::detail::MultiBandBlender blender(false, bands);
+  blender.prepare(pano);
+  cv::Mat image16, mask;
+  for (int i = 0; i < static_cast<int>(images.size()); ++i) {
+    const ComposeSource source = loadComposeSource(images[i], composeScale);
+    renderSource(images[i], i, source, warper, compensator, images[i].composeRoi, image16, mask);
+    blender.feed(image16, mask, images[i].composeRoi.tl());
+  }
+  cv::Mat blended, blendedMask, out;
+  blender.blend(blended, blendedMask);
+  blended.convertTo(out, CV_8U);
+  return out;
+}
+
+/**
+ * @brief Composes the panorama tile by tile and writes each tile to disk.
+ *
+ * The panorama is cut into a grid of square tiles, so compose memory depends on neither of
+ * its dimensions, which matters for 2-D aerial grids. Every tile gets its own multi-band
+ * blender, prepared on the tile padded by the same 3·2^bands gap the blender pads its feeds
+ * with. The band count follows the blend width but is capped at kMaxBlendBands, so that gap
+ * (at most 96 px) and the per-tile blender size stay fixed however large the panorama grows.
+ * Tiles start on the panorama's 2^bands grid, so every tile pyramid samples the pixels a
+ * single blender would. Each source is warped only where its footprint overlaps the padded
+ * tile. Decoded sources are kept while consecutive tiles overlap them and read again
+ * otherwise, so memory is bounded by the tile size and the number of shots overlapping one
+ * tile. Tiles go to `<output stem>_tiles/`; panoramas up to kAssembleMaxMegapix are also
+ * assembled into @p output.
+ */
+bool composeTiles(std::vector<BoundedImage>& images, const StitchOptions& opts,
+                  double workScale, float warpedScale,
+                  cv::detail::ExposureCompensator& compensator) {
+  const double composeScale = scaleFor(images.front().fullSize, opts.compositingMP);
+  const double composeWorkAspect = composeScale / workScale;
+  RoiSphericalWarper warper(static_cast<float>(warpedScale * composeWorkAspect));
+
+  std::vector<cv::Point> corners;
+  std::vector<cv::Size> sizes;
+  for (auto& image : images) {
+    image.camera.focal *= composeWorkAspect;
+    image.camera.ppx *= composeWorkAspect;
+    image.camera.ppy *= composeWorkAspect;
+    const cv::Size size(cvRound(image.fullSize.width * composeScale),
+                        cvRound(image.fullSize.height * composeScale));
+    image.composeRoi = warper.warpRoi(size, intrinsics32F(image.camera), image.camera.R);
+    corners.push_back(image.composeRoi.tl());
+    sizes.push_back(image.composeRoi.size());
+  }
+  const cv::Rect pano = cv::detail::resultRoi(corners, sizes);
+  const float blendWidth = std::sqrt(static_cast<float>(pano.area())) * kBlendStrength / 100.f;
+  // Capped so the tile padding and minimum tile side do not grow with the panorama
+  const int bands = std::clamp(
+      static_cast<int>(std::ceil(std::log(blendWidth) / std::log(2.f))) - 1, 1, kMaxBlendBands);
+  const int margin = 3 << bands;  // MultiBandBlender's own feed padding
+  const int grid = 1 << bands;
+
+  const int tile = (std::max(opts.tileSize, 2 * margin) + grid - 1) / grid * grid;
+  const int cols = (pano.width + tile - 1) / tile;
+  const int rows = (pano.height + tile - 1) / tile;
+  const std::filesystem::path tileDir =
+      opts.output.parent_path() / (opts.output.stem().string() + "_tiles");
+  std::filesystem::create_directories(tileDir);
+  std::cout << "Composing " << pano.width << "x" << pano.height << " panorama in " << rows
+            << "x" << cols << " tiles (" << bands << " bands)" << std::endl;
+
+  std::map<int, ComposeSource> sources;
+  std::vector<std::vector<std::filesystem::path>> tileFiles(rows);
+  cv::Mat image16, mask;
+  for (int r = 0; r < rows; ++r) {
+    for (int c = 0; c < cols; ++c) {
+      const cv::Rect core = cv::Rect(pano.x + c * tile, pano.y + r * tile, tile, tile) & pano;
+      const cv::Rect padded = cv::Rect(core.x - margin, core.y - margin, core.width + 2 * margin,
+                                       core.height + 2 * margin) &
+                              pano;
+
+      // Sources this tile does not touch are read again if a later tile needs them
+      for (auto it = sources.begin(); it != sources.end();) {
+        it = (images[it->first].composeRoi & padded).empty() ? sources.erase(it) : std::next(it);
+      }
+
+      cv::detail::MultiBandBlender blender(false, bands);
+      blender.prepare(padded);
+      bool fed = false;
+      for (int i = 0; i < static_cast<int>(images.size()); ++i) {
+        const cv::Rect overlap = images[i].composeRoi & padded;
+        if (overlap.empty()) continue;
+        auto it = sources.find(i);
+        if (it == sources.end())
+          it = sources.emplace(i, loadComposeSource(images[i], composeScale)).first;
+        renderSource(images[i], i, it->second, warper, compensator, overlap, image16, mask);
+        blender.feed(image16, mask, overlap.tl());
+        fed = true;
+      }
+
+      cv::Mat tile8;
+      if (fed) {
+        cv::Mat blended, blendedMask;
+        blender.blend(blended, blendedMask);
+        blended(core - padded.tl()).convertTo(tile8, CV_8U);
+      } else {
+        tile8 = cv::Mat::zeros(core.size(), CV_8UC3);
+      }
+      const auto path = tileDir / cv::format("tile_%04d_%04d.png", r, c);
+      portfolio::saveImageOrExit(path, tile8);
+      tileFiles[r].push_back(path);
+    }
+  }
+  sources.clear();
+
+  if (pano.area() > kAssembleMaxMegapix * 1e6) {
+    std::cout << "Panorama exceeds " << kAssembleMaxMegapix << " MP; tiles left in "
+              << tileDir << std::endl;
+    if (opts.compareSingle) std::cerr << "WARNING: --compare-single skipped" << std::endl;
+    return true;
+  }
+  std::vector<cv::Mat> tileRows;
+  for (const auto& row : tileFiles) {
+    std::vector<cv::Mat> tiles;
+    for (const auto& path : row)
+      tiles.push_back(portfolio::loadImageOrExit(path, cv::IMREAD_COLOR));
+    tileRows.emplace_back();
+    cv::hconcat(tiles, tileRows.back());
+  }
+  cv::Mat panorama;
+  cv::vconcat(tileRows, panorama);
+  portfolio::saveImageOrExit(opts.output, panorama);
+
+  if (opts.compareSingle) {
+    const cv::Mat reference =
+        composeSingle(images, composeScale, warper, compensator, pano, bands);
+    cv::Mat diff;
+    cv::absdiff(panorama, reference, diff);
+    double maxDiff = 0;
+    cv::minMaxLoc(diff.reshape(1), nullptr, &maxDiff);
+    const cv::Scalar meanDiff = cv::mean(diff);
+    std::cout << "Tiles vs single blender: max |diff| " << maxDiff << ", mean |diff| "
+              << (meanDiff[0] + meanDiff[1] + meanDiff[2]) / 3 << std::endl;
+  }
+  return true;
+}
+
+/**
+ * @brief Stitches @p files with the memory-bounded pipeline.
+ * @return EXIT_SUCCESS on success
+ */
+int runBounded(const std::vector<std::filesystem::path>& files, const StitchOptions& opts) {
+  const StitchCache cache(opts);
+  if (cache.enabled()) std::filesystem::create_directories(cache.dir);
+
+  auto t0 = std::chrono::steady_clock::now();
+  std::vector<BoundedImage> images;
+  double workScale = 1, seamScale = 1;
+  if (!buildProxies(files, opts, cache, images, workScale, seamScale)) {
+    std::cerr << "ERROR: Need at least two valid images to stitch a panorama." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const double proxiesMs = elapsedMs(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  float warpedScale = 1.f;
+  if (!estimateCameras(images, opts, cache, warpedScale)) {
+    std::cerr << "ERROR: Camera parameter estimation failed." << std::endl;
+    return EXIT_FAILURE;
+  }
+  const double camerasMs = elapsedMs(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  cv::Ptr<cv::detail::ExposureCompensator> compensator =
+      estimateSeams(images, warpedScale, seamScale / workScale);
+  const double seamsMs = elapsedMs(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  try {
+    composeTiles(images, opts, workScale, warpedScale, *compensator);
+  } catch (const std::exception& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::cout << "Stages: proxies " << proxiesMs << " ms, cameras " << camerasMs << " ms, seams "
+            << seamsMs << " ms, compositing " << elapsedMs(t0) << " ms" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Parses the command line; returns false on bad input.
+ */
+bool parseOptions(int argc, char* argv[], StitchOptions& opts) {
+  opts.inputDir = std::filesystem::path{kDataDir} / kInputSubdir;
+  opts.output = std::filesystem::path{kDataDir} / kOutputFilename;
+  try {
+    for (int i = 1; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--bounded") {
+        opts.bounded = true;
+      } else if (arg == "--compare-single") {
+        opts.compareSingle = true;
+      } else if (arg == "--ext" && hasValue) {
+        opts.extension = argv[++i];
+      } else if (arg == "--output" && hasValue) {
+        opts.output = argv[++i];
+      } else if (arg == "--registration-mp" && hasValue) {
+        opts.registrationMP = std::stod(argv[++i]);
+      } else if (arg == "--seam-mp" && hasValue) {
+        opts.seamMP = std::stod(argv[++i]);
+      } else if (arg == "--compositing-mp" && hasValue) {
+        opts.compositingMP = std::stod(argv[++i]);
+      } else if ((arg == "--tile" || arg == "--strip") && hasValue) {  // --strip: old name
+        opts.tileSize = std::max(64, std::stoi(argv[++i]));
+      } else if (arg == "--range" && hasValue) {
+        opts.matchRange = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--cache" && hasValue) {
+        opts.cacheDir = argv[++i];
+      } else if (arg.rfind("--", 0) != 0) {
+        opts.inputDir = arg;
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  StitchOptions opts;
+  if (!parseOptions(argc, argv, opts)) {
+    std::cerr << "Usage: " << argv[0] << " [input_dir] [--ext .jpeg] [--output file]"
+              << " [--registration-mp X] [--seam-mp X] [--compositing-mp X] [--range N]"
+              << " [--bounded] [--tile N] [--cache DIR] [--compare-single]" << std::endl;
+    return EXIT_FAILURE;
+  }
+  const std::filesystem::path& inputDir = opts.inputDir;
 
   std::vector<std::filesystem::path> imageFiles;
   try {
-    collectImageFiles(inputDir, kFileExtension, imageFiles);
+    collectImageFiles(inputDir, opts.extension, imageFiles);
   } catch (const std::exception& e) {
     std::cerr << "ERROR: " << e.what() << std::endl;
     return EXIT_FAILURE;
   }
 
   if (imageFiles.empty()) {
-    std::cerr << "No images found in " << inputDir << " with extension " << kFileExtension
+    std::cerr << "No images found in " << inputDir << " with extension " << opts.extension
               << std::endl;
     return EXIT_FAILURE;
   }
@@ -100,6 +909,15 @@ int main() {
   // Sort files to ensure consistent ordering
   std::sort(imageFiles.begin(), imageFiles.end());
 
+  if (!opts.cacheDir.empty() && !opts.bounded) {
+    std::cerr << "WARNING: --cache only applies to --bounded; ignoring it" << std::endl;
+  }
+  if (opts.bounded) {
+    const int status = runBounded(imageFiles, opts);
+    if (status == EXIT_SUCCESS)
+      std::cout << "Panorama successfully saved to: " << opts.output << std::endl;
+    return status;
+  }
   // Load valid images into a vector
   std::vector<cv::Mat> images;
   images.reserve(imageFiles.size());
@@ -119,6 +937,15 @@ int main() {
 
   // Create panorama stitcher (PANORAMA mode for perspective images)
   cv::Ptr<cv::Stitcher> stitcher = cv::Stitcher::create(cv::Stitcher::PANORAMA);
+  stitcher->setRegistrationResol(opts.registrationMP);
+  stitcher->setSeamEstimationResol(opts.seamMP);
+  stitcher->setCompositingResol(opts.compositingMP < 0 ? cv::Stitcher::ORIG_RESOL
+                                                       : opts.compositingMP);
+  if (opts.matchRange > 0) {
+    // The range matcher pairs j < i + range_width, i.e. range_width - 1 successors
+    stitcher->setFeaturesMatcher(cv::makePtr<cv::detail::BestOf2NearestRangeMatcher>(
+        opts.matchRange + 1, false, kMatchConfidence));
+  }
 
   // Perform stitching
   cv::Mat panorama;
@@ -131,9 +958,8 @@ int main() {
   }
 
   // Save the resulting panorama
-  std::filesystem::path outputPath = std::filesystem::path{kDataDir} / kOutputFilename;
-  saveImageOrExit(outputPath, panorama);
+  portfolio::saveImageOrExit(opts.output, panorama);
 
-  std::cout << "Panorama successfully saved to: " << outputPath << std::endl;
+  std::cout << "Panorama successfully saved to: " << opts.output << std::endl;
   return EXIT_SUCCESS;
 }
\ No newline at end of file
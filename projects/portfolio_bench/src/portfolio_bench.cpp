@@ -0,0 +1,423 @@
+/**
+ * @file portfolio_bench.cpp
+ * @brief Headless regression benchmark of the hot function of each portfolio project.
+ *
+ * This tool:
+ *  1. Loads the canonical input of every kernel from the data directory of its project and
+ *     prepares everything that is not part of the measured call (cascades, lookup tables,
+ *     detected faces...).
+ *  2. Runs each kernel single-threaded by default: warmup calls first, then timed calls inside a
+ *     portfolio::ScopedStage until the iteration count or the per-kernel time budget is reached.
+ *  3. Compares the p50 latency with the limit in the thresholds file and reports a regression
+ *     when it is exceeded by more than the tolerance; the exit code is non-zero if any kernel
+ *     regressed or failed.
+ *  4. Optionally writes the stage summary as JSON, every call as a Chrome trace, or the measured
+ *     p50 values as a new thresholds file.
+ *
+ * Usage:
+ *   ./portfolio_bench [--kernels name1,name2,...] [--warmup N] [--iterations N] [--budget S]
+ *                     [--threads N] [--thresholds FILE] [--tolerance PCT] [--record FILE]
+ *                     [--json report.json] [--trace trace.json] [--list]
+ *
+ * A kernel is selected when its name contains one of the --kernels entries, so "chroma_key"
+ * selects both chroma key kernels. --threads 0 keeps OpenCV's default thread count.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <opencv2/opencv.hpp>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "config.pch"  // Defines DATA_DIR and PROJECTS_DIR macros
+#include "cartoon_filters.hpp"
+#include "edge_mask.hpp"
+#include "face_overlays.hpp"
+#include "focus_metrics.hpp"
+#include "key_mask.hpp"
+#include "portfolio/stage_timers.hpp"
+#include "skin_retouch.hpp"
+
+namespace fs = std::filesystem;
+
+static const fs::path kDefaultThresholds = fs::path(DATA_DIR) / "thresholds.txt";
+static constexpr int kMinTimedCalls = 3;    ///< Timed calls made even past the budget
+static constexpr int kKeyPatchSize = 41;    ///< Corner patch averaged into the chroma key color
+static constexpr int kKeyTolerance = 20;    ///< Chroma key tolerance [%]
+static constexpr int kEdgeLongSide = 1024;  ///< Detection resolution of document_scanner
+
+/// One prepared kernel invocation.
+struct KernelCall {
+  std::function<void()> reset;  ///< Restores the input before each call (untimed, optional)
+  std::function<void()> run;    ///< The measured call
+  cv::Size inputSize;
+};
+
+/// A benchmarked kernel; prepare() loads its inputs and is not timed.
+struct BenchKernel {
+  std::string name;
+  std::function<KernelCall()> prepare;
+};
+
+/// Outcome of one kernel.
+struct KernelResult {
+  std::string name;
+  cv::Size inputSize;
+  portfolio::StageSummary stats;
+  double limitMs = 0;  ///< 0 if the thresholds file has no entry
+  bool failed = false;
+  bool regressed = false;
+};
+
+/// Path of @p file in the data directory of @p project.
+static std::string projectData(const std::string& project, const std::string& file) {
+  return (fs::path(PROJECTS_DIR) / project / "data" / file).string();
+}
+
+/// Loads a Haar cascade or throws.
+static void loadCascade(cv::CascadeClassifier& cascade, const std::string& path) {
+  if (!cascade.load(path)) throw std::runtime_error("cannot load cascade " + path);
+}
+
+/// Loads a color input image or throws, so a missing sample fails only its own kernel.
+static cv::Mat loadInput(const std::string& path) {
+  cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+  if (image.empty()) throw std::runtime_error("cannot load image " + path);
+  return image;
+}
+
+/// Loads the chroma key frame and samples the key color from its top-left corner.
+static cv::Mat loadKeyedFrame(cv::Vec3b& key) {
+  cv::Mat frame = loadInput(projectData("chroma_key", "greenscreen-demo.example.jpg"));
+  const cv::Scalar mean = cv::mean(frame(cv::Rect(0, 0, kKeyPatchSize, kKeyPatchSize)));
+  key = cv::Vec3b(cv::saturate_cast<uchar>(mean[0]), cv::saturate_cast<uchar>(mean[1]),
+                  cv::saturate_cast<uchar>(mean[2]));
+  return frame;
+}
+
+/// chroma_key: the HSV reference mask.
+static KernelCall prepareKeyMask() {
+  cv::Vec3b key;
+  cv::Mat frame = loadKeyedFrame(key);
+  return {{}, [frame, key] { createKeyMask(frame, key, kKeyTolerance); }, frame.size()};
+}
+
+/// chroma_key: the lookup-table mask; the table is built once, as in the player.
+static KernelCall prepareKeyColorTable() {
+  cv::Vec3b key;
+  cv::Mat frame = loadKeyedFrame(key);
+  auto table = std::make_shared<KeyColorTable>();
+  table->update(key, kKeyTolerance);
+  return {{}, [frame, table] { table->createMask(frame); }, frame.size()};
+}
+
+/// document_scanner: edge mask of the V channel at the reduced detection resolution.
+static KernelCall prepareEdgeMask() {
+  cv::Mat doc = loadInput(projectData("document_scanner", "doc1.jpg"));
+  const double scale = static_cast<double>(kEdgeLongSide) / std::max(doc.cols, doc.rows);
+  cv::Mat small, hsv, v;
+  cv::resize(doc, small, cv::Size(), scale, scale, cv::INTER_AREA);
+  cv::cvtColor(small, hsv, cv::COLOR_BGR2HSV);
+  cv::extractChannel(hsv, v, 2);
+  const double paramScale = std::max(v.cols, v.rows) / kEdgeMaskReferenceLongSide;
+  return {{}, [v, paramScale] { computeEdgeMask(v, paramScale); }, v.size()};
+}
+
+/// sketch_and_cartoon: canonical portrait.
+static cv::Mat loadSketchFace() {
+  return loadInput(projectData("sketch_and_cartoon", "face.png"));
+}
+
+/// sketch_and_cartoon: pencil-sketch mask.
+static KernelCall prepareSketchMask() {
+  cv::Mat src = loadSketchFace();
+  return {{}, [src] { computeSketchMask(src); }, src.size()};
+}
+
+/// sketch_and_cartoon: cartoon filter on a precomputed sketch mask.
+static KernelCall prepareCartoonify(FilterMode mode) {
+  cv::Mat src = loadSketchFace();
+  cv::Mat mask = computeSketchMask(src);
+  return {{}, [src, mask, mode] { cartoonify(src, mask, mode); }, src.size()};
+}
+
+/// skin_smoothing: the full retouch pipeline, face and eye detection included.
+static KernelCall prepareSkinSmoothing() {
+  cv::Mat image = loadInput(projectData("skin_smoothing", "img1.png"));
+  auto faceC = std::make_shared<cv::CascadeClassifier>();
+  auto eyeC = std::make_shared<cv::CascadeClassifier>();
+  loadCascade(*faceC, projectData("skin_smoothing", "models/haarcascade_frontalface_default.xml"));
+  loadCascade(*eyeC, projectData("skin_smoothing", "models/haarcascade_eye.xml"));
+  auto run = [image, faceC, eyeC] {
+    cv::Mat removed, smoothed;
+    processSkinSmoothing(image, *faceC, *eyeC, removed, smoothed);
+  };
+  return {{}, run, image.size()};
+}
+
+/**
+ * @brief sunglasses++: glasses compositing with reflection and effect on faces detected once.
+ *
+ * The asset cache is filled by the warmup calls, so the timed calls measure the per-frame
+ * blending the live loop pays.
+ */
+static KernelCall prepareGlasses() {
+  auto load = [](const std::string& file) { return loadInput(projectData("sunglasses++", file)); };
+  cv::Mat base = load("face1.png");
+  cv::CascadeClassifier faceC;
+  loadCascade(faceC, projectData("sunglasses++", "models/haarcascade_frontalface_default.xml"));
+  cv::Mat gray;
+  cv::cvtColor(base, gray, cv::COLOR_BGR2GRAY);
+  cv::equalizeHist(gray, gray);
+  std::vector<cv::Rect> faces;
+  faceC.detectMultiScale(gray, faces, 1.1, 3, cv::CASCADE_SCALE_IMAGE, cv::Size(100, 100));
+  if (faces.empty()) {
+    // Fall back to a centered box so the compositing is still measured
+    const int w = base.cols / 2;
+    faces.emplace_back((base.cols - w) / 2, base.rows / 4, w, w);
+  }
+
+  // Index 0 is "none", as in the sunglasses++ menus
+  auto assets = std::make_shared<OverlayAssetCache>(
+      load("sunglassRGB.png"), std::vector<cv::Mat>{cv::Mat(), load("glasses1.png")},
+      std::vector<cv::Mat>{cv::Mat(), load("effect1.png")}, std::vector<cv::Mat>{cv::Mat()});
+  auto frame = std::make_shared<cv::Mat>();
+  return {[base, frame] { base.copyTo(*frame); },
+          [frame, assets, faces] { applyGlasses(*frame, *assets, 1, 50, 60, faces, 1, 50); },
+          base.size()};
+}
+
+/// autofocus_evaluator: local variance of the first video frame, float plane precomputed.
+static KernelCall prepareVarLocal() {
+  const std::string video = projectData("autofocus_evaluator", "focus-test.mp4");
+  cv::VideoCapture cap(video);
+  cv::Mat frame;
+  if (!cap.read(frame)) throw std::runtime_error("cannot read " + video);
+  auto input = std::make_shared<FocusInput>(frame);
+  input->v32();
+  return {{}, [input] { varLocal(*input); }, frame.size()};
+}
+
+/// The kernels, in project order.
+static std::vector<BenchKernel> makeKernels() {
+  return {
+      {"chroma_key/createKeyMask", prepareKeyMask},
+      {"chroma_key/KeyColorTable", prepareKeyColorTable},
+      {"document_scanner/computeEdgeMask", prepareEdgeMask},
+      {"sketch_and_cartoon/computeSketchMask", prepareSketchMask},
+      // The exact bilateral mode takes seconds per call and is left to the interactive tool
+      {"sketch_and_cartoon/cartoonify:pyramid",
+       [] { return prepareCartoonify(FilterMode::Pyramid); }},
+      {"sketch_and_cartoon/cartoonify:recursive",
+       [] { return prepareCartoonify(FilterMode::Recursive); }},
+      {"skin_smoothing/processSkinSmoothing", prepareSkinSmoothing},
+      {"sunglasses++/applyGlasses", prepareGlasses},
+      {"autofocus_evaluator/varLocal", prepareVarLocal},
+  };
+}
+
+/// True if @p name contains one of the comma-separated entries of @p list (or @p list is empty).
+static bool selected(const std::string& name, const std::string& list) {
+  if (list.empty()) return true;
+  std::stringstream entries(list);
+  std::string entry;
+  while (std::getline(entries, entry, ',')) {
+    if (!entry.empty() && name.find(entry) != std::string::npos) return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Reads "kernel p50_ms" lines; '#' starts a comment.
+ * @return False if the file cannot be opened
+ */
+static bool readThresholds(const fs::path& path, std::map<std::string, double>& limits) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    line = line.substr(0, line.find('#'));
+    std::istringstream fields(line);
+    std::string name;
+    double ms = 0;
+    if (fields >> name >> ms) limits[name] = ms;
+  }
+  return true;
+}
+
+/**
+ * @brief Writes the measured p50 of every kernel in the thresholds format.
+ * @return False if the file cannot be written
+ */
+static bool writeThresholds(const fs::path& path, const std::vector<KernelResult>& results) {
+  std::ofstream out(path);
+  if (!out) return false;
+  out << "# kernel p50_ms, recorded by portfolio_bench --record\n";
+  for (const KernelResult& r : results) {
+    if (r.failed) continue;
+    out << r.name << " " << std::fixed << std::setprecision(3) << r.stats.p50Ms << "\n";
+  }
+  return static_cast<bool>(out);
+}
+
+/// Formats a size as "WxH".
+static std::string sizeStr(cv::Size s) {
+  return std::to_string(s.width) + "x" + std::to_string(s.height);
+}
+
+int main(int argc, char* argv[]) {
+  // Parse options
+  fs::path thresholdsPath = kDefaultThresholds;
+  fs::path recordPath, jsonPath, tracePath;
+  std::string kernelList;
+  int warmup = 3, iterations = 30, threads = 1;
+  double budgetSec = 5.0, tolerancePct = 25.0;
+  bool listOnly = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--kernels" && hasValue) {
+      kernelList = argv[++i];
+    } else if (arg == "--warmup" && hasValue) {
+      warmup = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--iterations" && hasValue) {
+      iterations = std::max(1, std::stoi(argv[++i]));
+    } else if (arg == "--budget" && hasValue) {
+      budgetSec = std::max(0.0, std::stod(argv[++i]));
+    } else if (arg == "--threads" && hasValue) {
+      threads = std::max(0, std::stoi(argv[++i]));
+    } else if (arg == "--thresholds" && hasValue) {
+      thresholdsPath = argv[++i];
+    } else if (arg == "--tolerance" && hasValue) {
+      tolerancePct = std::max(0.0, std::stod(argv[++i]));
+    } else if (arg == "--record" && hasValue) {
+      recordPath = argv[++i];
+    } else if (arg == "--json" && hasValue) {
+      jsonPath = argv[++i];
+    } else if (arg == "--trace" && hasValue) {
+      tracePath = argv[++i];
+    } else if (arg == "--list") {
+      listOnly = true;
+    } else {
+      std::cerr << "ERROR: Unknown option: " << arg << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  std::vector<BenchKernel> kernels;
+  for (BenchKernel& k : makeKernels()) {
+    if (selected(k.name, kernelList)) kernels.push_back(std::move(k));
+  }
+  if (listOnly) {
+    for (const BenchKernel& k : kernels) std::cout << k.name << std::endl;
+    return EXIT_SUCCESS;
+  }
+  if (kernels.empty()) {
+    std::cerr << "ERROR: No kernel matches: " << kernelList << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::map<std::string, double> limits;
+  if (!readThresholds(thresholdsPath, limits)) {
+    std::cerr << "WARNING: Cannot read thresholds " << thresholdsPath
+              << "; reporting timings only" << std::endl;
+  }
+
+  // 0 would make OpenCV sequential; a negative value restores its default thread count
+  cv::setNumThreads(threads > 0 ? threads : -1);
+
+  portfolio::StageTimers timers;
+  std::vector<KernelResult> results;
+  std::cout << std::left << std::setw(40) << "kernel" << std::setw(12) << "input" << std::right
+            << std::setw(7) << "calls" << std::setw(10) << "p50 ms" << std::setw(10) << "p95 ms"
+            << std::setw(10) << "max ms" << std::setw(10) << "limit" << "  status" << std::endl;
+
+  for (const BenchKernel& k : kernels) {
+    KernelResult r;
+    r.name = k.name;
+    r.stats.name = k.name;
+    try {
+      KernelCall call = k.prepare();
+      r.inputSize = call.inputSize;
+      for (int i = 0; i < warmup; ++i) {
+        if (call.reset) call.reset();
+        call.run();
+      }
+      const auto loopStart = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        const std::chrono::duration<double> spent = std::chrono::steady_clock::now() - loopStart;
+        if (i >= kMinTimedCalls && spent.count() > budgetSec) break;
+        if (call.reset) call.reset();
+        portfolio::ScopedStage stage(k.name, timers);
+        call.run();
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "ERROR: " << k.name << ": " << e.what() << std::endl;
+      r.failed = true;
+      timers.count("failures");
+    }
+
+    for (const portfolio::StageSummary& s : timers.summary()) {
+      if (s.name == k.name) r.stats = s;
+    }
+    if (!r.failed && r.stats.count == 0) r.failed = true;
+    const auto limit = limits.find(k.name);
+    if (limit != limits.end()) r.limitMs = limit->second;
+    r.regressed = !r.failed && r.limitMs > 0 &&
+                  r.stats.p50Ms > r.limitMs * (1.0 + tolerancePct / 100.0);
+    if (r.regressed) timers.count("regressions");
+
+    const char* status = r.failed      ? "FAILED"
+                         : r.regressed ? "REGRESSION"
+                         : r.limitMs > 0 ? "ok"
+                                         : "-";
+    std::cout << std::left << std::setw(40) << r.name << std::setw(12) << sizeStr(r.inputSize)
+              << std::right << std::setw(7) << r.stats.count << std::fixed << std::setprecision(3)
+              << std::setw(10) << r.stats.p50Ms << std::setw(10) << r.stats.p95Ms << std::setw(10)
+              << r.stats.maxMs << std::setprecision(1) << std::setw(10) << r.limitMs
+              << std::defaultfloat << "  " << status << std::endl;
+    results.push_back(r);
+  }
+
+  bool ok = true;
+  for (const KernelResult& r : results) ok = ok && !r.failed && !r.regressed;
+
+  if (!recordPath.empty()) {
+    if (!writeThresholds(recordPath, results)) {
+      std::cerr << "ERROR: Failed to write " << recordPath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << recordPath << std::endl;
+  }
+  if (!jsonPath.empty()) {
+    if (!timers.writeJson(jsonPath)) {
+      std::cerr << "ERROR: Failed to write " << jsonPath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << jsonPath << std::endl;
+  }
+  if (!tracePath.empty()) {
+    if (!timers.writeChromeTrace(tracePath)) {
+      std::cerr << "ERROR: Failed to write " << tracePath << std::endl;
+      return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << tracePath << std::endl;
+  }
+
+  if (!ok) {
+    std::cerr << "ERROR: Kernel regressions or failures (tolerance " << tolerancePct << " %)"
+              << std::endl;
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,42 @@
+/**
+ * @file image_io.hpp
+ * @brief Image load/save/display helpers shared by the portfolio executables.
+ */
+
+#pragma once
+
+#include <filesystem>
+#include <opencv2/core.hpp>
+#include <opencv2/imgcodecs.hpp>
+#include <string>
+#include <vector>
+
+namespace portfolio {
+
+/**
+ * @brief Loads an image or terminates the program with an error message.
+ * @param path Path to the image file
+ * @param flags cv::imread flags
+ * @return Loaded image (never empty)
+ */
+cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED);
+
+/**
+ * @brief Saves an image or terminates the program with an error message.
+ * @param path Destination file
+ * @param image Image to save
+ * @param params cv::imwrite encoder parameters
+ */
+void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
+                     const std::vector<int>& params = {});
+
+/**
+ * @brief Shows @p image in a resizable window until a key is pressed, then closes it.
+ * @param windowName Window title
+ * @param image Image to show
+ * @param windowSize Initial window size
+ */
+void showImage(const std::string& windowName, const cv::Mat& image,
+               cv::Size windowSize = {1200, 900});
+
+}  // namespace portfolio
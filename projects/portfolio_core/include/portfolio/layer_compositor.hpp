@@ -0,0 +1,210 @@
+/**
+ * @file layer_compositor.hpp
+ * @brief Declarative layer stack with colour-range masks, blended in fused per-ROI passes.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <string>
+#include <vector>
+
+namespace portfolio {
+
+/// Inclusive BGR range, with cv::inRange semantics.
+struct ColorRange {
+  cv::Vec3b lo;
+  cv::Vec3b hi;
+
+  bool contains(const uchar* bgr) const {
+    return bgr[0] >= lo[0] && bgr[0] <= hi[0] && bgr[1] >= lo[1] && bgr[1] <= hi[1] &&
+           bgr[2] >= lo[2] && bgr[2] <= hi[2];
+  }
+};
+
+/**
+ * @brief Conjunction of range tests: inside every `inside` range, outside every `outside` range,
+ *        and (if set) within `region` of the image the rule is evaluated on.
+ */
+struct MaskClause {
+  std::vector<ColorRange> inside;
+  std::vector<ColorRange> outside;
+  cv::Rect region;  ///< Empty = the whole image
+
+  bool matches(const uchar* bgr, int x, int y) const {
+    if (!region.empty() && !region.contains(cv::Point(x, y))) return false;
+    for (const auto& r : inside)
+      if (!r.contains(bgr)) return false;
+    for (const auto& r : outside)
+      if (r.contains(bgr)) return false;
+    return true;
+  }
+};
+
+/**
+ * @brief Binary mask declared as a disjunction of clauses; a rule without clauses keeps every
+ *        pixel. Replaces chains of inRange / bitwise / subtract on full-size mask images.
+ */
+struct MaskRule {
+  std::vector<MaskClause> anyOf;
+
+  bool empty() const { return anyOf.empty(); }
+  bool matches(const uchar* bgr, int x, int y) const {
+    if (anyOf.empty()) return true;
+    for (const auto& clause : anyOf)
+      if (clause.matches(bgr, x, y)) return true;
+    return false;
+  }
+};
+
+/// How a layer's colour is combined with the canvas.
+enum class BlendMode {
+  Over,           ///< canvas·(1 − cover·α) + source·α
+  Premultiplied,  ///< canvas·(1 − α) + source·α, with the source premultiplied before scaling
+};
+
+/**
+ * @brief One entry of the layer stack.
+ *
+ * Coverage α comes from `alpha` if set, otherwise from `mask` evaluated on `source`. Pixels
+ * where `clip` fails on `clipSource` (canvas-aligned, e.g. the background plate) get α = 0,
+ * which puts the layer behind whatever the clip rule rejects.
+ */
+struct Layer {
+  std::string name;
+  cv::Mat source;       ///< 8UC3 BGR
+  MaskRule mask;        ///< Coverage rule evaluated on the unscaled source
+  cv::Mat alpha;        ///< Optional 8UC1 coverage, same size as source; overrides `mask`
+  cv::Point origin;     ///< Canvas position of the (scaled) source's top-left corner
+  double scale = 1.0;   ///< Resize applied to source and coverage together
+  BlendMode mode = BlendMode::Over;
+  double cover = 1.0;   ///< Over only: how much of the canvas α hides (< 1 tints instead)
+  MaskRule clip;        ///< Canvas-side rule, evaluated on clipSource
+  cv::Mat clipSource;   ///< 8UC3, canvas-sized; required if `clip` is not empty
+};
+
+/**
+ * @brief Evaluates layer stacks on interleaved 8UC3 canvases.
+ *
+ * Unscaled layers take a single pass over the rows of their canvas ROI that evaluates the
+ * mask rule, the clip rule and the blend per pixel, so no mask or per-channel plane is ever
+ * materialized. Scaled layers first pack colour and coverage into one BGRA image at source
+ * resolution (premultiplying if requested) so a single resize moves both, then blend that in
+ * the same kind of pass. Layers are clipped to the canvas bounds. Passes run in parallel over
+ * row stripes.
+ */
+class LayerCompositor {
+ public:
+  /// Renders @p layers in order over a copy of @p base.
+  static cv::Mat render(const cv::Mat& base, const std::vector<Layer>& layers) {
+    cv::Mat canvas = base.clone();
+    for (const auto& layer : layers) apply(canvas, layer);
+    return canvas;
+  }
+
+  /// Blends one layer into @p canvas in place.
+  static void apply(cv::Mat& canvas, const Layer& layer) {
+    CV_Assert(canvas.type() == CV_8UC3 && layer.source.type() == CV_8UC3);
+    CV_Assert(layer.alpha.empty() ||
+              (layer.alpha.type() == CV_8UC1 && layer.alpha.size() == layer.source.size()));
+    CV_Assert(layer.clip.empty() ||
+              (layer.clipSource.type() == CV_8UC3 && layer.clipSource.size() == canvas.size()));
+
+    if (layer.scale == 1.0 && layer.mode == BlendMode::Over) {
+      blend(canvas, layer, layer.source, [&](const uchar* src, int x, int y) -> int {
+        if (!layer.alpha.empty()) return layer.alpha.at<uchar>(y, x);
+        return layer.mask.matches(src, x, y) ? 255 : 0;
+      });
+      return;
+    }
+
+    // Pack colour + coverage (premultiplied if requested) so one resize moves both
+    cv::Mat packed = packLayer(layer);
+    if (layer.scale != 1.0) {
+      cv::resize(packed, packed, cv::Size(), layer.scale, layer.scale, cv::INTER_LINEAR);
+    }
+    blend(canvas, layer, packed, [](const uchar* src, int, int) -> int { return src[3]; });
+  }
+
+  /// Coverage of @p rule on @p image as an 8UC1 0/255 mask, for debugging or explicit alphas.
+  static cv::Mat evaluateMask(const cv::Mat& image, const MaskRule& rule) {
+    CV_Assert(image.type() == CV_8UC3);
+    cv::Mat mask(image.size(), CV_8UC1);
+    cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& rows) {
+      for (int y = rows.start; y < rows.end; ++y) {
+        const uchar* p = image.ptr<uchar>(y);
+        uchar* m = mask.ptr<uchar>(y);
+        for (int x = 0; x < image.cols; ++x, p += 3) m[x] = rule.matches(p, x, y) ? 255 : 0;
+      }
+    });
+    return mask;
+  }
+
+ private:
+  /// round(a·b / 255) for a, b in [0, 255].
+  static int mul255(int a, int b) {
+    const int t = a * b + 128;
+    return (t + (t >> 8)) >> 8;
+  }
+
+  /// Source colour and coverage interleaved as BGRA at source resolution.
+  static cv::Mat packLayer(const Layer& layer) {
+    const cv::Mat& src = layer.source;
+    cv::Mat packed(src.size(), CV_8UC4);
+    const bool premultiply = layer.mode == BlendMode::Premultiplied;
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& rows) {
+      for (int y = rows.start; y < rows.end; ++y) {
+        const uchar* s = src.ptr<uchar>(y);
+        const uchar* a = layer.alpha.empty() ? nullptr : layer.alpha.ptr<uchar>(y);
+        uchar* d = packed.ptr<uchar>(y);
+        for (int x = 0; x < src.cols; ++x, s += 3, d += 4) {
+          const int alpha = a ? a[x] : (layer.mask.matches(s, x, y) ? 255 : 0);
+          for (int c = 0; c < 3; ++c)
+            d[c] = static_cast<uchar>(premultiply ? mul255(s[c], alpha) : s[c]);
+          d[3] = static_cast<uchar>(alpha);
+        }
+      }
+    });
+    return packed;
+  }
+
+  /**
+   * @brief Fused blend pass over the canvas ROI covered by @p src placed at layer.origin.
+   * @param coverage Returns α of a source pixel (pointer to its first channel, source x, y)
+   */
+  template <typename Coverage>
+  static void blend(cv::Mat& canvas, const Layer& layer, const cv::Mat& src, Coverage coverage) {
+    const cv::Rect placed(layer.origin, src.size());
+    const cv::Rect roi = placed & cv::Rect(0, 0, canvas.cols, canvas.rows);
+    if (roi.empty()) return;
+    const int channels = src.channels();
+    const bool premultiplied = layer.mode == BlendMode::Premultiplied;
+    const int cover = cvRound(std::clamp(layer.cover, 0.0, 1.0) * 256);
+
+    cv::parallel_for_(cv::Range(roi.y, roi.br().y), [&](const cv::Range& rows) {
+      for (int y = rows.start; y < rows.end; ++y) {
+        const int sy = y - placed.y;
+        uchar* d = canvas.ptr<uchar>(y) + 3 * roi.x;
+        const uchar* s = src.ptr<uchar>(sy) + channels * (roi.x - placed.x);
+        const uchar* k = layer.clip.empty() ? nullptr : layer.clipSource.ptr<uchar>(y) + 3 * roi.x;
+        for (int x = roi.x; x < roi.br().x; ++x, d += 3, s += channels) {
+          int alpha = coverage(s, x - placed.x, sy);
+          if (k) {
+            if (!layer.clip.matches(k, x, y)) alpha = 0;
+            k += 3;
+          }
+          if (alpha == 0) continue;
+          const int hidden = premultiplied ? alpha : (alpha * cover) >> 8;
+          for (int c = 0; c < 3; ++c) {
+            const int fg = premultiplied ? s[c] : mul255(s[c], alpha);
+            d[c] = cv::saturate_cast<uchar>(mul255(d[c], 255 - hidden) + fg);
+          }
+        }
+      }
+    });
+  }
+};
+
+}  // namespace portfolio
@@ -0,0 +1,87 @@
+/**
+ * @file mat_pool.hpp
+ * @brief Per-thread pool of reusable cv::Mat buffers for per-call temporaries.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <opencv2/core.hpp>
+#include <vector>
+
+namespace portfolio {
+
+/**
+ * @brief Recycles the storage of short-lived images instead of allocating it on every call.
+ *
+ * acquire() hands out a Lease: a Mat header of the requested size and type over a pooled byte
+ * buffer, returned to the pool when the lease goes out of scope. The smallest idle buffer that
+ * is large enough is reused, so a kernel called on frames or crops of varying size stops
+ * allocating once it has seen the largest one. At most maxIdle() buffers are kept.
+ *
+ * Each thread gets its own pool from local(), so no locking is involved; a lease must be
+ * released on the thread that acquired it. Use the leased Mat as an output of exactly its size
+ * and type: an OpenCV call that has to reallocate it detaches it from the pool (which is safe,
+ * it only loses the reuse). Never return a leased Mat to a caller; clone it instead.
+ */
+class MatPool {
+ public:
+  static constexpr std::size_t kDefaultMaxIdle = 8;
+
+  /// A pooled buffer viewed as one image; move-only.
+  class Lease {
+   public:
+    Lease(Lease&& other) noexcept
+        : pool_(other.pool_), buffer_(std::move(other.buffer_)), mat_(std::move(other.mat_)) {
+      other.pool_ = nullptr;
+    }
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+    Lease& operator=(Lease&&) = delete;
+    ~Lease() {
+      if (pool_) pool_->release(std::move(buffer_));
+    }
+
+    cv::Mat& mat() { return mat_; }
+    cv::Mat& operator*() { return mat_; }
+    cv::Mat* operator->() { return &mat_; }
+
+   private:
+    friend class MatPool;
+    Lease(MatPool* pool, cv::Mat buffer, cv::Size size, int type)
+        : pool_(pool), buffer_(std::move(buffer)), mat_(size, type, buffer_.data) {}
+
+    MatPool* pool_;
+    cv::Mat buffer_;  ///< 1×N CV_8U storage owned by the pool
+    cv::Mat mat_;     ///< Header over buffer_
+  };
+
+  explicit MatPool(std::size_t maxIdle = kDefaultMaxIdle) : maxIdle_(maxIdle) {}
+
+  MatPool(const MatPool&) = delete;
+  MatPool& operator=(const MatPool&) = delete;
+
+  /// Pool of the calling thread.
+  static MatPool& local();
+
+  /// Leases an uninitialized image of @p size and @p type.
+  Lease acquire(cv::Size size, int type);
+
+  /// Drops every idle buffer.
+  void clear() { idle_.clear(); }
+
+  std::size_t idle() const { return idle_.size(); }
+  std::size_t maxIdle() const { return maxIdle_; }
+  std::size_t allocations() const { return allocations_; }  ///< Buffers allocated so far
+  std::size_t reuses() const { return reuses_; }            ///< Leases served from idle buffers
+
+ private:
+  void release(cv::Mat buffer);
+
+  std::vector<cv::Mat> idle_;  ///< Idle buffers, ascending by capacity
+  std::size_t maxIdle_;
+  std::size_t allocations_ = 0;
+  std::size_t reuses_ = 0;
+};
+
+}  // namespace portfolio
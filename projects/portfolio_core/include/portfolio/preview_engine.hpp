@@ -0,0 +1,185 @@
+/**
+ * @file preview_engine.hpp
+ * @brief Viewport-sized rendering of arbitrarily large images from a mip pyramid.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+namespace portfolio {
+
+/**
+ * @brief Zoomable, pannable preview whose cost depends on the viewport, not on the image.
+ *
+ * A mip pyramid (pyrDown until a level fits the viewport) is built once; level 0 shares the
+ * caller's image, so the pyramid adds about a third of its size. render() picks the coarsest
+ * level that still has at least as many pixels as the view shows and resamples only the
+ * visible part of it with one warpAffine into a reused viewport buffer, so zooming a gigapixel
+ * image never allocates more than a viewport.
+ *
+ * The rendered view is kept twice: base() without overlays and frame() for drawing on.
+ * clearOverlay() restores only the rows an overlay touched, so interactive drawing (a rubber
+ * band rectangle, a cursor) costs a few row copies per event instead of a full-image clone.
+ * Full-resolution work (saving, cropping) stays with the caller, in image coordinates
+ * obtained from viewToImage().
+ */
+class PreviewEngine {
+ public:
+  static constexpr int kDefaultViewportWidth = 1200;
+  static constexpr int kDefaultViewportHeight = 900;
+
+  PreviewEngine() = default;
+
+  /// Builds the preview of @p image; see reset().
+  explicit PreviewEngine(const cv::Mat& image,
+                         cv::Size viewport = {kDefaultViewportWidth, kDefaultViewportHeight}) {
+    reset(image, viewport);
+  }
+
+  /**
+   * @brief (Re)builds the pyramid and shows the image at 100 %, centred.
+   * @param image Source image; must outlive the engine (level 0 is not copied)
+   * @param viewport Maximum size of the rendered view
+   */
+  void reset(const cv::Mat& image,
+             cv::Size viewport = {kDefaultViewportWidth, kDefaultViewportHeight}) {
+    CV_Assert(!image.empty());
+    viewport_ = cv::Size(std::max(1, viewport.width), std::max(1, viewport.height));
+    levels_.assign(1, image);
+    while ((levels_.back().cols > viewport_.width || levels_.back().rows > viewport_.height) &&
+           std::min(levels_.back().cols, levels_.back().rows) >= 2) {
+      cv::Mat next;
+      cv::pyrDown(levels_.back(), next);
+      levels_.push_back(next);
+    }
+    zoom_ = 1.0;
+    center_ = cv::Point2d(image.cols / 2.0, image.rows / 2.0);
+    dirty_ = true;
+  }
+
+  /// Largest zoom (at most 100 %) that shows the whole image, centred.
+  void fit() {
+    const cv::Size s = imageSize();
+    zoom_ = std::min({1.0, static_cast<double>(viewport_.width) / s.width,
+                      static_cast<double>(viewport_.height) / s.height});
+    center_ = cv::Point2d(s.width / 2.0, s.height / 2.0);
+    dirty_ = true;
+  }
+
+  /**
+   * @brief Sets the zoom (view pixels per image pixel), keeping the image point under
+   *        @p anchor (view coordinates) in place.
+   */
+  void setZoom(double zoom, cv::Point2d anchor) {
+    const cv::Point2d fixed = viewToImage(anchor);
+    zoom_ = std::clamp(zoom, 1e-4, 64.0);
+    center_ = fixed - (anchor - viewCenter()) / zoom_;
+    clampCenter();
+    dirty_ = true;
+  }
+
+  /// Sets the zoom around the centre of the view.
+  void setZoom(double zoom) { setZoom(zoom, viewCenter()); }
+
+  /// Moves the view so the image follows a drag of @p delta view pixels.
+  void panBy(cv::Point2d delta) {
+    center_ -= delta / zoom_;
+    clampCenter();
+    dirty_ = true;
+  }
+
+  /// Full-resolution image coordinates of a view pixel.
+  cv::Point2d viewToImage(cv::Point2d view) const {
+    return center_ + (view - viewCenter()) / zoom_;
+  }
+
+  /// View coordinates of a full-resolution image point.
+  cv::Point2d imageToView(cv::Point2d image) const {
+    return (image - center_) * zoom_ + viewCenter();
+  }
+
+  /// Size of the rendered view: the scaled image, capped to the viewport.
+  cv::Size viewSize() const {
+    const cv::Size s = imageSize();
+    return cv::Size(std::clamp(static_cast<int>(std::ceil(s.width * zoom_)), 1, viewport_.width),
+                    std::clamp(static_cast<int>(std::ceil(s.height * zoom_)), 1,
+                               viewport_.height));
+  }
+
+  /**
+   * @brief Re-renders the view if the zoom or pan changed; frame() is reset to base().
+   * @return True if a new view was rendered (overlays must be redrawn)
+   */
+  bool render() {
+    if (!dirty_) return false;
+    // Coarsest level that still has at least as many pixels as the view shows
+    size_t k = 0;
+    while (k + 1 < levels_.size() && levelScale(k + 1).x >= zoom_) ++k;
+    const cv::Point2d s = levelScale(k);
+    const cv::Point2d c = viewCenter();
+
+    // View pixel v shows level pixel s * (center + (v - c) / zoom + 0.5) - 0.5
+    const cv::Matx23d viewToLevel(s.x / zoom_, 0, s.x * (center_.x - c.x / zoom_ + 0.5) - 0.5,
+                                  0, s.y / zoom_, s.y * (center_.y - c.y / zoom_ + 0.5) - 0.5);
+    cv::warpAffine(levels_[k], base_, viewToLevel, viewSize(),
+                   cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_CONSTANT);
+    base_.copyTo(frame_);
+    level_ = static_cast<int>(k);
+    dirty_ = false;
+    return true;
+  }
+
+  /// Restores the overlay-free view on the full rows spanned by @p dirty.
+  void clearOverlay(const cv::Rect& dirty) {
+    const cv::Rect rows = cv::Rect(0, dirty.y, frame_.cols, dirty.height) &
+                          cv::Rect(0, 0, frame_.cols, frame_.rows);
+    if (!rows.empty()) base_(rows).copyTo(frame_(rows));
+  }
+
+  const cv::Mat& base() const { return base_; }
+  cv::Mat& frame() { return frame_; }
+  double zoom() const { return zoom_; }
+  int level() const { return level_; }  ///< Pyramid level of the last render
+  int levels() const { return static_cast<int>(levels_.size()); }
+  cv::Size imageSize() const { return levels_.empty() ? cv::Size() : levels_.front().size(); }
+  bool needsRender() const { return dirty_; }
+
+ private:
+  cv::Point2d viewCenter() const {
+    const cv::Size v = viewSize();
+    return cv::Point2d(v.width / 2.0, v.height / 2.0);
+  }
+
+  /// Size of level @p k relative to level 0, per axis.
+  cv::Point2d levelScale(size_t k) const {
+    return cv::Point2d(static_cast<double>(levels_[k].cols) / levels_[0].cols,
+                       static_cast<double>(levels_[k].rows) / levels_[0].rows);
+  }
+
+  /// Keeps the view inside the image, or centres the image when it is smaller than the view.
+  void clampCenter() {
+    const cv::Size s = imageSize();
+    const cv::Point2d half = viewCenter() / zoom_;
+    auto clampAxis = [](double c, double h, double extent) {
+      return 2 * h >= extent ? extent / 2.0 : std::clamp(c, h, extent - h);
+    };
+    center_.x = clampAxis(center_.x, half.x, s.width);
+    center_.y = clampAxis(center_.y, half.y, s.height);
+  }
+
+  std::vector<cv::Mat> levels_;  ///< Mip pyramid, level 0 = the source image
+  cv::Size viewport_{kDefaultViewportWidth, kDefaultViewportHeight};
+  double zoom_ = 1.0;       ///< View pixels per image pixel
+  cv::Point2d center_;      ///< Image point shown at the centre of the view
+  cv::Mat base_;            ///< Rendered view without overlays
+  cv::Mat frame_;           ///< base_ plus whatever the caller drew
+  int level_ = 0;
+  bool dirty_ = true;
+};
+
+}  // namespace portfolio
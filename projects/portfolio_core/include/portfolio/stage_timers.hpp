@@ -0,0 +1,132 @@
+/**
+ * @file stage_timers.hpp
+ * @brief Scoped stage timers and counters, exportable as JSON or as a Chrome trace.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace portfolio {
+
+/// One timed execution of a stage.
+struct StageEvent {
+  std::string name;
+  std::uint32_t thread = 0;   ///< Small per-thread id, in order of first use
+  std::int64_t startUs = 0;   ///< Microseconds since the recorder was created or cleared
+  std::int64_t durationUs = 0;
+};
+
+/// Latency statistics of all events of one stage.
+struct StageSummary {
+  std::string name;
+  std::size_t count = 0;
+  double totalMs = 0, meanMs = 0, p50Ms = 0, p95Ms = 0, maxMs = 0;
+};
+
+/**
+ * @brief Thread-safe recorder of stage events and named counters.
+ *
+ * Stages are recorded with ScopedStage; counters (frames dropped, codes found, cache hits...)
+ * with count(). A disabled recorder ignores both at the cost of one relaxed check, so
+ * instrumentation can stay in the code and be switched on by a command-line flag.
+ *
+ * writeJson() exports the per-stage summary and the counters; writeChromeTrace() exports every
+ * event in the Trace Event format understood by chrome://tracing and Perfetto, one track per
+ * thread, with the counters as counter tracks.
+ */
+class StageTimers {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  explicit StageTimers(bool enabled = true) : enabled_(enabled), epoch_(Clock::now()) {}
+
+  StageTimers(const StageTimers&) = delete;
+  StageTimers& operator=(const StageTimers&) = delete;
+
+  /// Process-wide recorder used by ScopedStage by default; starts disabled.
+  static StageTimers& global();
+
+  void setEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+
+  /// Records one execution of @p name on the calling thread.
+  void record(const std::string& name, Clock::time_point start, Clock::time_point end);
+
+  /// Adds @p delta to counter @p name.
+  void count(const std::string& name, std::int64_t delta = 1);
+
+  /// Drops all events and counters and restarts the time base.
+  void clear();
+
+  std::vector<StageEvent> events() const;
+  std::map<std::string, std::int64_t> counters() const;
+
+  /// Per-stage statistics, in order of first appearance.
+  std::vector<StageSummary> summary() const;
+
+  /**
+   * @brief Writes {"stages": [...summary...], "counters": {...}}.
+   * @return False if the file cannot be written
+   */
+  bool writeJson(const std::filesystem::path& path) const;
+
+  /**
+   * @brief Writes every event as a Chrome / Perfetto trace.
+   * @return False if the file cannot be written
+   */
+  bool writeChromeTrace(const std::filesystem::path& path) const;
+
+ private:
+  /// Id of the calling thread, assigned on first use.
+  static std::uint32_t threadId();
+
+  mutable std::mutex mutex_;
+  std::atomic<bool> enabled_;
+  Clock::time_point epoch_;
+  std::vector<StageEvent> events_;
+  std::vector<std::pair<std::string, std::int64_t>> counters_;  ///< In order of first use
+};
+
+/**
+ * @brief RAII timer: records the lifetime of the object as one event of stage @p name.
+ *
+ * Nothing is recorded if the recorder is disabled when the stage starts. elapsedMs() is
+ * available either way, so callers can keep their own statistics.
+ */
+class ScopedStage {
+ public:
+  explicit ScopedStage(std::string name, StageTimers& timers = StageTimers::global())
+      : timers_(timers),
+        name_(std::move(name)),
+        active_(timers.enabled()),
+        start_(StageTimers::Clock::now()) {}
+
+  ScopedStage(const ScopedStage&) = delete;
+  ScopedStage& operator=(const ScopedStage&) = delete;
+
+  ~ScopedStage() {
+    if (active_) timers_.record(name_, start_, StageTimers::Clock::now());
+  }
+
+  /// Milliseconds since the stage started.
+  double elapsedMs() const {
+    return std::chrono::duration<double, std::milli>(StageTimers::Clock::now() - start_).count();
+  }
+
+ private:
+  StageTimers& timers_;
+  std::string name_;
+  bool active_;
+  StageTimers::Clock::time_point start_;
+};
+
+}  // namespace portfolio
@@ -0,0 +1,152 @@
+/**
+ * @file texture_energy_index.hpp
+ * @brief Constant-time texture energy of any image rectangle, with incremental updates.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <vector>
+
+namespace portfolio {
+
+/**
+ * @brief Sum of squared Laplacian responses over rectangles of one 8-bit plane.
+ *
+ * The squared Laplacian map is computed once and summarized by one integral image per tile, so
+ * query() costs four lookups per tile the rectangle touches (at most four for rectangles no
+ * larger than a tile) instead of a colour conversion and a Laplacian per patch. After an edit,
+ * update() recomputes the Laplacian only around the dirty rectangle and rebuilds only the
+ * integrals of the tiles it touches; the rest of the index stays valid.
+ */
+class TextureEnergyIndex {
+ public:
+  static constexpr int kDefaultTileSize = 64;
+
+  TextureEnergyIndex() = default;
+
+  /// Builds the index of @p plane; see build().
+  explicit TextureEnergyIndex(const cv::Mat& plane, double scale = 1.0,
+                              int tileSize = kDefaultTileSize) {
+    build(plane, scale, tileSize);
+  }
+
+  /**
+   * @brief (Re)builds the whole index.
+   * @param plane Single-channel 8-bit image (e.g. the H or V channel)
+   * @param scale Factor applied to the Laplacian before squaring
+   * @param tileSize Side of the tiles holding independent integral images
+   */
+  void build(const cv::Mat& plane, double scale = 1.0, int tileSize = kDefaultTileSize) {
+    CV_Assert(plane.type() == CV_8UC1);
+    scale_ = scale;
+    tile_ = std::max(8, tileSize);
+    tilesX_ = (plane.cols + tile_ - 1) / tile_;
+    tilesY_ = (plane.rows + tile_ - 1) / tile_;
+    energy_.create(plane.size(), CV_32F);
+    computeEnergy(plane, cv::Rect(0, 0, plane.cols, plane.rows));
+    tileSums_.assign(static_cast<size_t>(tilesX_) * tilesY_, cv::Mat());
+    for (int ty = 0; ty < tilesY_; ++ty)
+      for (int tx = 0; tx < tilesX_; ++tx) rebuildTile(tx, ty);
+  }
+
+  /**
+   * @brief Refreshes the index after the pixels of @p dirty changed in @p plane.
+   *
+   * The Laplacian reads a one-pixel neighbourhood, so energies are recomputed on @p dirty grown
+   * by one pixel, using the real neighbours of the plane rather than a border extrapolation; the
+   * result is identical to a full rebuild.
+   */
+  void update(const cv::Mat& plane, const cv::Rect& dirty) {
+    CV_Assert(plane.size() == energy_.size() && plane.type() == CV_8UC1);
+    const cv::Rect grown =
+        cv::Rect(dirty.x - 1, dirty.y - 1, dirty.width + 2, dirty.height + 2) & bounds();
+    if (grown.empty()) return;
+    computeEnergy(plane, grown);
+    for (int ty = grown.y / tile_; ty <= (grown.br().y - 1) / tile_; ++ty)
+      for (int tx = grown.x / tile_; tx <= (grown.br().x - 1) / tile_; ++tx) rebuildTile(tx, ty);
+  }
+
+  /// Texture energy inside @p rect (clipped to the image).
+  double query(const cv::Rect& rect) const {
+    const cv::Rect r = rect & bounds();
+    if (r.empty()) return 0.0;
+    double total = 0.0;
+    for (int ty = r.y / tile_; ty <= (r.br().y - 1) / tile_; ++ty) {
+      for (int tx = r.x / tile_; tx <= (r.br().x - 1) / tile_; ++tx) {
+        const cv::Point origin(tx * tile_, ty * tile_);
+        const cv::Rect local = (r & cv::Rect(origin, cv::Size(tile_, tile_))) - origin;
+        const cv::Mat& sum = tileSums_[static_cast<size_t>(ty) * tilesX_ + tx];
+        total += sum.at<double>(local.br().y, local.br().x) -
+                 sum.at<double>(local.y, local.br().x) - sum.at<double>(local.br().y, local.x) +
+                 sum.at<double>(local.y, local.x);
+      }
+    }
+    return total;
+  }
+
+  /**
+   * @brief Lowest-energy patch of @p patchSize whose centre lies on rings around @p center.
+   *
+   * Rings have radii minDist, minDist + step, ... up to maxDist, with candidates about @p step
+   * pixels apart along each ring. Only patches fully inside the image are considered; on equal
+   * energy the nearer candidate wins.
+   *
+   * @return Rectangle of the best patch, empty if no candidate fits.
+   */
+  cv::Rect lowestEnergyPatch(cv::Point center, cv::Size patchSize, int minDist, int maxDist,
+                             int step) const {
+    step = std::max(1, step);
+    const cv::Rect area = bounds();
+    cv::Rect best;
+    double bestEnergy = std::numeric_limits<double>::infinity();
+    for (int dist = std::max(1, minDist); dist <= std::max(minDist, maxDist); dist += step) {
+      const int count = std::max(8, static_cast<int>(std::ceil(2 * CV_PI * dist / step)));
+      for (int k = 0; k < count; ++k) {
+        const double angle = 2 * CV_PI * k / count;
+        const cv::Point c = center + cv::Point(cvRound(dist * std::cos(angle)),
+                                               cvRound(dist * std::sin(angle)));
+        const cv::Rect rect(c.x - patchSize.width / 2, c.y - patchSize.height / 2,
+                            patchSize.width, patchSize.height);
+        if ((rect & area) != rect) continue;
+        const double e = query(rect);
+        if (e < bestEnergy) {
+          bestEnergy = e;
+          best = rect;
+        }
+      }
+    }
+    return best;
+  }
+
+  cv::Size size() const { return energy_.size(); }
+  bool empty() const { return energy_.empty(); }
+
+ private:
+  cv::Rect bounds() const { return cv::Rect(0, 0, energy_.cols, energy_.rows); }
+
+  /// Writes the squared Laplacian of @p plane into energy_ over @p roi.
+  void computeEnergy(const cv::Mat& plane, const cv::Rect& roi) {
+    cv::Mat lap = energy_(roi);
+    cv::Laplacian(plane(roi), lap, CV_32F, 3, scale_, 0, cv::BORDER_DEFAULT);
+    cv::multiply(lap, lap, lap);
+  }
+
+  void rebuildTile(int tx, int ty) {
+    const cv::Rect r = cv::Rect(tx * tile_, ty * tile_, tile_, tile_) & bounds();
+    cv::integral(energy_(r), tileSums_[static_cast<size_t>(ty) * tilesX_ + tx], CV_64F);
+  }
+
+  cv::Mat energy_;                 ///< Squared Laplacian, CV_32F
+  std::vector<cv::Mat> tileSums_;  ///< Integral image of each tile, CV_64F, row-major tiles
+  double scale_ = 1.0;
+  int tile_ = kDefaultTileSize;
+  int tilesX_ = 0;
+  int tilesY_ = 0;
+};
+
+}  // namespace portfolio
@@ -0,0 +1,39 @@
+/**
+ * @file image_io.cpp
+ * @brief Image load/save/display helpers.
+ */
+
+#include "portfolio/image_io.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <opencv2/highgui.hpp>
+
+namespace portfolio {
+
+cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags) {
+  cv::Mat img = cv::imread(path.string(), flags);
+  if (img.empty()) {
+    std::cerr << "ERROR: Could not load image: " << path << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  return img;
+}
+
+void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
+                     const std::vector<int>& params) {
+  if (!cv::imwrite(path.string(), image, params)) {
+    std::cerr << "ERROR: Could not save image: " << path << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+void showImage(const std::string& windowName, const cv::Mat& image, cv::Size windowSize) {
+  cv::namedWindow(windowName, cv::WINDOW_NORMAL);
+  cv::resizeWindow(windowName, windowSize.width, windowSize.height);
+  cv::imshow(windowName, image);
+  cv::waitKey(0);
+  cv::destroyWindow(windowName);
+}
+
+}  // namespace portfolio
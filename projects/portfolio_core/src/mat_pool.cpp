@@ -0,0 +1,44 @@
+/**
+ * @file mat_pool.cpp
+ * @brief Per-thread cv::Mat buffer pool.
+ */
+
+#include "portfolio/mat_pool.hpp"
+
+#include <algorithm>
+
+namespace portfolio {
+
+MatPool& MatPool::local() {
+  thread_local MatPool pool;
+  return pool;
+}
+
+MatPool::Lease MatPool::acquire(cv::Size size, int type) {
+  const std::size_t bytes = static_cast<std::size_t>(size.area()) * CV_ELEM_SIZE(type);
+  // Smallest idle buffer that fits
+  auto it = std::find_if(idle_.begin(), idle_.end(),
+                         [&](const cv::Mat& b) { return b.total() >= bytes; });
+  cv::Mat buffer;
+  if (it != idle_.end()) {
+    buffer = std::move(*it);
+    idle_.erase(it);
+    ++reuses_;
+  } else {
+    buffer.create(1, static_cast<int>(std::max<std::size_t>(bytes, 1)), CV_8UC1);
+    ++allocations_;
+  }
+  return Lease(this, std::move(buffer), size, type);
+}
+
+void MatPool::release(cv::Mat buffer) {
+  if (buffer.empty() || maxIdle_ == 0) return;
+  auto pos = std::lower_bound(
+      idle_.begin(), idle_.end(), buffer.total(),
+      [](const cv::Mat& b, std::size_t capacity) { return b.total() < capacity; });
+  idle_.insert(pos, std::move(buffer));
+  // Keep the largest buffers: they can serve every smaller request
+  if (idle_.size() > maxIdle_) idle_.erase(idle_.begin());
+}
+
+}  // namespace portfolio
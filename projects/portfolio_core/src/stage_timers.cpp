@@ -0,0 +1,159 @@
+/**
+ * @file stage_timers.cpp
+ * @brief Stage event recorder and its JSON / Chrome trace exporters.
+ */
+
+#include "portfolio/stage_timers.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+
+namespace portfolio {
+
+namespace {
+
+/// Escapes a string for a JSON string literal.
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (char c : s) {
+    if (c == '"' || c == '\\') out += '\\';
+    out += c;
+  }
+  return out;
+}
+
+/// Nearest-rank percentile of ascending samples.
+double percentile(const std::vector<double>& sorted, double p) {
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+}  // namespace
+
+StageTimers& StageTimers::global() {
+  static StageTimers timers(false);
+  return timers;
+}
+
+std::uint32_t StageTimers::threadId() {
+  static std::atomic<std::uint32_t> next{0};
+  thread_local const std::uint32_t id = next++;
+  return id;
+}
+
+void StageTimers::record(const std::string& name, Clock::time_point start,
+                         Clock::time_point end) {
+  if (!enabled()) return;
+  using std::chrono::microseconds;
+  StageEvent event{name, threadId(), 0,
+                   std::chrono::duration_cast<microseconds>(end - start).count()};
+  std::lock_guard<std::mutex> lock(mutex_);
+  event.startUs = std::chrono::duration_cast<microseconds>(start - epoch_).count();
+  events_.push_back(std::move(event));
+}
+
+void StageTimers::count(const std::string& name, std::int64_t delta) {
+  if (!enabled()) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = std::find_if(counters_.begin(), counters_.end(),
+                         [&](const auto& c) { return c.first == name; });
+  if (it == counters_.end()) {
+    counters_.emplace_back(name, delta);
+  } else {
+    it->second += delta;
+  }
+}
+
+void StageTimers::clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  events_.clear();
+  counters_.clear();
+  epoch_ = Clock::now();
+}
+
+std::vector<StageEvent> StageTimers::events() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return events_;
+}
+
+std::map<std::string, std::int64_t> StageTimers::counters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return std::map<std::string, std::int64_t>(counters_.begin(), counters_.end());
+}
+
+std::vector<StageSummary> StageTimers::summary() const {
+  // Group durations by stage, in order of first appearance
+  std::vector<std::pair<std::string, std::vector<double>>> stages;
+  for (const auto& e : events()) {
+    auto it = std::find_if(stages.begin(), stages.end(),
+                           [&](const auto& s) { return s.first == e.name; });
+    if (it == stages.end()) it = stages.emplace(stages.end(), e.name, std::vector<double>());
+    it->second.push_back(e.durationUs / 1000.0);
+  }
+
+  std::vector<StageSummary> out;
+  for (auto& [name, ms] : stages) {
+    std::sort(ms.begin(), ms.end());
+    StageSummary s;
+    s.name = name;
+    s.count = ms.size();
+    for (double t : ms) s.totalMs += t;
+    s.meanMs = s.totalMs / ms.size();
+    s.p50Ms = percentile(ms, 50);
+    s.p95Ms = percentile(ms, 95);
+    s.maxMs = ms.back();
+    out.push_back(s);
+  }
+  return out;
+}
+
+bool StageTimers::writeJson(const std::filesystem::path& path) const {
+  std::ofstream out(path);
+  if (!out) return false;
+  const std::vector<StageSummary> stages = summary();
+  out << "{\n  \"stages\": [\n";
+  for (size_t i = 0; i < stages.size(); ++i) {
+    const StageSummary& s = stages[i];
+    out << "    {\"name\": \"" << jsonEscape(s.name) << "\", \"count\": " << s.count
+        << ", \"total_ms\": " << s.totalMs << ", \"mean_ms\": " << s.meanMs
+        << ", \"p50_ms\": " << s.p50Ms << ", \"p95_ms\": " << s.p95Ms
+        << ", \"max_ms\": " << s.maxMs << "}" << (i + 1 < stages.size() ? "," : "") << "\n";
+  }
+  out << "  ],\n  \"counters\": {";
+  const auto values = counters();
+  size_t i = 0;
+  for (const auto& [name, value] : values) {
+    out << (i++ ? ", " : "") << "\"" << jsonEscape(name) << "\": " << value;
+  }
+  out << "}\n}\n";
+  return static_cast<bool>(out);
+}
+
+bool StageTimers::writeChromeTrace(const std::filesystem::path& path) const {
+  std::ofstream out(path);
+  if (!out) return false;
+  const std::vector<StageEvent> all = events();
+  std::int64_t endUs = 0;
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  bool first = true;
+  for (const auto& e : all) {
+    out << (first ? "" : ",\n") << "  {\"name\": \"" << jsonEscape(e.name)
+        << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << e.thread << ", \"ts\": " << e.startUs
+        << ", \"dur\": " << e.durationUs << "}";
+    endUs = std::max(endUs, e.startUs + e.durationUs);
+    first = false;
+  }
+  // Counters only hold final values: show them as one sample at the end of the trace
+  for (const auto& [name, value] : counters()) {
+    out << (first ? "" : ",\n") << "  {\"name\": \"" << jsonEscape(name)
+        << "\", \"ph\": \"C\", \"pid\": 1, \"ts\": " << endUs << ", \"args\": {\"value\": "
+        << value << "}}";
+    first = false;
+  }
+  out << "\n]}\n";
+  return static_cast<bool>(out);
+}
+
+}  // namespace portfolio
@@ -4,9 +4,30 @@
  * around the detected QR code, displays the annotated image in a resizable window, prints the
  * decoded text to the console, and saves the result to disk.
  *
+ * Batch mode scans a directory of images or the frames of a video for any number of codes per
+ * image. Codes are detected on a copy reduced to --detect-side pixels (long side), and each
+ * candidate is decoded from a full-resolution crop around it. Images run across a thread pool
+ * with one QRCodeDetector per worker, and every image produces one JSON line with its codes and
+ * its latency.
+ *
+ * Usage:
+ *   ./qr_decoder
+ *   ./qr_decoder --batch <image_dir|video> [--workers N] [--decoders N] [--detect-side N]
+ *                [--output results.jsonl]
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgcodecs.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -14,50 +35,306 @@
 #include <opencv2/opencv.hpp>
 
 #include "config.pch"
+#include "portfolio/bounded_queue.hpp"
+#include "portfolio/image_io.hpp"
 std::string datadir = std::string(DATA_DIR);
 
+static constexpr int kDefaultDetectSide = 1280;  ///< Long side of the detection copy
+static constexpr double kCropMargin = 0.15;      ///< Crop margin around a candidate, of its size
+
+//--------------------------------------------------------------------------------------
+// Batch mode
+//--------------------------------------------------------------------------------------
+
+/// Source and thread counts of the batch mode.
+struct BatchOptions {
+  std::filesystem::path source;  ///< Image directory or video file
+  std::filesystem::path output;  ///< JSON lines file, empty = stdout
+  int workers = 0;               ///< Scanning threads, 0 = one per hardware thread
+  int decoders = 1;              ///< Image decode threads (a video always uses one)
+  int detectSide = kDefaultDetectSide;
+};
+
+/**
+ * @brief Parses `--batch <source> [options]`; returns false on bad input.
+ */
+bool parseBatchOptions(int argc, char* argv[], BatchOptions& opts) {
+  if (argc < 3) return false;
+  opts.source = argv[2];
+  try {
+    for (int i = 3; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--workers" && hasValue) {
+        opts.workers = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--decoders" && hasValue) {
+        opts.decoders = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--detect-side" && hasValue) {
+        opts.detectSide = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--output" && hasValue) {
+        opts.output = argv[++i];
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
+  }
+  return true;
+}
+
+/// One decoded code: its text and corners in full-resolution coordinates.
+struct QrCode {
+  std::string text;
+  std::vector<cv::Point2f> corners;
+};
+
 /**
- * @brief Loads an image from disk and checks for errors.
- * @param path File path
- * @param flags Imread flags (default: IMREAD_UNCHANGED)
- * @return Loaded cv::Mat
+ * @brief Finds and decodes every QR code of @p image.
+ *
+ * Detection (the expensive finder-pattern search) runs on a copy whose long side is at most
+ * @p detectSide; each candidate is then decoded from a full-resolution crop around its scaled
+ * corners, so small modules keep their resolution. Candidates that do not decode are dropped.
+ *
+ * @param detectSide Long side of the detection copy; 0 decodes with detectAndDecodeMulti at
+ *        full resolution instead
  */
-cv::Mat loadImage(const std::string& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat img = cv::imread(datadir + "/" + path, flags);
-  if (img.empty()) {
-    std::cerr << "Error: Unable to load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
+std::vector<QrCode> scanImage(cv::QRCodeDetector& detector, const cv::Mat& image,
+                              int detectSide) {
+  std::vector<QrCode> codes;
+  const int longSide = std::max(image.cols, image.rows);
+  if (detectSide <= 0 || longSide <= detectSide) {
+    std::vector<std::string> texts;
+    std::vector<cv::Point2f> points;
+    if (!detector.detectAndDecodeMulti(image, texts, points)) return codes;
+    for (size_t i = 0; i < texts.size(); ++i) {
+      if (texts[i].empty()) continue;
+      codes.push_back(
+          {texts[i], std::vector<cv::Point2f>(points.begin() + 4 * i, points.begin() + 4 * i + 4)});
+    }
+    return codes;
+  }
+
+  const double scale = static_cast<double>(detectSide) / longSide;
+  cv::Mat small;
+  cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+  std::vector<cv::Point2f> points;
+  if (!detector.detectMulti(small, points)) return codes;
+
+  const cv::Rect bounds(0, 0, image.cols, image.rows);
+  for (size_t i = 0; i + 4 <= points.size(); i += 4) {
+    std::vector<cv::Point2f> corners;
+    for (size_t k = i; k < i + 4; ++k) corners.push_back(points[k] * (1.0 / scale));
+    const cv::Rect box = cv::boundingRect(corners);
+    const int margin = cvRound(kCropMargin * std::max(box.width, box.height)) + 2;
+    const cv::Rect roi =
+        cv::Rect(box.x - margin, box.y - margin, box.width + 2 * margin, box.height + 2 * margin) &
+        bounds;
+    std::vector<cv::Point2f> local;
+    for (const auto& c : corners) local.push_back(c - cv::Point2f(roi.tl()));
+    std::string text = detector.decode(image(roi), local);
+    if (!text.empty()) codes.push_back({std::move(text), std::move(corners)});
+  }
+  return codes;
+}
+
+/// Escapes a string for a JSON string literal (QR payloads may hold any byte).
+std::string jsonEscape(const std::string& s) {
+  std::string out;
+  for (unsigned char c : s) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c == '\n') {
+      out += "\\n";
+    } else if (c == '\r') {
+      out += "\\r";
+    } else if (c == '\t') {
+      out += "\\t";
+    } else if (c < 0x20) {
+      char buf[8];
+      std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+      out += buf;
+    } else {
+      out += static_cast<char>(c);
+    }
+  }
+  return out;
+}
+
+/// One JSON line describing the scan of one image or frame.
+std::string resultJson(const std::string& source, long long index, cv::Size size,
+                       double latencyMs, const std::vector<QrCode>& codes) {
+  std::string line = "{\"source\": \"" + jsonEscape(source) + "\", \"index\": " +
+                     std::to_string(index) + ", \"width\": " + std::to_string(size.width) +
+                     ", \"height\": " + std::to_string(size.height) +
+                     cv::format(", \"latency_ms\": %.3f, \"codes\": [", latencyMs);
+  for (size_t i = 0; i < codes.size(); ++i) {
+    line += (i ? ", " : "") + std::string("{\"text\": \"") + jsonEscape(codes[i].text) +
+            "\", \"corners\": [";
+    for (size_t k = 0; k < codes[i].corners.size(); ++k) {
+      line += cv::format("%s[%.1f, %.1f]", k ? ", " : "", codes[i].corners[k].x,
+                         codes[i].corners[k].y);
+    }
+    line += "]}";
   }
-  return img;
+  return line + "]}";
+}
+
+/// Sorted list of the image files directly inside @p dir.
+std::vector<std::filesystem::path> listImages(const std::filesystem::path& dir,
+                                              std::error_code& ec) {
+  std::vector<std::filesystem::path> images;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (entry.is_regular_file() &&
+        (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".tif" ||
+         ext == ".tiff")) {
+      images.push_back(entry.path());
+    }
+  }
+  std::sort(images.begin(), images.end());
+  return images;
 }
 
 /**
- * @brief Saves an image to disk (under the same data directory) and checks for errors.
- * @param path  Relative file path (e.g. "output/result.png")
- * @param img   The cv::Mat image to write
- * @param params Optional vector of imwrite parameters (e.g. compression level)
+ * @brief Scans a directory or video with a decode stage and a pool of scanning workers.
+ *
+ * Decoder threads (one for a video, which must be read in order) feed a bounded queue, so at
+ * most two decoded images per worker wait in memory. Each worker owns its QRCodeDetector and
+ * writes its JSON lines under a mutex, so lines appear in completion order; "index" gives the
+ * position in the source. A summary goes to stderr, keeping stdout pure JSON lines.
+ *
+ * @return EXIT_SUCCESS unless the source or the output could not be opened.
  */
-void saveImage(const std::string& path, const cv::Mat& img,
-               const std::vector<int>& params = std::vector<int>{}) {
-  // Assumes you have defined somewhere:
-  //   const std::string datadir = "../data";
-  const std::string fullPath = datadir + "/" + path;
-  if (!cv::imwrite(fullPath, img, params)) {
-    std::cerr << "Error: Unable to save image: " << fullPath << std::endl;
-    std::exit(EXIT_FAILURE);
+int runBatch(const BatchOptions& opts) {
+  std::vector<std::filesystem::path> images;
+  cv::VideoCapture video;
+  const bool isDirectory = std::filesystem::is_directory(opts.source);
+  if (isDirectory) {
+    std::error_code ec;
+    images = listImages(opts.source, ec);
+    if (ec) {
+      std::cerr << "Error: Unable to read directory: " << opts.source << std::endl;
+      return EXIT_FAILURE;
+    }
+  } else if (!video.open(opts.source.string())) {
+    std::cerr << "Error: Unable to open video: " << opts.source << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ofstream file;
+  if (!opts.output.empty()) {
+    file.open(opts.output);
+    if (!file) {
+      std::cerr << "Error: Unable to write: " << opts.output << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  std::ostream& out = opts.output.empty() ? std::cout : file;
+
+  const int numWorkers = std::max(1, opts.workers > 0
+                                         ? opts.workers
+                                         : static_cast<int>(std::thread::hardware_concurrency()));
+  const int numDecoders = isDirectory ? opts.decoders : 1;
+  // Parallelism comes from the image pool; nested OpenCV threads would only oversubscribe
+  if (numWorkers > 1) cv::setNumThreads(1);
+
+  struct Job {
+    long long index;
+    std::string source;
+    cv::Mat image;
+  };
+  portfolio::BoundedQueue<Job> queue(2 * numWorkers);
+  std::atomic<size_t> nextImage{0};
+  std::atomic<int> decodersLeft{numDecoders};
+  std::atomic<long long> scanned{0}, codesFound{0}, failed{0};
+  std::vector<double> totalMs(numWorkers, 0.0), maxMs(numWorkers, 0.0);
+  std::mutex outMutex;
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int d = 0; d < numDecoders; ++d) {
+    threads.emplace_back([&] {
+      if (isDirectory) {
+        for (size_t i = nextImage++; i < images.size(); i = nextImage++) {
+          cv::Mat image = cv::imread(images[i].string(), cv::IMREAD_COLOR);
+          if (image.empty()) {
+            std::cerr << "Error: Unable to load image: " << images[i] << std::endl;
+            failed += 1;
+            continue;
+          }
+          if (!queue.push({static_cast<long long>(i), images[i].string(), std::move(image)}))
+            break;
+        }
+      } else {
+        cv::Mat frame;
+        for (long long index = 0; video.read(frame); ++index) {
+          if (!queue.push({index, opts.source.string(), std::move(frame)})) break;
+          frame = cv::Mat();  // moved out: decode into a fresh buffer
+        }
+      }
+      if (--decodersLeft == 0) queue.close();
+    });
+  }
+
+  for (int w = 0; w < numWorkers; ++w) {
+    threads.emplace_back([&, w] {
+      cv::QRCodeDetector detector;
+      while (auto job = queue.pop()) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const std::vector<QrCode> codes = scanImage(detector, job->image, opts.detectSide);
+        const double ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0)
+                .count();
+        totalMs[w] += ms;
+        maxMs[w] = std::max(maxMs[w], ms);
+        scanned += 1;
+        codesFound += static_cast<long long>(codes.size());
+        const std::string line = resultJson(job->source, job->index, job->image.size(), ms, codes);
+        std::lock_guard<std::mutex> lock(outMutex);
+        out << line << '\n';
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+  out.flush();
+
+  const double wallMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  double sumMs = 0, worstMs = 0;
+  for (int w = 0; w < numWorkers; ++w) {
+    sumMs += totalMs[w];
+    worstMs = std::max(worstMs, maxMs[w]);
   }
+  std::cerr << "Scanned " << scanned << " images (" << codesFound << " codes) in "
+            << wallMs / 1000.0 << " s: " << scanned * 1000.0 / std::max(wallMs, 1e-9)
+            << " images/s, mean " << (scanned > 0 ? sumMs / scanned : 0.0) << " ms, max "
+            << worstMs << " ms per image with " << numWorkers << " workers" << std::endl;
+  return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  // Headless batch mode
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    BatchOptions opts;
+    if (!parseBatchOptions(argc, argv, opts)) {
+      std::cerr << "Usage: " << argv[0] << " --batch <image_dir|video> [--workers N]"
+                << " [--decoders N] [--detect-side N] [--output results.jsonl]" << std::endl;
+      return EXIT_FAILURE;
+    }
+    return runBatch(opts);
+  }
+
   // #Step 1: Read Image and store it in variable img
-  cv::Mat IDCard = loadImage("../data/IDCard.jpg");
+  cv::Mat IDCard = portfolio::loadImageOrExit(datadir + "/../data/IDCard.jpg");
 
   // Checking witdh and heigth
   std::cout << IDCard.size().height << " " << IDCard.size().width << std::endl;
 
   // #Step 2: Detect QR Code in the Image
-  cv::Mat bbox, rectifiedImage;
-
   // Creating a QRCodeDetector Object
   cv::QRCodeDetector qrDecoder = cv::QRCodeDetector();
 
@@ -67,36 +344,33 @@ int main() {
   std::vector<cv::Point> vertices;
   std::string opencvData = qrDecoder.detectAndDecode(IDCard, vertices);
 
-  // Check if a QR Code has been detected
+  // Check if a QR Code has been detected (vertices is only filled on detection)
+  const bool detected = vertices.size() == 4;
   if (opencvData.length() > 0)
     std::cout << "QR Code Detected" << std::endl;
   else
     std::cout << "QR Code NOT Detected" << std::endl;
 
   // #Step 3: Draw bounding box around the detected QR Code
-  int n = bbox.rows;
   cv::Mat annotated_IDCard = IDCard.clone();
-  cv::Point prevp = vertices[3];
-  for (int i = 0; i < 4; i++) {
-    cv::line(annotated_IDCard, prevp, vertices[i], cv::Scalar(0, 255, 0), 2, cv::LINE_AA);
-    prevp = vertices[i];
+  if (detected) {
+    cv::Point prevp = vertices[3];
+    for (int i = 0; i < 4; i++) {
+      cv::line(annotated_IDCard, prevp, vertices[i], cv::Scalar(0, 255, 0), 2, cv::LINE_AA);
+      prevp = vertices[i];
+    }
   }
   /// Show result
-  cv::namedWindow("Recognized QR", cv::WINDOW_NORMAL);
-  cv::resizeWindow("Recognized QR", 1200, 600);
-  cv::imshow("Recognized QR", annotated_IDCard);
-  cv::waitKey(0);
+  portfolio::showImage("Recognized QR", annotated_IDCard, {1200, 600});
 
   // #Step 4: Print the Decoded Text
   //  Since we have already detected and decoded the QR Code
   //  using qrDecoder.detectAndDecode, we will directly
   //  use the decoded text we obtained at that step (opencvData)
 
-  std::cout << "QR Code Detected!" << std::endl;
-  ///
-  std::cout << "Decoded Data: " << opencvData << std::endl;
+  if (!opencvData.empty()) std::cout << "Decoded Data: " << opencvData << std::endl;
 
   // Step 5: Save and display the result image
   // Write the result image
-  saveImage("../data/QRCodeAnnotated.jpg", annotated_IDCard);
+  portfolio::saveImageOrExit(datadir + "/../data/QRCodeAnnotated.jpg", annotated_IDCard);
 }
\ No newline at end of file
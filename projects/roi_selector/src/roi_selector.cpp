@@ -7,10 +7,17 @@
  *
  * Controls:
  *   - Drag left mouse button to draw ROI.
+ *   - Mouse wheel zooms around the cursor, right-button drag pans.
  *   - Press Enter to exit (saves ROI).
  *   - Press ESC to exit without saving.
+ *
+ * The image is shown through a viewport-sized preview (portfolio::PreviewEngine). While
+ * dragging, only the rows covered by the old and new rectangle are restored and redrawn; the
+ * ROI is kept in full-resolution coordinates and cropped from the original on release.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
 #include <opencv2/highgui.hpp>
@@ -18,107 +25,131 @@
 #include <vector>
 
 #include "config.pch"  // Defines DATA_DIR macro
+#include "portfolio/image_io.hpp"
+#include "portfolio/preview_engine.hpp"
 
 static cv::Scalar kRectColor(255, 255, 0);
 static constexpr int kRectThickness = 2;
+static constexpr double kWheelZoomStep = 1.25;  ///< Zoom factor per mouse-wheel notch
 static const std::filesystem::path kDefaultInput =
     std::filesystem::path(DATA_DIR) / "../data/demo.png";
 static const std::filesystem::path kDefaultOutput =
     std::filesystem::path(DATA_DIR) / "../data/face.png";
 
 /**
- * @brief Loads an image or exits on failure.
- * @param path  Filesystem path to load
- * @param flags imread flags (default: unchanged)
- * @return Loaded cv::Mat
+ * @brief Mouse callback state container.
  */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-    std::cerr << "ERROR: Could not load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return img;
+struct MouseState {
+  cv::Mat image;                      ///< Original image (full resolution)
+  portfolio::PreviewEngine preview;   ///< Viewport onto image
+  cv::Point2d start_pt;               ///< Mouse-down point, image coordinates
+  cv::Point2d end_pt;                 ///< Current/mouse-up point, image coordinates
+  bool drawing{false};                ///< True while dragging
+  bool has_roi{false};                ///< True once a rectangle has been drawn
+  cv::Rect overlay;                   ///< View pixels touched by the drawn rectangle
+  cv::Point pan_origin;               ///< Last position of a right-button pan
+  bool panning{false};
+  bool needs_show{true};              ///< Frame changed since the last imshow
+  std::filesystem::path output_path;  ///< File to save cropped ROI
+};
+
+/**
+ * @brief Redraws the ROI rectangle, restoring only the rows the previous one covered.
+ */
+void drawRoi(MouseState& state) {
+  const cv::Point2d a = state.preview.imageToView(state.start_pt);
+  const cv::Point2d b = state.preview.imageToView(state.end_pt);
+  const cv::Point p1(cvRound(std::min(a.x, b.x)), cvRound(std::min(a.y, b.y)));
+  const cv::Point p2(cvRound(std::max(a.x, b.x)), cvRound(std::max(a.y, b.y)));
+  const cv::Rect next = cv::Rect(p1, p2 + cv::Point(1, 1)) +
+                        cv::Size(2 * kRectThickness, 2 * kRectThickness) -
+                        cv::Point(kRectThickness, kRectThickness);
+
+  state.preview.clearOverlay(state.overlay | next);
+  cv::rectangle(state.preview.frame(), p1, p2, kRectColor, kRectThickness);
+  state.overlay = next;
+  state.needs_show = true;
 }
 
 /**
- * @brief Saves an image or exits on failure.
- * @param path   Destination path
- * @param image  cv::Mat to write
- * @param params Optional imwrite parameters
+ * @brief Re-renders the view after a zoom or pan and puts the ROI back on it.
  */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Failed to save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  std::cout << "Saved ROI to: " << path << std::endl;
+void refreshView(MouseState& state) {
+  if (!state.preview.render()) return;
+  state.overlay = {};
+  if (state.drawing || state.has_roi) drawRoi(state);
+  state.needs_show = true;
 }
 
 /**
- * @brief Mouse callback state container.
+ * @brief Crops the ROI from the full-resolution image and saves it.
  */
-struct MouseState {
-  cv::Mat image;                      ///< Original image
-  cv::Mat display;                    ///< Current display image (with rectangle)
-  cv::Point start_pt;                 ///< Mouse-down point
-  cv::Point end_pt;                   ///< Mouse-up point
-  bool drawing{false};                ///< True while dragging
-  std::filesystem::path output_path;  ///< File to save cropped ROI
-};
+void saveRoi(const MouseState& state) {
+  const cv::Point tl(cvFloor(std::min(state.start_pt.x, state.end_pt.x)),
+                     cvFloor(std::min(state.start_pt.y, state.end_pt.y)));
+  const cv::Point br(cvCeil(std::max(state.start_pt.x, state.end_pt.x)),
+                     cvCeil(std::max(state.start_pt.y, state.end_pt.y)));
+  // Clamp ROI to image bounds
+  const cv::Rect roi = cv::Rect(tl, br) & cv::Rect(0, 0, state.image.cols, state.image.rows);
+
+  if (roi.width > 0 && roi.height > 0) {
+    cv::Mat cropped = state.image(roi).clone();
+    portfolio::saveImageOrExit(state.output_path, cropped);
+    std::cout << "Saved ROI to: " << state.output_path << std::endl;
+  } else {
+    std::cerr << "INFO: Selected ROI has zero area; not saving." << std::endl;
+  }
+}
 
 /**
- * @brief Mouse callback: handles drawing and ROI extraction.
+ * @brief Mouse callback: handles drawing, zoom/pan and ROI extraction.
  */
-void onMouse(int event, int x, int y, int /*flags*/, void* userdata) {
+void onMouse(int event, int x, int y, int flags, void* userdata) {
   auto state = reinterpret_cast<MouseState*>(userdata);
+  const cv::Point2d imagePt = state->preview.viewToImage(cv::Point2d(x, y));
   switch (event) {
     case cv::EVENT_LBUTTONDOWN:
       state->drawing = true;
-      state->start_pt = {x, y};
-      state->display = state->image.clone();
+      state->start_pt = state->end_pt = imagePt;
+      drawRoi(*state);
+      break;
+
+    case cv::EVENT_RBUTTONDOWN:
+      state->panning = true;
+      state->pan_origin = {x, y};
+      break;
+
+    case cv::EVENT_RBUTTONUP:
+      state->panning = false;
       break;
 
     case cv::EVENT_MOUSEMOVE:
       if (state->drawing) {
-        state->display = state->image.clone();
-        cv::rectangle(state->display, state->start_pt, {x, y}, kRectColor, kRectThickness);
+        state->end_pt = imagePt;
+        drawRoi(*state);
+      } else if (state->panning) {
+        state->preview.panBy(cv::Point2d(x - state->pan_origin.x, y - state->pan_origin.y));
+        state->pan_origin = {x, y};
+        refreshView(*state);
       }
       break;
 
+    case cv::EVENT_MOUSEWHEEL: {
+      const double step = cv::getMouseWheelDelta(flags) > 0 ? kWheelZoomStep : 1.0 / kWheelZoomStep;
+      state->preview.setZoom(state->preview.zoom() * step, cv::Point2d(x, y));
+      refreshView(*state);
+      break;
+    }
+
     case cv::EVENT_LBUTTONUP:
+      if (!state->drawing) break;
       state->drawing = false;
-      state->end_pt = {x, y};
-
-      // Normalize coordinates
-      {
-        int x1 = std::min(state->start_pt.x, state->end_pt.x);
-        int x2 = std::max(state->start_pt.x, state->end_pt.x);
-        int y1 = std::min(state->start_pt.y, state->end_pt.y);
-        int y2 = std::max(state->start_pt.y, state->end_pt.y);
-        state->start_pt = {x1, y1};
-        state->end_pt = {x2, y2};
-      }
+      state->has_roi = true;
+      state->end_pt = imagePt;
+      drawRoi(*state);
 
-      // Draw final rectangle
-      state->display = state->image.clone();
-      cv::rectangle(state->display, state->start_pt, state->end_pt, kRectColor, kRectThickness);
-
-      // Crop and save ROI
-      {
-        cv::Rect roi(state->start_pt.x, state->start_pt.y, state->end_pt.x - state->start_pt.x,
-                     state->end_pt.y - state->start_pt.y);
-        // Clamp ROI to image bounds
-        roi &= cv::Rect(0, 0, state->image.cols, state->image.rows);
-
-        if (roi.width > 0 && roi.height > 0) {
-          cv::Mat cropped = state->image(roi).clone();
-          saveImageOrExit(state->output_path, cropped);
-        } else {
-          std::cerr << "INFO: Selected ROI has zero area; not saving." << std::endl;
-        }
-      }
+      // Crop at full resolution and save ROI
+      saveRoi(*state);
       break;
 
     default:
@@ -131,14 +162,16 @@ int main(int argc, char* argv[]) {
   std::filesystem::path input_path = (argc > 1 ? std::filesystem::path(argv[1]) : kDefaultInput);
   std::filesystem::path output_path = (argc > 2 ? std::filesystem::path(argv[2]) : kDefaultOutput);
 
-  // Load image
+  // Load image and show it fitted to the viewport
   MouseState state;
-  state.image = loadImageOrExit(input_path, cv::IMREAD_COLOR);
-  state.display = state.image.clone();
+  state.image = portfolio::loadImageOrExit(input_path, cv::IMREAD_COLOR);
+  state.preview.reset(state.image);
+  state.preview.fit();
+  state.preview.render();
   state.output_path = output_path;
 
   const std::string window_name = "ROI Selector";
-  cv::namedWindow(window_name, cv::WINDOW_NORMAL);
+  cv::namedWindow(window_name, cv::WINDOW_AUTOSIZE);
 
   // Register mouse callback
   cv::setMouseCallback(window_name, onMouse, &state);
@@ -146,13 +179,17 @@ int main(int argc, char* argv[]) {
   // Instruction overlay
   const std::string msg1 = "Drag to select ROI";
   const std::string msg2 = "ESC: exit w/o save   ENTER: exit";
-  cv::putText(state.display, msg1, {10, 30}, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255), 2);
-  cv::putText(state.display, msg2, {10, 60}, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255), 2);
+  cv::Mat& frame = state.preview.frame();
+  cv::putText(frame, msg1, {10, 30}, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255), 2);
+  cv::putText(frame, msg2, {10, 60}, cv::FONT_HERSHEY_SIMPLEX, 0.7, cv::Scalar(255), 2);
 
-  // Main loop
+  // Main loop: imshow only after the frame changed
   int key = 0;
   while (key != 27 && key != 13) {  // ESC or ENTER
-    cv::imshow(window_name, state.display);
+    if (state.needs_show) {
+      cv::imshow(window_name, state.preview.frame());
+      state.needs_show = false;
+    }
     key = cv::waitKey(20) & 0xFF;
   }
 
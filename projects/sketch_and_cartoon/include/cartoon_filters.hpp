@@ -0,0 +1,67 @@
+/**
+ * @file cartoon_filters.hpp
+ * @brief Pencil-sketch mask and cartoon colour filters, shared by sketch_and_cartoon and
+ * portfolio_bench.
+ */
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <string>
+
+/// Colour smoothing used by cartoonify().
+enum class FilterMode {
+  Exact,      ///< Full-resolution bilateral filter (reference quality, slow)
+  Pyramid,    ///< Bilateral filter on a reduced level, upsampled
+  Recursive,  ///< Domain-transform recursive filter (cv::RECURS_FILTER), full resolution
+};
+
+/**
+ * @brief Parses a filter mode name; returns false if unknown.
+ */
+bool parseFilterMode(const std::string& name, FilterMode& mode);
+
+const char* filterModeName(FilterMode mode);
+
+/**
+ * @brief Computes a binary pencil‐sketch mask from the V channel (HSV) of the image.
+ *
+ * Steps:
+ *  1. Take V = max(B, G, R), exactly HSV's V, without converting H and S.
+ *  2. Gaussian‐blur V to obtain low‐frequency content.
+ *  3. Subtract: high = blurredV − V to isolate dark strokes.
+ *  4. Threshold with THRESH_BINARY_INV to produce white-on-black strokes.
+ *
+ * V is computed in one pass over the interleaved rows, without splitting the channels; the V,
+ * blurred and high-pass planes live in per-thread pooled buffers, so no full-size plane is
+ * allocated per call except the returned mask.
+ *
+ * @param src   Input BGR image.
+ * @return      Binary sketch mask (CV_8U).
+ */
+cv::Mat computeSketchMask(const cv::Mat& src);
+
+/**
+ * @brief Edge-preserving colour smoothing in the requested mode.
+ *
+ * The pyramid mode filters a copy reduced by 2^kPyramidLevels with the spatial sigma scaled
+ * to match, then upsamples bilinearly; the softened edges it leaves are the ones the sketch
+ * strokes cover. The recursive mode runs in time linear in the pixel count, independent of
+ * the spatial sigma.
+ */
+cv::Mat smoothColors(const cv::Mat& src, FilterMode mode);
+
+/**
+ * @brief Produces a cartoonified image by blending a sketch mask over smoothed color.
+ *
+ * Steps:
+ *  1. Smooth colors with the edge-preserving filter of @p mode.
+ *  2. Invert sketch mask so strokes mask out the background.
+ *  3. Apply mask to set non‐stroke regions to black in the smoothed color image.
+ *
+ * @param src         Input BGR image.
+ * @param sketchMask  Mask from computeSketchMask(src), shared with the pencil sketch.
+ * @param mode        Colour smoothing mode.
+ * @return            Cartoonified BGR image.
+ */
+cv::Mat cartoonify(const cv::Mat& src, const cv::Mat& sketchMask, FilterMode mode);
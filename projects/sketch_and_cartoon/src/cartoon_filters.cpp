@@ -0,0 +1,115 @@
+/**
+ * @file cartoon_filters.cpp
+ * @brief Sketch mask and cartoon filter implementations and their tuning constants.
+ */
+
+#include "cartoon_filters.hpp"
+
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/photo.hpp>
+
+#include "portfolio/mat_pool.hpp"
+
+static constexpr int kGaussianKernelSize = 17;        ///< Kernel size for Gaussian blur (odd)
+static constexpr double kGaussianSigma = 12.0;        ///< Sigma value for Gaussian blur
+static constexpr int kSketchThreshold = 4;            ///< Threshold delta for sketch binarization
+static constexpr int kBilateralDiameter = -1;         ///< Diameter for bilateral filter (auto)
+static constexpr double kBilateralSigmaColor = 60.0;  ///< SigmaColor for bilateral filter
+static constexpr double kBilateralSigmaSpace = 30.0;  ///< SigmaSpace for bilateral filter
+static constexpr int kPyramidLevels = 2;              ///< Halvings before the reduced bilateral
+static constexpr float kRecursiveSigmaSpace = 30.0f;  ///< Spatial sigma of the domain transform
+static constexpr float kRecursiveSigmaColor =
+    static_cast<float>(kBilateralSigmaColor / 255.0);  ///< Range sigma, normalized to [0, 1]
+
+bool parseFilterMode(const std::string& name, FilterMode& mode) {
+  if (name == "exact") {
+    mode = FilterMode::Exact;
+  } else if (name == "pyramid") {
+    mode = FilterMode::Pyramid;
+  } else if (name == "recursive") {
+    mode = FilterMode::Recursive;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* filterModeName(FilterMode mode) {
+  switch (mode) {
+    case FilterMode::Exact: return "exact";
+    case FilterMode::Pyramid: return "pyramid";
+    case FilterMode::Recursive: return "recursive";
+  }
+  return "";
+}
+
+cv::Mat computeSketchMask(const cv::Mat& src) {
+  portfolio::MatPool& pool = portfolio::MatPool::local();
+
+  // V channel of HSV is the per-pixel channel maximum, read straight from the interleaved rows
+  CV_Assert(src.type() == CV_8UC3);
+  portfolio::MatPool::Lease vChannel = pool.acquire(src.size(), CV_8UC1);
+  cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& rows) {
+    for (int y = rows.start; y < rows.end; ++y) {
+      const uchar* bgr = src.ptr<uchar>(y);
+      uchar* v = vChannel->ptr<uchar>(y);
+      for (int x = 0; x < src.cols; ++x, bgr += 3)
+        v[x] = std::max(bgr[0], std::max(bgr[1], bgr[2]));
+    }
+  });
+
+  // Low‐pass (Gaussian blur)
+  portfolio::MatPool::Lease blurred = pool.acquire(src.size(), CV_8UC1);
+  cv::GaussianBlur(*vChannel, *blurred, cv::Size(kGaussianKernelSize, kGaussianKernelSize),
+                   kGaussianSigma, kGaussianSigma);
+
+  // High‐pass approximation: blurred − original
+  portfolio::MatPool::Lease highPass = pool.acquire(src.size(), CV_8UC1);
+  cv::subtract(*blurred, *vChannel, *highPass);
+
+  // Binarize: dark strokes become white
+  cv::Mat mask;
+  cv::threshold(*highPass, mask, kSketchThreshold, 255, cv::THRESH_BINARY_INV);
+
+  return mask;
+}
+
+cv::Mat smoothColors(const cv::Mat& src, FilterMode mode) {
+  cv::Mat smoothColor;
+  switch (mode) {
+    case FilterMode::Exact:
+      cv::bilateralFilter(src, smoothColor, kBilateralDiameter, kBilateralSigmaColor,
+                          kBilateralSigmaSpace);
+      break;
+    case FilterMode::Pyramid: {
+      const double factor = 1.0 / (1 << kPyramidLevels);
+      cv::Mat reduced, filtered;
+      cv::resize(src, reduced, cv::Size(), factor, factor, cv::INTER_AREA);
+      cv::bilateralFilter(reduced, filtered, kBilateralDiameter, kBilateralSigmaColor,
+                          std::max(1.0, kBilateralSigmaSpace * factor));
+      cv::resize(filtered, smoothColor, src.size(), 0, 0, cv::INTER_LINEAR);
+      break;
+    }
+    case FilterMode::Recursive:
+      cv::edgePreservingFilter(src, smoothColor, cv::RECURS_FILTER, kRecursiveSigmaSpace,
+                               kRecursiveSigmaColor);
+      break;
+  }
+  return smoothColor;
+}
+
+cv::Mat cartoonify(const cv::Mat& src, const cv::Mat& sketchMask, FilterMode mode) {
+  // 1) Color smoothing
+  cv::Mat smoothColor = smoothColors(src, mode);
+
+  // 2) Invert mask so strokes are 0, background 255
+  portfolio::MatPool::Lease invMask =
+      portfolio::MatPool::local().acquire(sketchMask.size(), CV_8UC1);
+  cv::bitwise_not(sketchMask, *invMask);
+
+  // 3) Black-out background in the smoothColor image
+  smoothColor.setTo(cv::Scalar(0, 0, 0), *invMask);
+
+  return smoothColor;
+}
@@ -9,16 +9,33 @@
  *  4. Merges the sketch mask with the smoothed color image to produce a cartoon effect.
  *  5. Displays both results in resizable windows.
  *  6. Saves the cartoon and sketch images back to disk.
+ *
+ * The sketch mask is computed once per image and shared by both outputs. The colour smoothing
+ * has three modes: the exact full-resolution bilateral filter, a bilateral filter on a reduced
+ * pyramid level, and the recursive (domain transform) edge-preserving filter, which is the
+ * default for video. Video mode (--video) streams a file or camera through the same pipeline.
+ *
+ * Usage:
+ *   ./sketch_and_cartoon [--mode exact|pyramid|recursive]
+ *   ./sketch_and_cartoon --video [file|camera index] [--mode M] [--output cartoon.mp4]
  */
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
 #include <iostream>
-#include <limits>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "config.pch"
+#include "cartoon_filters.hpp"
+#include "portfolio/bounded_queue.hpp"
+#include "portfolio/image_io.hpp"
 
 //--------------------------------------------------------------------------------------
 // Configuration constants
@@ -33,162 +50,152 @@ static const std::string kOutputSketchRelPath =
 static const std::string kWindowCartoonName = "Cartoonified Image";  ///< Window title for cartoon
 static const std::string kWindowSketchName = "Pencil Sketch Image";  ///< Window title for sketch
 
-static constexpr int kGaussianKernelSize = 17;        ///< Kernel size for Gaussian blur (odd)
-static constexpr double kGaussianSigma = 12.0;        ///< Sigma value for Gaussian blur
-static constexpr int kSketchThreshold = 4;            ///< Threshold delta for sketch binarization
-static constexpr int kBilateralDiameter = -1;         ///< Diameter for bilateral filter (auto)
-static constexpr double kBilateralSigmaColor = 60.0;  ///< SigmaColor for bilateral filter
-static constexpr double kBilateralSigmaSpace = 30.0;  ///< SigmaSpace for bilateral filter
-
-//--------------------------------------------------------------------------------------
-// Utility functions
-//--------------------------------------------------------------------------------------
-
-/**
- * @brief Loads an image from disk, exiting on failure.
- * @param path   Full filesystem path to the image.
- * @param flags  OpenCV imread flags (default: IMREAD_UNCHANGED).
- * @return       Loaded cv::Mat.
- */
-cv::Mat loadImageOrExit(const std::filesystem::path& path, int flags = cv::IMREAD_UNCHANGED) {
-  cv::Mat img = cv::imread(path.string(), flags);
-  if (img.empty()) {
-    std::cerr << "ERROR: Could not load image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-  return img;
-}
-
-/**
- * @brief Saves an image to disk, exiting on failure.
- * @param path    Full filesystem path for output.
- * @param image   Image to write.
- * @param params  Optional imwrite parameters.
- */
-void saveImageOrExit(const std::filesystem::path& path, const cv::Mat& image,
-                     const std::vector<int>& params = {}) {
-  if (!cv::imwrite(path.string(), image, params)) {
-    std::cerr << "ERROR: Could not save image: " << path << std::endl;
-    std::exit(EXIT_FAILURE);
-  }
-}
-
-/**
- * @brief Displays an image in a resizable window until any key is pressed.
- * @param windowName  Title for the window.
- * @param image       Image to display.
- */
-void showImage(const std::string& windowName, const cv::Mat& image) {
-  cv::namedWindow(windowName, cv::WINDOW_NORMAL);
-  cv::resizeWindow(windowName, 1200, 900);
-  cv::imshow(windowName, image);
-  cv::waitKey(0);
-  cv::destroyWindow(windowName);
-}
+static constexpr int kVideoQueueCapacity = 2;  ///< Frames buffered ahead of processing
 
 //--------------------------------------------------------------------------------------
-// Core image‐processing functions
+// Video mode
 //--------------------------------------------------------------------------------------
 
 /**
- * @brief Computes a binary pencil‐sketch mask from the V channel (HSV) of the image.
+ * @brief Streams a video file or camera through the sketch/cartoon pipeline.
  *
- * Steps:
- *  1. Convert BGR → HSV and extract V channel.
- *  2. Gaussian‐blur V to obtain low‐frequency content.
- *  3. Subtract: high = blurredV − V to isolate dark strokes.
- *  4. Threshold with THRESH_BINARY_INV to produce white-on-black strokes.
+ * A capture thread decodes into a small bounded queue so decoding overlaps filtering. Camera
+ * frames that arrive while the queue is full are dropped, keeping latency at the live edge;
+ * file frames are never dropped. Press M to cycle the filter mode and Esc to quit.
  *
- * @param src   Input BGR image.
- * @return      Binary sketch mask (CV_8U).
+ * @param source  Video file path, or a camera index given as digits.
+ * @param mode    Initial filter mode.
+ * @param output  Optional video file receiving the cartoon frames.
+ * @return        Process exit code.
  */
-cv::Mat computeSketchMask(const cv::Mat& src) {
-  // Convert to HSV and extract V channel
-  cv::Mat hsv;
-  cv::cvtColor(src, hsv, cv::COLOR_BGR2HSV);
-  std::vector<cv::Mat> channels;
-  cv::split(hsv, channels);
-  const cv::Mat& vChannel = channels[2];
-
-  // Low‐pass (Gaussian blur)
-  cv::Mat blurred;
-  cv::GaussianBlur(vChannel, blurred, cv::Size(kGaussianKernelSize, kGaussianKernelSize),
-                   kGaussianSigma, kGaussianSigma);
-
-  // High‐pass approximation: blurred − original
-  cv::Mat highPass = blurred - vChannel;
-
-  // Binarize: dark strokes become white
-  cv::Mat mask;
-  cv::threshold(highPass, mask, kSketchThreshold, 255, cv::THRESH_BINARY_INV);
-
-  return mask;
-}
-
-/**
- * @brief Produces a pencil‐sketch image from the source.
- * @param src   Input BGR image.
- * @return      Grayscale-looking sketch image.
- */
-cv::Mat pencilSketch(const cv::Mat& src) {
-  // The mask is white where strokes are desired
-  return computeSketchMask(src);
-}
-
-/**
- * @brief Produces a cartoonified image by blending a sketch mask over smoothed color.
- *
- * Steps:
- *  1. Smooth colors with a bilateral filter.
- *  2. Invert sketch mask so strokes mask out the background.
- *  3. Apply mask to set non‐stroke regions to black in the smoothed color image.
- *
- * @param src   Input BGR image.
- * @return      Cartoonified BGR image.
- */
-cv::Mat cartoonify(const cv::Mat& src) {
-  // 1) Color smoothing
-  cv::Mat smoothColor;
-  cv::bilateralFilter(src, smoothColor, kBilateralDiameter, kBilateralSigmaColor,
-                      kBilateralSigmaSpace);
-
-  // 2) Sketch mask (white = strokes)
-  cv::Mat sketchMask = computeSketchMask(src);
-
-  // 3) Invert mask so strokes are 0, background 255
-  cv::Mat invMask;
-  cv::bitwise_not(sketchMask, invMask);
-
-  // 4) Black-out background in the smoothColor image
-  smoothColor.setTo(cv::Scalar(0, 0, 0), invMask);
+int runVideo(const std::string& source, FilterMode mode, const std::filesystem::path& output) {
+  const bool isCamera =
+      !source.empty() && std::all_of(source.begin(), source.end(),
+                                     [](unsigned char c) { return std::isdigit(c) != 0; });
+  cv::VideoCapture cap;
+  if (isCamera) {
+    cap.open(std::stoi(source));
+  } else {
+    cap.open(source);
+  }
+  if (!cap.isOpened()) {
+    std::cerr << "ERROR: Cannot open video source: " << source << std::endl;
+    return EXIT_FAILURE;
+  }
+  const double fps = cap.get(cv::CAP_PROP_FPS);
+
+  portfolio::BoundedQueue<cv::Mat> frames(kVideoQueueCapacity);
+  std::atomic<int> dropped{0};
+  std::thread capture([&] {
+    cv::Mat frame;
+    while (!frames.closed() && cap.read(frame)) {
+      if (isCamera) {
+        if (!frames.tryPush(std::move(frame)) && !frames.closed()) ++dropped;
+      } else if (!frames.push(std::move(frame))) {
+        break;
+      }
+      frame = cv::Mat();  // moved out: decode into a fresh buffer
+    }
+    frames.close();
+  });
+
+  const std::string window = "Sketch | Cartoon";
+  cv::namedWindow(window, cv::WINDOW_NORMAL);
+  cv::resizeWindow(window, 1200, 450);
+  cv::VideoWriter writer;
+  int processed = 0;
+  double totalMs = 0;
+  while (auto frame = frames.pop()) {
+    const auto start = std::chrono::steady_clock::now();
+    cv::Mat sketch = computeSketchMask(*frame);
+    cv::Mat cartoon = cartoonify(*frame, sketch, mode);
+    const double ms =
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+            .count();
+    totalMs += ms;
+    ++processed;
+
+    if (!output.empty()) {
+      if (!writer.isOpened() &&
+          !writer.open(output.string(), cv::VideoWriter::fourcc('m', 'p', '4', 'v'),
+                       fps > 0 ? fps : 30.0, cartoon.size())) {
+        std::cerr << "ERROR: Could not open video writer: " << output << std::endl;
+        break;
+      }
+      writer.write(cartoon);
+    }
+
+    cv::Mat sketchBgr, view;
+    cv::cvtColor(sketch, sketchBgr, cv::COLOR_GRAY2BGR);
+    cv::hconcat(sketchBgr, cartoon, view);
+    cv::putText(view, cv::format("%s  %.1f ms", filterModeName(mode), ms), cv::Point(20, 40),
+                cv::FONT_HERSHEY_SIMPLEX, 1.0, cv::Scalar(0, 0, 255), 2);
+    cv::imshow(window, view);
+    const int key = cv::waitKey(1) & 0xFF;
+    if (key == 27) break;
+    if (key == 'm' || key == 'M') {
+      mode = static_cast<FilterMode>((static_cast<int>(mode) + 1) % 3);
+    }
+  }
+  frames.close();  // unblocks the capture thread if we stopped early
+  capture.join();
+  cv::destroyWindow(window);
 
-  return smoothColor;
+  if (processed > 0) {
+    std::cout << processed << " frames, " << totalMs / processed << " ms/frame, " << dropped
+              << " camera frames dropped" << std::endl;
+  }
+  return EXIT_SUCCESS;
 }
 
 //--------------------------------------------------------------------------------------
 // Main entry point
 //--------------------------------------------------------------------------------------
 
-int main() {
+int main(int argc, char* argv[]) {
+  // Parse options
+  FilterMode mode = FilterMode::Exact;
+  bool video = false, modeGiven = false;
+  std::string source = "0";
+  std::filesystem::path videoOutput;
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "--mode" && hasValue && parseFilterMode(argv[i + 1], mode)) {
+      modeGiven = true;
+      ++i;
+    } else if (arg == "--video") {
+      video = true;
+      if (hasValue && argv[i + 1][0] != '-') source = argv[++i];
+    } else if (arg == "--output" && hasValue) {
+      videoOutput = argv[++i];
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [--mode exact|pyramid|recursive]"
+                << " [--video [file|camera]] [--output cartoon.mp4]" << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+  if (video) return runVideo(source, modeGiven ? mode : FilterMode::Recursive, videoOutput);
+
   // Build full input/output paths
   std::filesystem::path inputPath = std::filesystem::path{kDataDir} / kInputRelativePath;
   std::filesystem::path cartoonPath = std::filesystem::path{kDataDir} / kOutputCartoonRelPath;
   std::filesystem::path sketchPath = std::filesystem::path{kDataDir} / kOutputSketchRelPath;
 
   // Load source image
-  cv::Mat src = loadImageOrExit(inputPath, cv::IMREAD_COLOR);
+  cv::Mat src = portfolio::loadImageOrExit(inputPath, cv::IMREAD_COLOR);
 
-  // Generate outputs
-  cv::Mat sketch = pencilSketch(src);
-  cv::Mat cartoon = cartoonify(src);
+  // Generate outputs; the pencil sketch is the mask itself
+  cv::Mat sketch = computeSketchMask(src);
+  cv::Mat cartoon = cartoonify(src, sketch, mode);
 
   // Display results
-  showImage(kWindowSketchName, sketch);
-  showImage(kWindowCartoonName, cartoon);
+  portfolio::showImage(kWindowSketchName, sketch);
+  portfolio::showImage(kWindowCartoonName, cartoon);
 
   // Save to disk
-  saveImageOrExit(sketchPath, sketch);
-  saveImageOrExit(cartoonPath, cartoon);
+  portfolio::saveImageOrExit(sketchPath, sketch);
+  portfolio::saveImageOrExit(cartoonPath, cartoon);
 
   std::cout << "Saved pencil sketch to: " << sketchPath << "\n"
             << "Saved cartoon image to: " << cartoonPath << std::endl;
@@ -0,0 +1,28 @@
+/**
+ * @file skin_retouch.hpp
+ * @brief Face skin retouching (blemish removal + smoothing), shared by skin_smoothing and
+ * portfolio_bench.
+ */
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/objdetect.hpp>
+
+/**
+ * @brief Processes a single image: detects faces/eyes, then builds the skin mask, removes
+ *        blemishes and smooths each face, returning both the intermediate (after blemish
+ *        removal) and final images.
+ *
+ * Detection runs once on the whole image. The rest of the pipeline runs on a crop of each face
+ * plus kFaceMargin, faces in parallel, and the changed pixels are pasted back.
+ *
+ * @param image            Input BGR image.
+ * @param faceC            Loaded face CascadeClassifier.
+ * @param eyeC             Loaded eye CascadeClassifier.
+ * @param outRemoved       Output: image after removeBlemishes().
+ * @param outFinal         Output: final smoothed image.
+ * @throws std::runtime_error if no face is detected or every face fails.
+ */
+void processSkinSmoothing(const cv::Mat& image, cv::CascadeClassifier& faceC,
+                          cv::CascadeClassifier& eyeC, cv::Mat& outRemoved, cv::Mat& outFinal);
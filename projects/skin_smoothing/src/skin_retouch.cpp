@@ -0,0 +1,426 @@
+/**
+ * @file skin_retouch.cpp
+ * @brief Skin mask, blemish removal and smoothing of detected faces.
+ */
+
+#include "skin_retouch.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "portfolio/texture_energy_index.hpp"
+
+static const cv::Size kMinFaceSize = {100, 100};
+static const cv::Size kMinEyeSize = {120, 120};
+static constexpr float kFaceMargin = 0.3f;  ///< Crop margin around each face, per side
+static constexpr double kSigmaFactor = 2.5;
+static constexpr int kHistBinsH = 30;
+static constexpr int kHistBinsS = 32;
+static constexpr int kMorphKernel = 3;
+static constexpr int kMorphIter = 2;
+static constexpr int kGCIter = 2;
+static constexpr float kMinBlemPct = 0.01f;
+static constexpr float kMaxBlemPct = 0.06f;
+
+/// One blemish repair: a circular patch copied from srcRect onto dstRect.
+struct BlemishPatch {
+  cv::Rect srcRect;
+  cv::Rect dstRect;
+  int radius;
+};
+
+/// A group of overlapping patches solved with a single Poisson clone.
+struct CloneTile {
+  cv::Rect rect;  ///< Image region of the local solve
+  std::vector<size_t> patches;
+  cv::Mat source;  ///< Destination pixels with every patch of the tile composed in
+  cv::Mat mask;    ///< Union of the patch circles
+};
+
+/**
+ * @brief Groups patches whose destinations (grown by @p margin) overlap into disjoint tiles.
+ *
+ * Tiles are merged until no two tile rectangles intersect, so they can be solved and written
+ * back concurrently.
+ */
+static std::vector<CloneTile> groupPatches(const std::vector<BlemishPatch>& patches,
+                                           const cv::Size& imageSize, int margin) {
+  const cv::Rect bounds(0, 0, imageSize.width, imageSize.height);
+  std::vector<CloneTile> tiles;
+  for (size_t i = 0; i < patches.size(); ++i) {
+    const cv::Rect& d = patches[i].dstRect;
+    CloneTile tile;
+    tile.rect = cv::Rect(d.x - margin, d.y - margin, d.width + 2 * margin,
+                         d.height + 2 * margin) & bounds;
+    tile.patches.push_back(i);
+    tiles.push_back(std::move(tile));
+  }
+  for (bool merged = true; merged;) {
+    merged = false;
+    for (size_t i = 0; i < tiles.size() && !merged; ++i) {
+      for (size_t j = i + 1; j < tiles.size(); ++j) {
+        if ((tiles[i].rect & tiles[j].rect).empty()) continue;
+        tiles[i].rect |= tiles[j].rect;
+        tiles[i].patches.insert(tiles[i].patches.end(), tiles[j].patches.begin(),
+                                tiles[j].patches.end());
+        tiles.erase(tiles.begin() + j);
+        merged = true;
+        break;
+      }
+    }
+  }
+  return tiles;
+}
+
+/**
+ * @brief Removes blemishes by seamless‐cloning low‐texture patches over each keypoint.
+ *
+ * For each keypoint in `kps`, a patch of radius ~kp.size is chosen as the lowest-energy
+ * candidate of a dense multi-radius search (2r to 4r from the blemish) answered by @p energy.
+ * Instead of one full-image seamlessClone per keypoint, overlapping patches are grouped into
+ * tiles: each tile composes all its patches into one source and one mask and is solved with a
+ * single clone restricted to the tile. Tiles are disjoint, so they are solved in parallel.
+ * Patch sources are all read before any tile is written back.
+ *
+ * @param src     Source image that will be modified in‐place.
+ * @param kps     Vector of cv::KeyPoint indicating blemish locations and sizes.
+ * @param energy  Texture energy of the hue channel of `src`. All patches are chosen before any
+ *                pixel changes, so the index needs no update here.
+ */
+static void removeBlemishes(cv::Mat& src, const std::vector<cv::KeyPoint>& kps,
+                            const portfolio::TextureEnergyIndex& energy) {
+  static constexpr int kCloneMargin = 4;  ///< Poisson boundary ring around each patch
+
+  // 1. Choose a patch per keypoint
+  const cv::Rect bounds(0, 0, src.cols, src.rows);
+  std::vector<BlemishPatch> patches;
+  for (auto& kp : kps) {
+    cv::Point c{cvRound(kp.pt.x), cvRound(kp.pt.y)};
+    int r = cvRound(kp.size) * 1.25;
+    if (r <= 0) continue;
+    cv::Rect srcRect =
+        energy.lowestEnergyPatch(c, {2 * r, 2 * r}, 2 * r, 4 * r, std::max(1, r / 2));
+    cv::Rect dstRect{c.x - r, c.y - r, 2 * r, 2 * r};
+    if (srcRect.empty() || (dstRect & bounds) != dstRect) continue;
+    patches.push_back({srcRect, dstRect, r});
+  }
+  if (patches.empty()) return;
+
+  // 2. Compose every tile's source and mask from the untouched image
+  std::vector<CloneTile> tiles = groupPatches(patches, src.size(), kCloneMargin);
+  for (auto& tile : tiles) {
+    tile.source = src(tile.rect).clone();
+    tile.mask = cv::Mat::zeros(tile.rect.size(), CV_8U);
+    for (size_t i : tile.patches) {
+      const BlemishPatch& p = patches[i];
+      cv::Mat circle = cv::Mat::zeros(p.dstRect.size(), CV_8U);
+      cv::circle(circle, {p.radius, p.radius}, p.radius, 255, cv::FILLED);
+      const cv::Rect local = p.dstRect - tile.rect.tl();
+      src(p.srcRect).copyTo(tile.source(local), circle);
+      tile.mask(local).setTo(255, circle);
+    }
+  }
+
+  // 3. Solve the tiles independently and write them back
+  cv::parallel_for_(cv::Range(0, static_cast<int>(tiles.size())), [&](const cv::Range& range) {
+    for (int t = range.start; t < range.end; ++t) {
+      const CloneTile& tile = tiles[t];
+      cv::Mat dst = src(tile.rect);
+      cv::Mat out;
+      cv::seamlessClone(tile.source, dst, tile.mask,
+                        cv::Point(tile.rect.width / 2, tile.rect.height / 2), out,
+                        cv::NORMAL_CLONE_WIDE);
+      out.copyTo(dst);
+    }
+  });
+}
+
+/**
+ * @brief Generates a binary face mask that includes the detected face region
+ *        (as a rectangle down to the bottom of the image) and excludes eyes and nose
+ *        using filled ellipses.
+ *
+ * @param imageSize  Size of the source image.
+ * @param faceRect   Bounding rectangle of the detected face.
+ * @param eyeRects   Vector of bounding rectangles for each detected eye.
+ * @return           Single-channel 8-bit mask:
+ *                    - 255 inside the face rectangle,
+ *                    - 0 in the eye and nose ellipses,
+ *                    - 0 elsewhere.
+ */
+static cv::Mat createFaceMask(const cv::Size& imageSize, const cv::Rect& faceRect,
+                              const std::vector<cv::Rect>& eyeRects) {
+  // Start with a blank mask
+  cv::Mat mask(imageSize, CV_8U, cv::Scalar(0));
+
+  // 1) Draw face region as a filled rectangle from top of face to bottom of image
+  cv::rectangle(mask, cv::Point(faceRect.x, faceRect.y),
+                cv::Point(faceRect.x + faceRect.width, imageSize.height), cv::Scalar(255),
+                cv::FILLED);
+
+  // 2) Exclude each eye area with an enlarged filled ellipse
+  std::vector<cv::Point> eyeCenters;
+  for (const auto& e : eyeRects) {
+    cv::Point center(e.x + e.width / 2, e.y + e.height / 3);
+    eyeCenters.push_back(center);
+    cv::Size axes(static_cast<int>(1.25 * e.width / 2.0), e.height / 2);
+    cv::ellipse(mask, center, axes, 0.0, 0.0, 360.0, cv::Scalar(0), cv::FILLED);
+  }
+
+  // 3) If two or more eyes, sort by x to identify left/right, then carve out nose ellipse
+  if (eyeCenters.size() >= 2) {
+    // Only consider the two most prominent eyes:
+    cv::Point c1 = eyeCenters[0], c2 = eyeCenters[1];
+    // Determine which is left/right by x-coordinate
+    cv::Point leftEyeCenter = (c1.x < c2.x) ? c1 : c2;
+    cv::Point rightEyeCenter = (c1.x < c2.x) ? c2 : c1;
+
+    // Nose center midway horizontally, slightly below eyes
+    cv::Point noseCenter(
+        (leftEyeCenter.x + rightEyeCenter.x) / 2,
+        (leftEyeCenter.y + rightEyeCenter.y) / 2 + static_cast<int>(faceRect.height * 0.3));
+    int noseWidth = std::abs(rightEyeCenter.x - leftEyeCenter.x);
+    int noseHeight = static_cast<int>(faceRect.height * 0.15);
+    cv::Size noseAxes(static_cast<int>(noseWidth / 4.5), noseHeight / 2);
+
+    cv::ellipse(mask, noseCenter, noseAxes, 0.0, 0.0, 360.0, cv::Scalar(0), cv::FILLED);
+  }
+
+  return mask;
+}
+
+/**
+ * @brief Runs the retouching pipeline on one face working set.
+ *
+ * All coordinates are local to @p image, which is the face crop (face plus margin) cut out by
+ * processSkinSmoothing(); every filter, colour conversion and GrabCut therefore only touches
+ * the pixels that can change.
+ *
+ * @param image       BGR face crop.
+ * @param face        Face rectangle inside the crop.
+ * @param eyes        Eye rectangles inside the crop.
+ * @param outRemoved  Output: crop after removeBlemishes().
+ * @param outFinal    Output: smoothed crop.
+ */
+static void retouchFace(const cv::Mat& image, const cv::Rect& face,
+                        const std::vector<cv::Rect>& eyes, cv::Mat& outRemoved,
+                        cv::Mat& outFinal) {
+  // Build face mask (exclude eyes and nose)
+  cv::Mat faceMask = createFaceMask(image.size(), face, eyes);
+
+  // Smooth for color sampling
+  cv::Mat blurImage;
+  cv::GaussianBlur(image, blurImage, {17, 17}, 6);
+
+  // Sample central region of face
+  int y0 = face.y + cvRound(face.height * 0.10f);
+  int y1 = face.y + cvRound(face.height * 0.80f);
+  int x0 = face.x + cvRound(face.width * 0.20f);
+  int x1 = face.x + cvRound(face.width * 0.80f);
+  cv::Mat skinSample = blurImage(cv::Rect{x0, y0, x1 - x0, y1 - y0});
+
+  // Build 2D HSV histogram
+  cv::Mat hsv;
+  cv::cvtColor(skinSample, hsv, cv::COLOR_BGR2HSV);
+  int histSizes[] = {kHistBinsH, kHistBinsS};
+  float hRanges[] = {0, 180}, sRanges[] = {0, 256};
+  const float* ranges[] = {hRanges, sRanges};
+  int channels[] = {0, 1};
+  cv::Mat hist;
+  cv::calcHist(&hsv, 1, channels, {}, hist, 2, histSizes, ranges);
+
+  // Reduce to 1D histograms
+  cv::Mat histH, histS;
+  cv::reduce(hist, histH, 1, cv::REDUCE_SUM);
+  cv::reduce(hist, histS, 0, cv::REDUCE_SUM);
+  double total = cv::sum(hist)[0];
+
+  auto computeStats = [&](const cv::Mat& h, int bins, double minV, double maxV) {
+    double mean = 0, var = 0, binW = (maxV - minV) / bins;
+    for (int i = 0; i < bins; ++i) {
+      double p = h.at<float>(i) / total;
+      double c = minV + (i + 0.5) * binW;
+      mean += c * p;
+      var += c * c * p;
+    }
+    var -= mean * mean;
+    return std::make_pair(mean, std::sqrt(var));
+  };
+
+  auto [meanH, stdH] = computeStats(histH, kHistBinsH, 0, 180);
+  auto [meanS, stdS] = computeStats(histS, kHistBinsS, 0, 256);
+
+  // Correctly use cv::Scalar for inRange
+  float hLo = static_cast<float>(std::max(0.0, meanH - kSigmaFactor * stdH));
+  float hHi = static_cast<float>(std::min(180.0, meanH + kSigmaFactor * stdH));
+  float sLo = static_cast<float>(std::max(0.0, meanS - kSigmaFactor * stdS));
+  float sHi = static_cast<float>(std::min(256.0, meanS + kSigmaFactor * stdS));
+
+  cv::cvtColor(blurImage, hsv, cv::COLOR_BGR2HSV);
+  cv::Mat skinMask;
+  cv::inRange(hsv, cv::Scalar(hLo, sLo, 50), cv::Scalar(hHi, sHi, 255), skinMask);
+  cv::bitwise_and(skinMask, faceMask, skinMask);
+
+  // Morphology + GrabCut refinement
+  cv::Mat morph = skinMask;
+  cv::morphologyEx(skinMask, morph, cv::MORPH_OPEN,
+                   cv::getStructuringElement(cv::MORPH_RECT, {kMorphKernel, kMorphKernel}), {},
+                   kMorphIter);
+
+  cv::Mat gcMask(image.size(), CV_8U, cv::GC_PR_BGD);
+  gcMask.setTo(cv::GC_PR_FGD, morph);
+  cv::grabCut(image, gcMask, {}, cv::Mat(), cv::Mat(), kGCIter, cv::GC_INIT_WITH_MASK);
+  cv::Mat refinedMask = (gcMask == cv::GC_FGD) | (gcMask == cv::GC_PR_FGD);
+
+  // Remove unwanted borders from the image
+  cv::Mat kernel = cv::getStructuringElement(cv::MorphShapes::MORPH_ELLIPSE,
+                                             cv::Size(kMorphKernel * 2, kMorphKernel));
+  cv::morphologyEx(refinedMask, refinedMask, cv::MorphTypes::MORPH_DILATE, kernel,
+                   cv::Point(-1, -1), kMorphIter);
+
+  // Blemish detection via gradient + blobs
+  cv::Mat hsv2, grayV;
+  cv::cvtColor(image, hsv2, cv::COLOR_BGR2HSV);
+  cv::extractChannel(hsv2, grayV, 2);
+  int w = face.width;
+  int minB = cvRound(w * kMinBlemPct), maxB = cvRound(w * kMaxBlemPct);
+  minB += (minB % 2 == 0);
+  maxB += (maxB % 2 == 0);
+
+  kernel = cv::getStructuringElement(cv::MorphShapes::MORPH_ELLIPSE, cv::Size(minB * 2, minB));
+  cv::morphologyEx(refinedMask, refinedMask, cv::MorphTypes::MORPH_ERODE, kernel, cv::Point(-1, -1),
+                   kMorphIter * 2);
+  cv::bitwise_and(refinedMask, morph, refinedMask);
+
+  cv::Mat gx, gy, mag;
+  cv::Sobel(grayV, gx, CV_32F, 1, 0, minB);
+  cv::Sobel(grayV, gy, CV_32F, 0, 1, minB);
+  cv::normalize(gx, gx, 1.0f, -1.0f, cv::NormTypes::NORM_MINMAX);
+  cv::normalize(gy, gy, 1.0f, -1.0f, cv::NormTypes::NORM_MINMAX);
+  cv::magnitude(gx, gy, mag);
+  cv::normalize(mag, mag, 2.0, -2.0, cv::NORM_MINMAX);
+  mag = cv::abs(mag);
+  mag = mag - 1;
+
+  cv::multiply(mag, refinedMask, mag, (1.0f), CV_32F);
+  cv::Mat mag8;
+  mag.convertTo(mag8, CV_8U, 1.0);
+  cv::GaussianBlur(mag8, mag8, {minB, minB}, 3);
+
+  mag8.setTo(0, ~refinedMask);
+
+  cv::SimpleBlobDetector::Params bp;
+  bp.filterByArea = true;
+  bp.minArea = minB * minB;
+  bp.maxArea = maxB * maxB;
+  bp.filterByCircularity = true;
+  bp.minCircularity = 0.35f;
+  bp.filterByInertia = true;
+  bp.minInertiaRatio = 0.15f;
+  bp.filterByConvexity = false;
+  bp.filterByColor = false;
+  bp.thresholdStep = 5;
+  bp.minThreshold = 0;
+  bp.maxThreshold = 200;
+
+  auto blobDet = cv::SimpleBlobDetector::create(bp);
+  std::vector<cv::KeyPoint> keypoints;
+  blobDet->detect(mag8, keypoints);
+  cv::Mat working = image.clone();
+  cv::Mat hue;
+  cv::extractChannel(hsv2, hue, 0);
+  removeBlemishes(working, keypoints, portfolio::TextureEnergyIndex(hue));
+
+  // Save intermediate
+  outRemoved = working.clone();
+
+  // 5. Final smoothing & composite
+  cv::Mat smooth;
+  cv::bilateralFilter(working, smooth, -1, 35.0, 20.0);
+  const cv::Rect bbox = cv::boundingRect(refinedMask);
+  if (bbox.empty()) {
+    outFinal = working.clone();
+    return;
+  }
+  // NORMAL_CLONE_WIDE centres the whole source on p; smooth is working-sized, so the image
+  // centre clones in place
+  cv::Mat result;
+  cv::seamlessClone(smooth, working, refinedMask, cv::Point(working.cols / 2, working.rows / 2),
+                    result, cv::SeamlessCloneFlags::NORMAL_CLONE_WIDE);
+  outFinal = result;
+}
+
+/**
+ * @brief Copies into @p dst(roi) only the pixels of @p patch that differ from @p original(roi).
+ *
+ * Neighbouring face crops may overlap; pasting the changed pixels only keeps one face from
+ * overwriting the edits of another with stale original pixels.
+ */
+static void pasteChanged(const cv::Mat& original, const cv::Mat& patch, const cv::Rect& roi,
+                         cv::Mat& dst) {
+  cv::Mat diff, changed;
+  cv::absdiff(patch, original(roi), diff);
+  cv::transform(diff, changed, cv::Matx13f(1, 1, 1));
+  patch.copyTo(dst(roi), changed > 0);
+}
+
+void processSkinSmoothing(const cv::Mat& image, cv::CascadeClassifier& faceC,
+                          cv::CascadeClassifier& eyeC, cv::Mat& outRemoved, cv::Mat& outFinal) {
+  // 1. Face & eye detection
+  cv::Mat gray;
+  cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
+  std::vector<cv::Rect> faces, eyes;
+  faceC.detectMultiScale(gray, faces, 1.1, 3, 0, kMinFaceSize);
+  if (faces.empty()) throw std::runtime_error("No face detected");
+  eyeC.detectMultiScale(gray, eyes, 1.1, 3, 0, kMinEyeSize);
+
+  // 2. One working set per face: crop = face + margin, eyes whose centre lies in the face
+  struct FaceJob {
+    cv::Rect roi;
+    cv::Rect face;
+    std::vector<cv::Rect> eyes;
+    cv::Mat removed, smoothed;
+    std::string error;
+  };
+  const cv::Rect bounds(0, 0, image.cols, image.rows);
+  std::vector<FaceJob> jobs(faces.size());
+  for (size_t i = 0; i < faces.size(); ++i) {
+    const cv::Rect& f = faces[i];
+    const int mx = cvRound(f.width * kFaceMargin), my = cvRound(f.height * kFaceMargin);
+    jobs[i].roi = cv::Rect(f.x - mx, f.y - my, f.width + 2 * mx, f.height + 2 * my) & bounds;
+    jobs[i].face = f - jobs[i].roi.tl();
+    for (const auto& e : eyes) {
+      if (f.contains((e.tl() + e.br()) / 2)) jobs[i].eyes.push_back(e - jobs[i].roi.tl());
+    }
+  }
+
+  // 3. Retouch the faces independently
+  cv::parallel_for_(cv::Range(0, static_cast<int>(jobs.size())), [&](const cv::Range& r) {
+    for (int i = r.start; i < r.end; ++i) {
+      FaceJob& job = jobs[i];
+      try {
+        retouchFace(image(job.roi), job.face, job.eyes, job.removed, job.smoothed);
+      } catch (const std::exception& e) {
+        job.error = e.what();
+      }
+    }
+  });
+
+  // 4. Paste the changed pixels back
+  outRemoved = image.clone();
+  outFinal = image.clone();
+  size_t failures = 0;
+  for (const auto& job : jobs) {
+    if (!job.error.empty()) {
+      ++failures;
+      continue;
+    }
+    pasteChanged(image, job.removed, job.roi, outRemoved);
+    pasteChanged(image, job.smoothed, job.roi, outFinal);
+  }
+  if (failures == jobs.size()) throw std::runtime_error(jobs.front().error);
+}
@@ -10,17 +10,30 @@
  *  5. Detects blemishes via gradient + blob detection within the skin region.
  *  6. Removes blemishes using seamlessClone with low‐texture patches.
  *  7. Applies bilateral smoothing to the corrected face area.
+ *
+ * Usage:
+ *   ./skin_smoothing                                   (sample images, shown step by step)
+ *   ./skin_smoothing --batch <input_dir> <output_dir> [--workers N] [--decoders N]
+ *                    [--encoders N] [--prefetch N] [--save-removed]
  */
 
 #include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
 #include <cstdlib>
 #include <filesystem>
+#include <iomanip>
 #include <iostream>
-#include <limits>
 #include <opencv2/opencv.hpp>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "config.pch"
+#include "skin_retouch.hpp"
+#include "portfolio/bounded_queue.hpp"
+#include "portfolio/image_io.hpp"
 
 //--------------------------------------------------------------------------------------
 // Configuration
@@ -29,352 +42,254 @@ static const std::filesystem::path kDataDir = DATA_DIR;
 static const std::string kFaceModel = "models/haarcascade_frontalface_default.xml";
 static const std::string kEyeModel = "models/haarcascade_eye.xml";
 
-static const cv::Size kMinFaceSize = {100, 100};
-static const cv::Size kMinEyeSize = {120, 120};
-static constexpr double kSigmaFactor = 2.5;
-static constexpr int kHistBinsH = 30;
-static constexpr int kHistBinsS = 32;
-static constexpr int kMorphKernel = 3;
-static constexpr int kMorphIter = 2;
-static constexpr int kGCIter = 2;
-static constexpr float kMinBlemPct = 0.01f;
-static constexpr float kMaxBlemPct = 0.06f;
-
 //--------------------------------------------------------------------------------------
-// Utility functions
+// Batch engine
 //--------------------------------------------------------------------------------------
 
+/// Paths and thread counts of the headless batch mode.
+struct BatchOptions {
+  std::filesystem::path inputDir;
+  std::filesystem::path outputDir;
+  int workers = 0;           ///< Processing threads, 0 = one per hardware thread
+  int decoders = 1;          ///< Prefetch/decode threads
+  int encoders = 1;          ///< Encode/write threads
+  int prefetch = 0;          ///< Decoded images kept ahead of the workers, 0 = 2 per worker
+  bool saveRemoved = false;  ///< Also write the intermediate "removed_" image
+};
+
 /**
- * @brief Loads an image from the specified filesystem path.
- *        Exits the program with an error message if loading fails.
- *
- * @param path  Filesystem path to the image file.
- * @return      A cv::Mat containing the loaded image.
+ * @brief Parses `--batch <input_dir> <output_dir> [options]`; returns false on bad input.
  */
-static cv::Mat loadOrExit(const std::filesystem::path& path) {
-  cv::Mat img = cv::imread(path.string());
-  if (img.empty()) {
-    std::cerr << "ERROR: Cannot load " << path << std::endl;
-    std::exit(EXIT_FAILURE);
+static bool parseBatchOptions(int argc, char* argv[], BatchOptions& opts) {
+  if (argc < 4) return false;
+  opts.inputDir = argv[2];
+  opts.outputDir = argv[3];
+  try {
+    for (int i = 4; i < argc; ++i) {
+      const std::string arg = argv[i];
+      const bool hasValue = i + 1 < argc;
+      if (arg == "--save-removed") {
+        opts.saveRemoved = true;
+      } else if (arg == "--workers" && hasValue) {
+        opts.workers = std::max(0, std::stoi(argv[++i]));
+      } else if (arg == "--decoders" && hasValue) {
+        opts.decoders = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--encoders" && hasValue) {
+        opts.encoders = std::max(1, std::stoi(argv[++i]));
+      } else if (arg == "--prefetch" && hasValue) {
+        opts.prefetch = std::max(0, std::stoi(argv[++i]));
+      } else {
+        return false;
+      }
+    }
+  } catch (const std::exception&) {
+    return false;
   }
-  return img;
+  return true;
 }
 
-/**
- * @brief Displays an image in a resizable window and waits for a key press.
- *
- * Opens a window titled `win`, resizes it to 800×600, shows `img`,
- * then blocks until any key is pressed before destroying the window.
- *
- * @param win  Title of the display window.
- * @param img  Image to display.
- */
-static void show(const std::string& win, const cv::Mat& img) {
-  cv::namedWindow(win, cv::WINDOW_NORMAL);
-  cv::resizeWindow(win, 800, 600);
-  cv::imshow(win, img);
-  cv::waitKey(0);
-  cv::destroyWindow(win);
-}
+/// Busy time of one pipeline stage, accumulated per thread and merged after the run.
+struct StageStats {
+  int count = 0;
+  double totalMs = 0;
+  double maxMs = 0;
 
-/**
- * @brief Computes the texture variance of a patch by applying a Laplacian
- *        filter to the hue channel and summing the squared responses.
- *
- * @param patch  Input BGR image patch.
- * @return       Sum of squared Laplacian values as a measure of variance.
- */
-static double patchVariance(const cv::Mat& patch) {
-  cv::Mat hsv, lap, sq;
-  cv::cvtColor(patch, hsv, cv::COLOR_BGR2HSV);
-  cv::Mat h;
-  cv::extractChannel(hsv, h, 0);
-  cv::Laplacian(h, lap, CV_32F, 3);
-  cv::pow(lap, 2, sq);
-  return cv::sum(sq)[0];
+  void add(double ms) {
+    ++count;
+    totalMs += ms;
+    maxMs = std::max(maxMs, ms);
+  }
+  void merge(const StageStats& o) {
+    count += o.count;
+    totalMs += o.totalMs;
+    maxMs = std::max(maxMs, o.maxMs);
+  }
+};
+
+/// Milliseconds elapsed since @p start.
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start)
+      .count();
 }
 
 /**
- * @brief Searches eight directions around a center point to find the
- *        patch of size (2*radius)×(2*radius) with the lowest texture variance.
+ * @brief Prints one stage line: mean/max latency per item and utilization of the stage threads.
  *
- * @param img     Source image from which patches are extracted.
- * @param center  Center point around which to search for replacement patches.
- * @param radius  Radius of the square patch (half the side length).
- * @return        The best‐matching patch (cloned); returns an empty Mat if none found.
+ * A utilization near 100 % marks the stage that bounds throughput.
  */
-static cv::Mat bestLowTexturePatch(const cv::Mat& img, cv::Point center, int radius) {
-  cv::Mat best;
-  double bestVar = std::numeric_limits<double>::infinity();
-  int diameter = 2 * radius;
-
-  static const std::vector<cv::Point2f> dirs = {{1, 0},
-                                                {-1, 0},
-                                                {0, 1},
-                                                {0, -1},
-                                                {0.707f, 0.707f},
-                                                {-0.707f, 0.707f},
-                                                {0.707f, -0.707f},
-                                                {-0.707f, -0.707f}};
+static void reportStage(const std::string& name, const std::vector<StageStats>& perThread,
+                        double wallMs) {
+  StageStats s;
+  for (const auto& t : perThread) s.merge(t);
+  const double mean = s.count > 0 ? s.totalMs / s.count : 0.0;
+  const double busy = 100.0 * s.totalMs / std::max(wallMs * perThread.size(), 1e-9);
+  std::cout << "  " << std::left << std::setw(8) << name << std::right << std::fixed
+            << std::setprecision(1) << std::setw(6) << s.count << " items  mean " << std::setw(8)
+            << mean << " ms  max " << std::setw(8) << s.maxMs << " ms  " << perThread.size()
+            << " thread(s) " << std::setw(5) << busy << " % busy" << std::defaultfloat
+            << std::endl;
+}
 
-  for (auto d : dirs) {
-    cv::Point c = center + cv::Point(cvRound(d.x * diameter), cvRound(d.y * diameter));
-    int x0 = c.x - radius, y0 = c.y - radius;
-    if (x0 < 0 || y0 < 0 || x0 + diameter > img.cols || y0 + diameter > img.rows) continue;
-    cv::Mat patch = img(cv::Rect{x0, y0, diameter, diameter});
-    double v = patchVariance(patch);
-    if (v < bestVar) {
-      bestVar = v;
-      best = patch.clone();
+/// Sorted list of the image files directly inside @p dir.
+static std::vector<std::filesystem::path> listImages(const std::filesystem::path& dir,
+                                                     std::error_code& ec) {
+  std::vector<std::filesystem::path> images;
+  for (const auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+    std::string ext = entry.path().extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    if (entry.is_regular_file() &&
+        (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".tif" ||
+         ext == ".tiff")) {
+      images.push_back(entry.path());
     }
   }
-  return best;
+  std::sort(images.begin(), images.end());
+  return images;
 }
 
 /**
- * @brief Removes blemishes by seamless‐cloning low‐texture patches over each keypoint.
+ * @brief Retouches every image of a directory with a three-stage pipeline.
  *
- * For each keypoint in `kps`, a patch of radius ~kp.size is found via
- * bestLowTexturePatch() and seamlessly cloned back into `src` at the keypoint location.
+ * Decoder threads read ahead into a bounded queue, so at most `prefetch` decoded images wait
+ * in memory. Workers run processSkinSmoothing() with their own face/eye CascadeClassifier
+ * (detectMultiScale keeps per-call state inside the classifier, so instances are not shared).
+ * Results go to a second bounded queue drained by encoder threads, keeping imwrite off the
+ * workers. The last thread of each stage closes the queue it feeds.
  *
- * @param src   Source image that will be modified in‐place.
- * @param kps   Vector of cv::KeyPoint indicating blemish locations and sizes.
+ * @return 0 if every image was written, -1 otherwise.
  */
-static void removeBlemishes(cv::Mat& src, const std::vector<cv::KeyPoint>& kps) {
-  for (auto& kp : kps) {
-    cv::Point c{cvRound(kp.pt.x), cvRound(kp.pt.y)};
-    int r = cvRound(kp.size) * 1.25;
-    cv::Mat patch = bestLowTexturePatch(src, c, r);
-    if (patch.empty()) continue;
-    cv::Mat mask = cv::Mat::zeros(patch.size(), CV_8U);
-    cv::circle(mask, {r, r}, r, 255, cv::FILLED);
-    cv::seamlessClone(patch, src, mask, c, src, cv::NORMAL_CLONE_WIDE);
-    // cv::circle(src, c, r, 255, cv::FILLED);
+static int runBatch(const BatchOptions& opts) {
+  std::error_code ec;
+  const std::vector<std::filesystem::path> inputs = listImages(opts.inputDir, ec);
+  if (ec) {
+    std::cerr << "ERROR: Cannot read directory " << opts.inputDir << std::endl;
+    return -1;
   }
-}
-
-/**
- * @brief Generates a binary face mask that includes the detected face region
- *        (as a rectangle down to the bottom of the image) and excludes eyes and nose
- *        using filled ellipses.
- *
- * @param imageSize  Size of the source image.
- * @param faceRect   Bounding rectangle of the detected face.
- * @param eyeRects   Vector of bounding rectangles for each detected eye.
- * @return           Single-channel 8-bit mask:
- *                    - 255 inside the face rectangle,
- *                    - 0 in the eye and nose ellipses,
- *                    - 0 elsewhere.
- */
-cv::Mat createFaceMask(const cv::Size& imageSize, const cv::Rect& faceRect,
-                       const std::vector<cv::Rect>& eyeRects) {
-  // Start with a blank mask
-  cv::Mat mask(imageSize, CV_8U, cv::Scalar(0));
-
-  // 1) Draw face region as a filled rectangle from top of face to bottom of image
-  cv::rectangle(mask, cv::Point(faceRect.x, faceRect.y),
-                cv::Point(faceRect.x + faceRect.width, imageSize.height), cv::Scalar(255),
-                cv::FILLED);
-
-  // 2) Exclude each eye area with an enlarged filled ellipse
-  std::vector<cv::Point> eyeCenters;
-  for (const auto& e : eyeRects) {
-    cv::Point center(e.x + e.width / 2, e.y + e.height / 3);
-    eyeCenters.push_back(center);
-    cv::Size axes(static_cast<int>(1.25 * e.width / 2.0), e.height / 2);
-    cv::ellipse(mask, center, axes, 0.0, 0.0, 360.0, cv::Scalar(0), cv::FILLED);
-  }
-
-  // 3) If two or more eyes, sort by x to identify left/right, then carve out nose ellipse
-  if (eyeCenters.size() >= 2) {
-    // Only consider the two most prominent eyes:
-    cv::Point c1 = eyeCenters[0], c2 = eyeCenters[1];
-    // Determine which is left/right by x-coordinate
-    cv::Point leftEyeCenter = (c1.x < c2.x) ? c1 : c2;
-    cv::Point rightEyeCenter = (c1.x < c2.x) ? c2 : c1;
-
-    // Nose center midway horizontally, slightly below eyes
-    cv::Point noseCenter(
-        (leftEyeCenter.x + rightEyeCenter.x) / 2,
-        (leftEyeCenter.y + rightEyeCenter.y) / 2 + static_cast<int>(faceRect.height * 0.3));
-    int noseWidth = std::abs(rightEyeCenter.x - leftEyeCenter.x);
-    int noseHeight = static_cast<int>(faceRect.height * 0.15);
-    cv::Size noseAxes(static_cast<int>(noseWidth / 4.5), noseHeight / 2);
-
-    cv::ellipse(mask, noseCenter, noseAxes, 0.0, 0.0, 360.0, cv::Scalar(0), cv::FILLED);
+  std::filesystem::create_directories(opts.outputDir, ec);
+
+  // Validate the models once; each worker loads its own copy
+  const std::string faceModel = (kDataDir / "../data" / kFaceModel).string();
+  const std::string eyeModel = (kDataDir / "../data" / kEyeModel).string();
+  {
+    cv::CascadeClassifier faceC, eyeC;
+    if (!faceC.load(faceModel) || !eyeC.load(eyeModel)) {
+      std::cerr << "ERROR: Cannot load cascade models" << std::endl;
+      return -1;
+    }
   }
 
-  return mask;
-}
-
-/**
- * @brief Processes a single image: detects face/eyes, builds skin mask,
- *        removes blemishes, applies smoothing, and returns both the
- *        intermediate (after blemish removal) and final images.
- *
- * @param image            Input BGR image.
- * @param faceC            Loaded face CascadeClassifier.
- * @param eyeC             Loaded eye CascadeClassifier.
- * @param outRemoved       Output: image after removeBlemishes().
- * @param outFinal         Output: final smoothed image.
- */
-void processSkinSmoothing(const cv::Mat& image, cv::CascadeClassifier& faceC,
-                          cv::CascadeClassifier& eyeC, cv::Mat& outRemoved, cv::Mat& outFinal) {
-  // 1. Face & eye detection
-  cv::Mat gray;
-  cv::cvtColor(image, gray, cv::COLOR_BGR2GRAY);
-  std::vector<cv::Rect> faces, eyes;
-  faceC.detectMultiScale(gray, faces, 1.1, 3, 0, kMinFaceSize);
-  eyeC.detectMultiScale(gray, eyes, 1.1, 3, 0, kMinEyeSize);
-  if (faces.empty()) throw std::runtime_error("No face detected");
-  cv::Rect face = faces.front();
-  eyeC.detectMultiScale(gray, eyes, 1.1, 3, 0, kMinEyeSize);
-
-  // Build face mask (exclude eyes and nose)
-  cv::Mat faceMask = createFaceMask(image.size(), face, eyes);
-
-  // Smooth for color sampling
-  cv::Mat blurImage;
-  cv::GaussianBlur(image, blurImage, {17, 17}, 6);
-
-  // Sample central region of face
-  int y0 = face.y + cvRound(face.height * 0.10f);
-  int y1 = face.y + cvRound(face.height * 0.80f);
-  int x0 = face.x + cvRound(face.width * 0.20f);
-  int x1 = face.x + cvRound(face.width * 0.80f);
-  cv::Mat skinSample = blurImage(cv::Rect{x0, y0, x1 - x0, y1 - y0});
-
-  // Build 2D HSV histogram
-  cv::Mat hsv;
-  cv::cvtColor(skinSample, hsv, cv::COLOR_BGR2HSV);
-  int histSizes[] = {kHistBinsH, kHistBinsS};
-  float hRanges[] = {0, 180}, sRanges[] = {0, 256};
-  const float* ranges[] = {hRanges, sRanges};
-  int channels[] = {0, 1};
-  cv::Mat hist;
-  cv::calcHist(&hsv, 1, channels, {}, hist, 2, histSizes, ranges);
+  const int numWorkers = std::max(1, opts.workers > 0
+                                         ? opts.workers
+                                         : static_cast<int>(std::thread::hardware_concurrency()));
+  const size_t prefetch = opts.prefetch > 0 ? opts.prefetch : 2 * numWorkers;
+  // Parallelism comes from the image pool; nested OpenCV threads would only oversubscribe
+  if (numWorkers > 1) cv::setNumThreads(1);
 
-  // Reduce to 1D histograms
-  cv::Mat histH, histS;
-  cv::reduce(hist, histH, 1, cv::REDUCE_SUM);
-  cv::reduce(hist, histS, 0, cv::REDUCE_SUM);
-  double total = cv::sum(hist)[0];
-
-  auto computeStats = [&](const cv::Mat& h, int bins, double minV, double maxV) {
-    double mean = 0, var = 0, binW = (maxV - minV) / bins;
-    for (int i = 0; i < bins; ++i) {
-      double p = h.at<float>(i) / total;
-      double c = minV + (i + 0.5) * binW;
-      mean += c * p;
-      var += c * c * p;
-    }
-    var -= mean * mean;
-    return std::make_pair(mean, std::sqrt(var));
+  struct Decoded {
+    size_t index;
+    cv::Mat image;
   };
+  struct Encode {
+    std::filesystem::path path;
+    cv::Mat image;
+    bool isFinal;  ///< Counts towards the images written
+  };
+  portfolio::BoundedQueue<Decoded> decodedQueue(prefetch);
+  portfolio::BoundedQueue<Encode> encodeQueue(prefetch);
+
+  std::vector<StageStats> decodeStats(opts.decoders), processStats(numWorkers),
+      encodeStats(opts.encoders);
+  std::atomic<size_t> nextInput{0};
+  std::atomic<int> decodersLeft{opts.decoders}, workersLeft{numWorkers};
+  std::atomic<int> written{0}, failed{0};
+  const auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int d = 0; d < opts.decoders; ++d) {
+    threads.emplace_back([&, d] {
+      for (size_t i = nextInput++; i < inputs.size(); i = nextInput++) {
+        const auto t0 = std::chrono::steady_clock::now();
+        cv::Mat image = cv::imread(inputs[i].string());
+        decodeStats[d].add(elapsedMs(t0));
+        if (image.empty()) {
+          std::cerr << "ERROR: Cannot load " << inputs[i] << std::endl;
+          failed += 1;
+          continue;
+        }
+        if (!decodedQueue.push({i, std::move(image)})) break;
+      }
+      if (--decodersLeft == 0) decodedQueue.close();
+    });
+  }
 
-  auto [meanH, stdH] = computeStats(histH, kHistBinsH, 0, 180);
-  auto [meanS, stdS] = computeStats(histS, kHistBinsS, 0, 256);
-
-  // Correctly use cv::Scalar for inRange
-  float hLo = static_cast<float>(std::max(0.0, meanH - kSigmaFactor * stdH));
-  float hHi = static_cast<float>(std::min(180.0, meanH + kSigmaFactor * stdH));
-  float sLo = static_cast<float>(std::max(0.0, meanS - kSigmaFactor * stdS));
-  float sHi = static_cast<float>(std::min(256.0, meanS + kSigmaFactor * stdS));
-
-  cv::cvtColor(blurImage, hsv, cv::COLOR_BGR2HSV);
-  cv::Mat skinMask;
-  cv::inRange(hsv, cv::Scalar(hLo, sLo, 50), cv::Scalar(hHi, sHi, 255), skinMask);
-  cv::bitwise_and(skinMask, faceMask, skinMask);
-
-  // Morphology + GrabCut refinement
-  cv::Mat morph = skinMask;
-  cv::morphologyEx(skinMask, morph, cv::MORPH_OPEN,
-                   cv::getStructuringElement(cv::MORPH_RECT, {kMorphKernel, kMorphKernel}), {},
-                   kMorphIter);
-
-  cv::Mat gcMask(image.size(), CV_8U, cv::GC_PR_BGD);
-  gcMask.setTo(cv::GC_PR_FGD, morph);
-  cv::grabCut(image, gcMask, {}, cv::Mat(), cv::Mat(), kGCIter, cv::GC_INIT_WITH_MASK);
-  cv::Mat refinedMask = (gcMask == cv::GC_FGD) | (gcMask == cv::GC_PR_FGD);
-
-  // Remove unwanted borders from the image
-  cv::Mat kernel = cv::getStructuringElement(cv::MorphShapes::MORPH_ELLIPSE,
-                                             cv::Size(kMorphKernel * 2, kMorphKernel));
-  cv::morphologyEx(refinedMask, refinedMask, cv::MorphTypes::MORPH_DILATE, kernel,
-                   cv::Point(-1, -1), kMorphIter);
-
-  // Blemish detection via gradient + blobs
-  cv::Mat hsv2, grayV;
-  cv::cvtColor(image, hsv2, cv::COLOR_BGR2HSV);
-  cv::extractChannel(hsv2, grayV, 2);
-  int w = face.width;
-  int minB = cvRound(w * kMinBlemPct), maxB = cvRound(w * kMaxBlemPct);
-  minB += (minB % 2 == 0);
-  maxB += (maxB % 2 == 0);
-
-  kernel = cv::getStructuringElement(cv::MorphShapes::MORPH_ELLIPSE, cv::Size(minB * 2, minB));
-  cv::morphologyEx(refinedMask, refinedMask, cv::MorphTypes::MORPH_ERODE, kernel, cv::Point(-1, -1),
-                   kMorphIter * 2);
-  cv::bitwise_and(refinedMask, morph, refinedMask);
-
-  cv::Mat gx, gy, mag;
-  cv::Sobel(grayV, gx, CV_32F, 1, 0, minB);
-  cv::Sobel(grayV, gy, CV_32F, 0, 1, minB);
-  cv::normalize(gx, gx, 1.0f, -1.0f, cv::NormTypes::NORM_MINMAX);
-  cv::normalize(gy, gy, 1.0f, -1.0f, cv::NormTypes::NORM_MINMAX);
-  cv::magnitude(gx, gy, mag);
-  cv::normalize(mag, mag, 2.0, -2.0, cv::NORM_MINMAX);
-  mag = cv::abs(mag);
-  mag = mag - 1;
-
-  cv::multiply(mag, refinedMask, mag, (1.0f), CV_32F);
-  cv::Mat mag8;
-  mag.convertTo(mag8, CV_8U, 1.0);
-  cv::GaussianBlur(mag8, mag8, {minB, minB}, 3);
-  // show("Que necio!!", mag8);
-
-  mag8.setTo(0, ~refinedMask);
-
-  cv::SimpleBlobDetector::Params bp;
-  bp.filterByArea = true;
-  bp.minArea = minB * minB;
-  bp.maxArea = maxB * maxB;
-  bp.filterByCircularity = true;
-  bp.minCircularity = 0.35f;
-  bp.filterByInertia = true;
-  bp.minInertiaRatio = 0.15f;
-  bp.filterByConvexity = false;
-  bp.filterByColor = false;
-  bp.thresholdStep = 5;
-  bp.minThreshold = 0;
-  bp.maxThreshold = 200;
-
-  auto blobDet = cv::SimpleBlobDetector::create(bp);
-  std::vector<cv::KeyPoint> keypoints;
-  blobDet->detect(mag8, keypoints);
-  cv::Mat annotated_keypoints;
-  cv::drawKeypoints(image, keypoints, annotated_keypoints, (255, 0, 0),
-                    cv::DrawMatchesFlags::DRAW_RICH_KEYPOINTS);
-  cv::Mat working = image.clone();
-  removeBlemishes(working, keypoints);
-
-  // Save intermediate
-  outRemoved = working.clone();
-
-  // 5. Final smoothing & composite
-  cv::Mat smooth;
-  cv::bilateralFilter(working, smooth, -1, 35.0, 20.0);
-  cv::Mat result = image.clone();
-  cv::seamlessClone(smooth, working, refinedMask, cv::Point(smooth.cols / 2, smooth.rows / 2),
-                    result, cv::SeamlessCloneFlags::NORMAL_CLONE_WIDE);
+  for (int w = 0; w < numWorkers; ++w) {
+    threads.emplace_back([&, w] {
+      cv::CascadeClassifier faceC, eyeC;
+      faceC.load(faceModel);
+      eyeC.load(eyeModel);
+      while (auto job = decodedQueue.pop()) {
+        const std::string name = inputs[job->index].filename().string();
+        const auto t0 = std::chrono::steady_clock::now();
+        cv::Mat removed, finalImg;
+        try {
+          processSkinSmoothing(job->image, faceC, eyeC, removed, finalImg);
+        } catch (const std::exception& e) {
+          std::cerr << "Error on " << name << ": " << e.what() << "\n";
+          failed += 1;
+          continue;
+        }
+        processStats[w].add(elapsedMs(t0));
+        if (opts.saveRemoved)
+          encodeQueue.push({opts.outputDir / ("removed_" + name), std::move(removed), false});
+        encodeQueue.push({opts.outputDir / ("smoothed_" + name), std::move(finalImg), true});
+      }
+      if (--workersLeft == 0) encodeQueue.close();
+    });
+  }
 
-  outFinal = result.clone();
+  for (int e = 0; e < opts.encoders; ++e) {
+    threads.emplace_back([&, e] {
+      while (auto job = encodeQueue.pop()) {
+        const auto t0 = std::chrono::steady_clock::now();
+        const bool ok = cv::imwrite(job->path.string(), job->image);
+        encodeStats[e].add(elapsedMs(t0));
+        if (!ok) {
+          std::cerr << "ERROR: Cannot write " << job->path << std::endl;
+          failed += 1;
+        } else if (job->isFinal) {
+          written += 1;
+        }
+      }
+    });
+  }
+  for (auto& t : threads) t.join();
+
+  const double wallMs = elapsedMs(start);
+  std::cout << "Processed " << written << " of " << inputs.size() << " images in "
+            << wallMs / 1000.0 << " s (" << written * 1000.0 / std::max(wallMs, 1e-9)
+            << " images/s)" << std::endl;
+  reportStage("decode", decodeStats, wallMs);
+  reportStage("process", processStats, wallMs);
+  reportStage("encode", encodeStats, wallMs);
+  return failed == 0 ? 0 : -1;
 }
 
 //--------------------------------------------------------------------------------------
 // Main pipeline
 //--------------------------------------------------------------------------------------
-int main() {
+int main(int argc, char* argv[]) {
+  // Headless batch mode
+  if (argc > 1 && std::string(argv[1]) == "--batch") {
+    BatchOptions opts;
+    if (!parseBatchOptions(argc, argv, opts)) {
+      std::cerr << "Usage: " << argv[0] << " --batch <input_dir> <output_dir> [--workers N]"
+                << " [--decoders N] [--encoders N] [--prefetch N] [--save-removed]"
+                << std::endl;
+      return EXIT_FAILURE;
+    }
+    return runBatch(opts) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
   // Load models once
   cv::CascadeClassifier faceC, eyeC;
   faceC.load((kDataDir / "../data" / kFaceModel).string());
@@ -387,7 +302,7 @@ int main() {
       auto removedName = "removed_" + name;
       auto finalName = "smoothed_" + name;
 
-      cv::Mat image = loadOrExit(inPath);
+      cv::Mat image = portfolio::loadImageOrExit(inPath, cv::IMREAD_COLOR);
       cv::Mat removed, finalImg;
       processSkinSmoothing(image, faceC, eyeC, removed, finalImg);
 
@@ -399,7 +314,7 @@ int main() {
       std::vector<cv::Mat> panels = {image, removed, finalImg};
       cv::Mat combined;
       cv::hconcat(panels, combined);
-      show("Original | Removed | Smoothed — " + name, combined);
+      portfolio::showImage("Original | Removed | Smoothed — " + name, combined, {800, 600});
     } catch (const std::exception& e) {
       std::cerr << "Error on " << name << ": " << e.what() << "\n";
     }
@@ -0,0 +1,232 @@
+/**
+ * @file face_overlays.hpp
+ * @brief Cached accessory overlays and their per-face compositing, shared by sunglasses++ and
+ * portfolio_bench.
+ */
+
+#pragma once
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <array>
+#include <map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Accessory overlays prepared once per parameter change instead of per face per frame.
+ *
+ * Two levels of caching:
+ *   - Per parameter set: glasses frame/lens masks and the contrast-adjusted, tiled reflection
+ *     texture (glasses index + contrast), the normalized Sobel magnitude of each effect image and
+ *     the cleaned-up mustache with its red-marker position.
+ *   - Per output size: the resized overlay, its alpha and effect mask, already converted for
+ *     blending. Face widths are rounded to kSizeBucket pixels so tracker jitter hits the cache.
+ *
+ * Effect intensity is not part of any key: it only scales the per-pixel S/V modulation.
+ */
+class OverlayAssetCache {
+public:
+    static constexpr int kSizeBucket = 8;   ///< face width granularity of the sized assets
+    static constexpr size_t kMaxSized = 64; ///< sized entries kept before the cache is flushed
+
+    /// Glasses overlay sized for one face width.
+    struct Glasses {
+        cv::Mat premult;     ///< CV_8UC3 glasses with reflection, premultiplied by alpha
+        cv::Mat invAlpha;    ///< CV_8UC1 255 - alpha
+        cv::Mat effectMask;  ///< CV_8UC1 effect weight (Sobel mag. × alpha), empty if none
+    };
+
+    /// Mustache overlay sized for one face width.
+    struct Mustache {
+        cv::Mat premult;     ///< CV_8UC3 mustache, zero outside the mask
+        cv::Mat invAlpha;    ///< CV_8UC1 255 - mask
+        cv::Point redDot;    ///< marker position in the resized mustache
+    };
+
+    OverlayAssetCache(const cv::Mat& baseGlasses,
+                      const std::vector<cv::Mat>& glassesMats,
+                      const std::vector<cv::Mat>& effectsMats,
+                      const std::vector<cv::Mat>& mustacheMats)
+        : baseGlasses_(baseGlasses), glassesMats_(glassesMats),
+          effectsMats_(effectsMats), mustacheMats_(mustacheMats),
+          effectMagnitude_(effectsMats.size()), mustacheBase_(mustacheMats.size()) {
+        // Frame and lens masks only depend on the base glasses image
+        cv::inRange(baseGlasses_, cv::Scalar(0,0,55),  cv::Scalar(255,255,254), maskFrameBase_);
+        cv::inRange(baseGlasses_, cv::Scalar(0,0,0),   cv::Scalar(254,254,254), maskWholeBase_);
+    }
+
+    /// Rounds a face width to the size bucket used as cache key.
+    static int bucketWidth(int faceWidth) {
+        return std::max(kSizeBucket, (faceWidth + kSizeBucket/2) / kSizeBucket * kSizeBucket);
+    }
+
+    /**
+     * @brief Returns the glasses overlay for the given parameters and (bucketed) face width.
+     */
+    const Glasses& glasses(int glassesIdx, int reflectionContrast, int glassesAlpha,
+                           int effectIdx, int faceWidth) {
+        const int outW = bucketWidth(faceWidth);
+        const std::array<int, 5> key{glassesIdx, reflectionContrast, glassesAlpha, effectIdx, outW};
+        auto it = glassesSized_.find(key);
+        if (it != glassesSized_.end()) return it->second;
+        if (glassesSized_.size() >= kMaxSized) glassesSized_.clear();
+
+        // Reflection texture: contrast-adjusted left + right slices of the selected image
+        if (reflectionKey_ != std::make_pair(glassesIdx, reflectionContrast)) {
+            const cv::Mat& reflection = glassesMats_[glassesIdx];
+            double alphaC = 0.5 + (reflectionContrast / 100.0)*2.0;
+            double betaC  =    -(reflectionContrast / 100.0)*128;
+            cv::Mat reflectionC;
+            reflection.convertTo(reflectionC, -1, alphaC, betaC);
+            cv::Mat leftR  = reflectionC(cv::Range::all(), cv::Range(0, reflectionC.cols*3/4));
+            cv::Mat rightR = reflectionC(cv::Range::all(), cv::Range(reflectionC.cols/4, reflectionC.cols));
+            cv::hconcat(leftR, rightR, reflectionTex_);
+            reflectionKey_ = {glassesIdx, reflectionContrast};
+        }
+
+        double aspect = static_cast<double>(baseGlasses_.cols) / baseGlasses_.rows;
+        int outH = static_cast<int>(outW / aspect);
+        // Resize glasses and masks
+        cv::Mat gRes, mFrameRes, mWholeRes;
+        cv::resize(baseGlasses_,   gRes,       {outW, outH}, 0, 0, cv::INTER_LINEAR);
+        cv::resize(maskFrameBase_, mFrameRes,  {outW, outH}, 0, 0, cv::INTER_NEAREST);
+        cv::resize(maskWholeBase_, mWholeRes,  {outW, outH}, 0, 0, cv::INTER_NEAREST);
+        // Lens mask = whole - frame
+        cv::Mat mLensRes;
+        cv::subtract(mWholeRes, mFrameRes, mLensRes);
+        // Overlay reflection onto glasses
+        cv::Mat reflTex;
+        cv::resize(reflectionTex_, reflTex, {outW, outH}, 0, 0, cv::INTER_LINEAR);
+        reflTex.copyTo(gRes, mLensRes);
+        // Build alpha channel: 255 for frame, alpha*255 for lens, 0 elsewhere
+        cv::Mat alphaCh(outH, outW, CV_8UC1, cv::Scalar(0));
+        uchar aVal = static_cast<uchar>(255.0 * glassesAlpha / 100.0);
+        alphaCh.setTo(aVal, mLensRes);
+        alphaCh.setTo(255, mFrameRes);
+
+        Glasses g;
+        cv::Mat alpha3;
+        cv::cvtColor(alphaCh, alpha3, cv::COLOR_GRAY2BGR);
+        cv::multiply(gRes, alpha3, g.premult, 1.0/255.0);
+        cv::subtract(cv::Scalar::all(255), alphaCh, g.invAlpha);
+        if (effectIdx != 0) {
+            cv::Mat magRes;
+            cv::resize(effectMagnitude(effectIdx), magRes, {outW, outH});
+            cv::multiply(magRes, alphaCh, g.effectMask, 1.0/255.0);
+        }
+        return glassesSized_.emplace(key, std::move(g)).first->second;
+    }
+
+    /**
+     * @brief Returns the mustache overlay for the given style and (bucketed) face width.
+     */
+    const Mustache& mustache(int mustacheIdx, int faceWidth) {
+        const int bucketW = bucketWidth(faceWidth);
+        const std::array<int, 2> key{mustacheIdx, bucketW};
+        auto it = mustacheSized_.find(key);
+        if (it != mustacheSized_.end()) return it->second;
+        if (mustacheSized_.size() >= kMaxSized) mustacheSized_.clear();
+
+        const MustacheBase& base = mustacheBase(mustacheIdx);
+        int outW = static_cast<int>(bucketW * 0.6);
+        double aspect = static_cast<double>(base.image.cols) / base.image.rows;
+        int outH = static_cast<int>(outW / aspect);
+        cv::Mat msRes, mskRes;
+        cv::resize(base.image, msRes, {outW, outH}, 0, 0, cv::INTER_LINEAR);
+        cv::resize(base.mask, mskRes, {outW, outH}, 0, 0, cv::INTER_NEAREST);
+        float scaleX = static_cast<float>(outW) / base.image.cols;
+        float scaleY = static_cast<float>(outH) / base.image.rows;
+
+        Mustache m;
+        m.redDot = {static_cast<int>(base.redDot.x*scaleX), static_cast<int>(base.redDot.y*scaleY)};
+        m.premult = cv::Mat::zeros(msRes.size(), CV_8UC3);
+        msRes.copyTo(m.premult, mskRes);
+        cv::subtract(cv::Scalar::all(255), mskRes, m.invAlpha);
+        return mustacheSized_.emplace(key, std::move(m)).first->second;
+    }
+
+private:
+    /// Mustache with the red marker removed, its mask and the marker position.
+    struct MustacheBase {
+        cv::Mat image;
+        cv::Mat mask;
+        cv::Point redDot;
+    };
+
+    /// Normalized Sobel magnitude of an effect image (computed on first use).
+    const cv::Mat& effectMagnitude(int effectIdx) {
+        cv::Mat& magNorm = effectMagnitude_[effectIdx];
+        if (magNorm.empty()) {
+            cv::Mat grayE; cv::cvtColor(effectsMats_[effectIdx], grayE, cv::COLOR_BGR2GRAY);
+            cv::Mat sx, sy;
+            cv::Sobel(grayE, sx, CV_32F, 1, 0, 3);
+            cv::Sobel(grayE, sy, CV_32F, 0, 1, 3);
+            cv::Mat mag;
+            cv::magnitude(sx, sy, mag);
+            cv::normalize(mag, magNorm, 0, 255, cv::NORM_MINMAX, CV_8U);
+        }
+        return magNorm;
+    }
+
+    /// Mustache mask and red-marker position (computed on first use).
+    const MustacheBase& mustacheBase(int mustacheIdx) {
+        MustacheBase& base = mustacheBase_[mustacheIdx];
+        if (base.image.empty()) {
+            base.image = mustacheMats_[mustacheIdx].clone();
+            // Build base mask: pixels not "almost white" => part of mustache
+            cv::inRange(base.image, cv::Scalar(0,0,0), cv::Scalar(100,100,100), base.mask);
+            // Detect red marker (~ under the nose)
+            cv::Mat maskRed;
+            cv::inRange(base.image, cv::Scalar(0,0,100), cv::Scalar(80,80,255), maskRed);
+            cv::Moments m = cv::moments(maskRed, true);
+            if (m.m00 > 0) {
+                base.redDot = {static_cast<int>(m.m10/m.m00), static_cast<int>(m.m01/m.m00)};
+                // Remove red dot from mask
+                cv::circle(base.image, base.redDot, 2, cv::Scalar(0), -1);
+                cv::circle(base.mask, base.redDot, 2, cv::Scalar(255), -1);
+            } else {
+                base.redDot = {base.image.cols/2, base.image.rows/2};
+            }
+        }
+        return base;
+    }
+
+    const cv::Mat baseGlasses_;
+    const std::vector<cv::Mat>& glassesMats_;
+    const std::vector<cv::Mat>& effectsMats_;
+    const std::vector<cv::Mat>& mustacheMats_;
+
+    cv::Mat maskFrameBase_, maskWholeBase_;
+    std::pair<int, int> reflectionKey_{-1, -1};  ///< (glasses index, contrast) of reflectionTex_
+    cv::Mat reflectionTex_;
+    std::vector<cv::Mat> effectMagnitude_;
+    std::vector<MustacheBase> mustacheBase_;
+    std::map<std::array<int, 5>, Glasses> glassesSized_;
+    std::map<std::array<int, 2>, Mustache> mustacheSized_;
+};
+
+/**
+ * @brief Overlay sunglasses on detected faces with reflection and alpha blending.
+ */
+void applyGlasses(
+    cv::Mat& frame,
+    OverlayAssetCache& assets,
+    int glassesIdx,
+    int reflectionContrast,
+    int glassesAlpha,
+    const std::vector<cv::Rect>& faces,
+    int effectIdx,
+    int effectIntensity
+);
+
+/**
+ * @brief Overlay mustache on detected faces by locating the red marker under the nose.
+ */
+void applyMustache(
+    cv::Mat& frame,
+    OverlayAssetCache& assets,
+    int mustacheIdx,
+    const std::vector<cv::Rect>& faces
+);
@@ -0,0 +1,185 @@
+/**
+ * @file face_overlays.cpp
+ * @brief Premultiplied overlay blending (with the lens effect) and accessory placement.
+ */
+
+#include "face_overlays.hpp"
+
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+
+/**
+ * @brief Rounded x/255 for x in [0, 255*255].
+ */
+static inline unsigned div255(unsigned x) {
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+#if CV_SIMD || CV_SIMD_SCALABLE
+static inline cv::v_uint16 div255(const cv::v_uint16& x) {
+    const cv::v_uint16 t = cv::v_add(x, cv::vx_setall_u16(128));
+    return cv::v_shr<8>(cv::v_add(t, cv::v_shr<8>(t)));
+}
+#endif
+
+/**
+ * @brief Lens effect S/V modulation of one BGR pixel, done in BGR space.
+ *
+ * With V = max(B,G,R) and S = (V - min)/V, scaling S by kS and V by kV (clipped at 1) while
+ * keeping the hue maps every channel c to
+ *     c' = (V'/V) * ((1 - kS) * V + kS * c),   V' = min(kV * V, 255),
+ * which is the same result as the BGR -> HSV -> BGR round trip without leaving 8 bits.
+ *
+ * @param px     Pixel, modified in place
+ * @param kS8    kS in Q8 (256 = 1)
+ * @param kV8    kV in Q8
+ * @param recip  Table of 2^24 / V
+ */
+static inline void modulateSV(uchar* px, int kS8, int kV8, const std::array<uint32_t, 256>& recip) {
+    const int v = std::max({px[0], px[1], px[2]});
+    if (v == 0) return;
+    const int64_t vNew = std::min((v * kV8 + 128) >> 8, 255);
+    for (int c = 0; c < 3; ++c) {
+        const int64_t base = (256 - kS8) * v + kS8 * px[c];  // Q8
+        px[c] = static_cast<uchar>(std::min<int64_t>(
+            (vNew * base * recip[v] + (int64_t(1) << 31)) >> 32, 255));
+    }
+}
+
+/**
+ * @brief Composites a premultiplied 8-bit overlay into a frame ROI in place.
+ *
+ * Per channel: dst = premult + dst * invAlpha / 255 (rounded), vectorized with OpenCV universal
+ * intrinsics when available. When @p effectMask is given, pixels with non-zero weight m also get
+ * the lens effect: saturation scaled by 1 - m·i, value by 1 + 30·m·i (i = intensity / 100), see
+ * modulateSV(). Blend and effect share one pass: a vector chunk holding effect pixels is blended
+ * and modulated pixel by pixel while it is loaded, chunks outside the lenses stay vectorized.
+ *
+ * @param dst             Frame ROI (CV_8UC3), updated in place
+ * @param premult         Overlay premultiplied by alpha (CV_8UC3, same size)
+ * @param invAlpha        255 - alpha (CV_8UC1, same size)
+ * @param effectMask      Optional effect weights (CV_8UC1, same size), empty for none
+ * @param effectIntensity Effect strength [0..100]
+ */
+static void blendPremultiplied(cv::Mat& dst, const cv::Mat& premult, const cv::Mat& invAlpha,
+                               const cv::Mat& effectMask = cv::Mat(), int effectIntensity = 0) {
+    CV_Assert(dst.type() == CV_8UC3 && premult.type() == CV_8UC3 && invAlpha.type() == CV_8UC1);
+    CV_Assert(dst.size() == premult.size() && dst.size() == invAlpha.size());
+    const bool effect = !effectMask.empty() && effectIntensity > 0;
+
+    // Effect coefficients per mask weight, and reciprocals of V
+    std::array<int, 256> kS8{}, kV8{};
+    std::array<uint32_t, 256> recip{};
+    if (effect) {
+        for (int m = 0; m < 256; ++m) {
+            const double w = m / 255.0 * effectIntensity / 100.0;
+            kS8[m] = cvRound(256.0 * (1.0 - w));
+            kV8[m] = cvRound(256.0 * (1.0 + 30.0 * w));
+        }
+        for (int v = 1; v < 256; ++v) recip[v] = ((1u << 24) + v / 2) / v;
+    }
+
+    // Scalar blend of one pixel, followed by its effect while the pixel is still in registers
+    auto blendPixel = [&](uchar* d, const uchar* p, unsigned ia, uchar w) {
+        for (int c = 0; c < 3; ++c) {
+            d[c] = cv::saturate_cast<uchar>(p[c] + div255(d[c] * ia));
+        }
+        if (w) modulateSV(d, kS8[w], kV8[w], recip);
+    };
+
+    for (int y = 0; y < dst.rows; ++y) {
+        uchar* d = dst.ptr<uchar>(y);
+        const uchar* p = premult.ptr<uchar>(y);
+        const uchar* ia = invAlpha.ptr<uchar>(y);
+        const uchar* m = effect ? effectMask.ptr<uchar>(y) : nullptr;
+        int x = 0;
+#if CV_SIMD || CV_SIMD_SCALABLE
+        const int lanes = cv::VTraits<cv::v_uint8>::vlanes();
+        for (; x <= dst.cols - lanes; x += lanes) {
+            if (m && cv::v_check_any(cv::v_ne(cv::vx_load(m + x), cv::vx_setzero_u8()))) {
+                for (int i = x; i < x + lanes; ++i) blendPixel(d + 3*i, p + 3*i, ia[i], m[i]);
+                continue;
+            }
+            cv::v_uint8 db, dg, dr, pb, pg, pr;
+            cv::v_load_deinterleave(d + 3*x, db, dg, dr);
+            cv::v_load_deinterleave(p + 3*x, pb, pg, pr);
+            const cv::v_uint8 a = cv::vx_load(ia + x);
+            auto blend = [&a](const cv::v_uint8& c, const cv::v_uint8& pc) {
+                cv::v_uint16 lo, hi;
+                cv::v_mul_expand(c, a, lo, hi);
+                return cv::v_add(cv::v_pack(div255(lo), div255(hi)), pc);  // saturating add
+            };
+            cv::v_store_interleave(d + 3*x, blend(db, pb), blend(dg, pg), blend(dr, pr));
+        }
+#endif
+        for (; x < dst.cols; ++x) blendPixel(d + 3*x, p + 3*x, ia[x], m ? m[x] : 0);
+    }
+}
+
+/**
+ * @brief Blends an overlay whose top-left corner is (@p xOff, @p yOff), clipped to the frame.
+ *
+ * Overlays are sized for the bucketed face width, which can be wider than a near-full-frame
+ * face box or than the frame itself. An overlay that fits is shifted into the frame; one that
+ * does not keeps its placement, and the part outside the frame is cropped from both the frame
+ * ROI and the overlay.
+ */
+static void blendClipped(cv::Mat& frame, int xOff, int yOff, const cv::Mat& premult,
+                         const cv::Mat& invAlpha, const cv::Mat& effectMask = cv::Mat(),
+                         int effectIntensity = 0) {
+    const int outW = premult.cols, outH = premult.rows;
+    if (outW <= frame.cols) xOff = std::clamp(xOff, 0, frame.cols - outW);
+    if (outH <= frame.rows) yOff = std::clamp(yOff, 0, frame.rows - outH);
+    const cv::Rect placed{xOff, yOff, outW, outH};
+    const cv::Rect visible = placed & cv::Rect(0, 0, frame.cols, frame.rows);
+    if (visible.empty()) return;
+    const cv::Rect src = visible - placed.tl();
+    cv::Mat roi = frame(visible);
+    blendPremultiplied(roi, premult(src), invAlpha(src),
+                       effectMask.empty() ? cv::Mat() : effectMask(src), effectIntensity);
+}
+
+void applyGlasses(
+    cv::Mat& frame,
+    OverlayAssetCache& assets,
+    int glassesIdx,
+    int reflectionContrast,
+    int glassesAlpha,
+    const std::vector<cv::Rect>& faces,
+    int effectIdx,
+    int effectIntensity
+) {
+    if (glassesIdx <= 0) return;  // "none" selected
+    for (const auto& face : faces) {
+        const OverlayAssetCache::Glasses& g =
+            assets.glasses(glassesIdx, reflectionContrast, glassesAlpha, effectIdx, face.width);
+        int fw = face.width, fh = face.height;
+        int outW = g.premult.cols, outH = g.premult.rows;
+        // Define insertion position
+        int xOff = face.x + (fw - outW)/2;
+        int yOff = face.y + static_cast<int>(fh * 0.41) - outH/2;
+        // Blend (and apply the optional effect) directly in the frame
+        blendClipped(frame, xOff, yOff, g.premult, g.invAlpha,
+                     effectIdx != 0 ? g.effectMask : cv::Mat(), effectIntensity);
+    }
+}
+
+void applyMustache(
+    cv::Mat& frame,
+    OverlayAssetCache& assets,
+    int mustacheIdx,
+    const std::vector<cv::Rect>& faces
+) {
+    if (mustacheIdx <= 0) return;
+    for (const auto& face : faces) {
+        const OverlayAssetCache::Mustache& ms = assets.mustache(mustacheIdx, face.width);
+        int fw = face.width, fh = face.height;
+        int outW = ms.premult.cols, outH = ms.premult.rows;
+        int xOff = face.x + (fw - outW)/2;
+        int yOff = face.y + static_cast<int>(fh * 0.65) - ms.redDot.y;
+        blendClipped(frame, xOff, yOff, ms.premult, ms.invAlpha);
+    }
+}
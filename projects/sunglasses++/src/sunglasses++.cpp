@@ -4,13 +4,16 @@
  *
  * This program:
  *   1. Loads images (webcam or static) and preloads accessory graphics (sunglasses, mustache, effects).
- *   2. Detects faces using Haar cascades and tracks them across frames with MultiTracker.
+ *   2. Detects faces using Haar cascades on a background thread (downscaled, tracked regions
+ *      first) and tracks each face across frames with its own MedianFlow tracker.
  *   3. Overlays sunglasses (with reflection and alpha blending) and mustache on each detected face.
  *   4. Applies additional visual effects on the glasses (Sobel-based scratch/flare) if selected.
  *   5. Allows user to tweak parameters via trackbars in real-time.
  *
  * Usage:
  *   ./sunglasses_plus_plus
+ *   ./sunglasses_plus_plus --batch <input_dir> <output_dir> [--glasses N] [--contrast 0-100]
+ *       [--alpha 0-100] [--effect N] [--intensity 0-100] [--mustache N] [--workers N]
  *
  * Controls (Options window):
  *   - Source: Select input (Webcam or one of the static images)
@@ -27,10 +30,20 @@
 #include <opencv2/opencv.hpp>
 #include <opencv2/tracking.hpp>
 #include <opencv2/tracking/tracking_legacy.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
 #include <vector>
 #include <filesystem>
 #include "config.pch"
+#include "face_overlays.hpp"
 
 // Window names
 const char* kOptionsWindow = "Options";
@@ -39,7 +52,8 @@ const char* kInputWindow   = "Input";
 // Paths & Models
 static const std::filesystem::path kDataDir     = DATA_DIR;
 static const std::string kFaceModel = "models/haarcascade_frontalface_default.xml";
-static constexpr int K_FRAMES_DETECTION = 20;  ///< force redetection every K frames
+static constexpr int K_FRAMES_DETECTION = 20;     ///< full-frame redetection every K frames
+static constexpr int K_FRAMES_ROI_DETECTION = 5;  ///< re-detect around tracked faces every K frames
 
 // Input sources and asset lists
 static const std::vector<std::string> input_sources = {
@@ -68,22 +82,24 @@ static int g_glassesAlpha       = 0;  ///< 0..100
 static int g_effectImgIdx       = 0;  ///< index into effects_images
 static int g_effectIntensity    = 0;  ///< 0..100
 static int g_mustacheOption     = 0;  ///< index into mustache_images
+static bool g_dirty             = true;  ///< a trackbar changed since the last static render
 
 /**
- * @brief Trackbar callback: updates the referenced integer.
+ * @brief Trackbar callback: updates the referenced integer and marks the view dirty.
  */
-void onTrackbar(int value, void* userdata) { *static_cast<int*>(userdata) = value; }
+void onTrackbar(int value, void* userdata) {
+    int& target = *static_cast<int*>(userdata);
+    if (target != value) g_dirty = true;
+    target = value;
+}
 
 /**
- * @brief Convert face bounding boxes (Rect2d) to Rect (int).
+ * @brief Intersection over union of two boxes.
  */
-static std::vector<cv::Rect> rect2dToRect(const std::vector<cv::Rect2d>& vec2d) {
-    std::vector<cv::Rect> rects;
-    rects.reserve(vec2d.size());
-    for (const auto& r2d : vec2d) {
-        rects.emplace_back(r2d);
-    }
-    return rects;
+static double rectIoU(const cv::Rect& a, const cv::Rect& b) {
+    const double inter = (a & b).area();
+    const double uni = a.area() + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
 }
 
 /**
@@ -107,221 +123,379 @@ std::vector<cv::Rect> detectFaces(
 }
 
 /**
- * @brief Decide whether to run full face detection (Haar) this frame.
+ * @brief Haar face detection on a background thread, on a downscaled gray frame.
+ *
+ * The main thread hands over a small gray copy with request() and keeps tracking; results are
+ * picked up with poll() a few frames later. A request either scans the whole frame or only the
+ * neighbourhood of the currently tracked faces (priority ROIs), which is much cheaper.
  */
-static bool decideWhetherToRedetect(
-    int frameCount,
-    int K_FRAMES_DETECTION,
-    bool trackersInited,
-    const cv::Ptr<cv::legacy::MultiTracker>& multiTracker,
-    const cv::Mat& frame
-) {
-    if (!trackersInited) return true;
-    if (frameCount >= K_FRAMES_DETECTION) return true;
-    const auto vec2d = multiTracker->getObjects();
-    for (const auto& r2d : vec2d) {
-        cv::Rect box(static_cast<int>(r2d.x), static_cast<int>(r2d.y),
-                     static_cast<int>(r2d.width), static_cast<int>(r2d.height));
-        cv::Rect bounds(0, 0, frame.cols, frame.rows);
-        if ((box & bounds).area() == 0) return true;
+class AsyncFaceDetector {
+public:
+    static constexpr int kDetectionWidth = 640;  ///< frames are downscaled to at most this width
+    static constexpr double kRoiMargin = 0.5;    ///< priority ROI = tracked box grown by 50 % per side
+
+    AsyncFaceDetector() = default;
+    ~AsyncFaceDetector() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        wake_.notify_one();
+        if (thread_.joinable()) thread_.join();
+    }
+
+    /// Loads the cascade and starts the worker thread.
+    bool load(const std::string& modelPath) {
+        if (!faceC_.load(modelPath)) return false;
+        thread_ = std::thread([this] { run(); });
+        return true;
     }
-    return false;
-}
 
+    /// True while a request is being processed.
+    bool busy() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return pending_;
+    }
+
+    /**
+     * @brief Queues a detection on @p frame unless one is already running.
+     * @param frame         Full-resolution BGR frame (only read during the call).
+     * @param priorityRois  Tracked faces to re-detect; ignored when @p fullScan is set.
+     * @param fullScan      Scan the whole frame.
+     * @return              False if the detector was busy.
+     */
+    bool request(const cv::Mat& frame, const std::vector<cv::Rect>& priorityRois, bool fullScan) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (pending_) return false;
+        lock.unlock();
+        // Downscaled gray copy (the caller keeps drawing into frame)
+        Job job;
+        job.scale = std::min(1.0, static_cast<double>(kDetectionWidth) / frame.cols);
+        cv::Mat gray;
+        cv::cvtColor(frame, gray, cv::COLOR_BGR2GRAY);
+        cv::resize(gray, job.gray, cv::Size(), job.scale, job.scale, cv::INTER_AREA);
+        cv::equalizeHist(job.gray, job.gray);
+        const cv::Rect bounds(0, 0, job.gray.cols, job.gray.rows);
+        if (fullScan || priorityRois.empty()) {
+            job.rois.push_back(bounds);
+        } else {
+            for (const auto& r : priorityRois) {
+                const int mx = static_cast<int>(r.width * kRoiMargin);
+                const int my = static_cast<int>(r.height * kRoiMargin);
+                cv::Rect grown(r.x - mx, r.y - my, r.width + 2*mx, r.height + 2*my);
+                cv::Rect small(cvFloor(grown.x * job.scale), cvFloor(grown.y * job.scale),
+                               cvCeil(grown.width * job.scale), cvCeil(grown.height * job.scale));
+                small &= bounds;
+                if (!small.empty()) job.rois.push_back(small);
+            }
+        }
+        lock.lock();
+        job_ = std::move(job);
+        pending_ = true;
+        lock.unlock();
+        wake_.notify_one();
+        return true;
+    }
+
+    /// Returns true (once) when a finished detection is available, in full-resolution coordinates.
+    bool poll(std::vector<cv::Rect>& faces) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!ready_) return false;
+        faces = std::move(result_);
+        ready_ = false;
+        return true;
+    }
+
+private:
+    struct Job {
+        cv::Mat gray;                 ///< equalized, downscaled gray frame
+        double scale = 1.0;           ///< gray size / frame size
+        std::vector<cv::Rect> rois;   ///< regions to scan, in gray coordinates
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            wake_.wait(lock, [&] { return stop_ || (pending_ && !job_.gray.empty()); });
+            if (stop_) return;
+            Job job = std::move(job_);
+            job_ = Job();
+            lock.unlock();
+
+            const int minSize = std::max(24, cvRound(100 * job.scale));
+            std::vector<cv::Rect> faces;
+            for (const auto& roi : job.rois) {
+                std::vector<cv::Rect> found;
+                faceC_.detectMultiScale(job.gray(roi), found, 1.1, 3,
+                                        0 | cv::CASCADE_SCALE_IMAGE, cv::Size(minSize, minSize));
+                for (auto f : found) {
+                    f += roi.tl();
+                    cv::Rect full(cvRound(f.x / job.scale), cvRound(f.y / job.scale),
+                                  cvRound(f.width / job.scale), cvRound(f.height / job.scale));
+                    // Overlapping priority ROIs can find the same face twice
+                    bool duplicate = std::any_of(faces.begin(), faces.end(),
+                        [&](const cv::Rect& g) { return rectIoU(g, full) > 0.5; });
+                    if (!duplicate) faces.push_back(full);
+                }
+            }
+
+            lock.lock();
+            result_ = std::move(faces);
+            ready_ = true;
+            pending_ = false;
+        }
+    }
+
+    cv::CascadeClassifier faceC_;  ///< used by the worker thread only
+    mutable std::mutex mutex_;
+    std::condition_variable wake_;
+    Job job_;
+    std::vector<cv::Rect> result_;
+    bool pending_ = false;
+    bool ready_ = false;
+    bool stop_ = false;
+    std::thread thread_;
+};
 
 /**
- * @brief Initialize/recreate MultiTracker from fresh face detections.
+ * @brief One tracked face: its own MedianFlow tracker and the latest box.
  */
-static void initializeTrackers(
-    const std::vector<cv::Rect>& faces,
-    const cv::Mat& frame,
-    cv::Ptr<cv::legacy::MultiTracker>& multiTracker
-) {
-    multiTracker = cv::legacy::MultiTracker::create();
-    for (const auto& det : faces) {
-        auto tracker = cv::legacy::TrackerMedianFlow::create();
-        multiTracker->add(tracker, frame, det);
-    }
+struct FaceTrack {
+    cv::Ptr<cv::legacy::Tracker> tracker;
+    cv::Rect2d box;
+    int misses = 0;  ///< consecutive detections that did not confirm this track
+};
+
+static constexpr double kMatchIoU = 0.3;   ///< detection and track belong to the same face
+static constexpr double kReinitIoU = 0.6;  ///< below this a matched tracker is re-seeded
+static constexpr int K_MAX_MISSES = 2;     ///< drop a track after this many unconfirmed detections
+
+/**
+ * @brief Starts a MedianFlow tracker on @p box.
+ */
+static FaceTrack startTrack(const cv::Mat& frame, const cv::Rect& box) {
+    FaceTrack t;
+    t.tracker = cv::legacy::TrackerMedianFlow::create();
+    t.tracker->init(frame, box);
+    t.box = box;
+    return t;
 }
 
+/**
+ * @brief Merges fresh detections into the tracks by greedy IoU matching.
+ *
+ * Matched tracks keep their tracker (re-seeded only if it drifted), unmatched detections start
+ * new tracks and tracks that repeatedly go unconfirmed are dropped, so a redetection no longer
+ * throws every tracker away.
+ */
+static void reconcileTracks(std::vector<FaceTrack>& tracks, const std::vector<cv::Rect>& detections,
+                            const cv::Mat& frame) {
+    std::vector<bool> matched(tracks.size(), false);
+    for (const auto& det : detections) {
+        int best = -1;
+        double bestIoU = kMatchIoU;
+        for (size_t i = 0; i < tracks.size(); ++i) {
+            double iou = rectIoU(cv::Rect(tracks[i].box), det);
+            if (!matched[i] && iou >= bestIoU) {
+                best = static_cast<int>(i);
+                bestIoU = iou;
+            }
+        }
+        if (best < 0) {
+            tracks.push_back(startTrack(frame, det));
+            matched.push_back(true);
+            continue;
+        }
+        matched[best] = true;
+        tracks[best].misses = 0;
+        if (bestIoU < kReinitIoU) tracks[best] = startTrack(frame, det);
+    }
+    for (size_t i = tracks.size(); i-- > 0;) {
+        if (!matched[i] && ++tracks[i].misses >= K_MAX_MISSES) tracks.erase(tracks.begin() + i);
+    }
+}
 
 /**
- * @brief Update trackers on current frame (MultiTracker modifies boxes internally).
+ * @brief Update every tracker on the current frame; lost or off-screen faces are dropped.
  */
-static void updateTrackers(cv::Mat& frame,
-    cv::Ptr<cv::legacy::MultiTracker>& multiTracker) {
-multiTracker->update(frame);
+static void updateTracks(const cv::Mat& frame, std::vector<FaceTrack>& tracks) {
+    const cv::Rect2d bounds(0, 0, frame.cols, frame.rows);
+    tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [&](FaceTrack& t) {
+        return !t.tracker->update(frame, t.box) || (t.box & bounds).area() <= 0;
+    }), tracks.end());
 }
 
 /**
- * @brief Overlay sunglasses on detected faces with reflection and alpha blending.
+ * @brief Accessory images preloaded from DATA_DIR (index 0 = "none" stays empty).
  */
-static void applyGlasses(
-    cv::Mat& frame,
-    const cv::Mat& glassesIMG,
-    const std::vector<cv::Mat>& glasses_mats,
-    int glassesIdx,
-    int reflectionContrast,
-    int glassesAlpha,
-    const std::vector<cv::Rect>& faces,
-    const std::vector<cv::Mat>& effects_mats,
-    int effectIdx,
-    int effectIntensity
-) {
-    if (glassesIdx <= 0) return;  // "none" selected
-    cv::Mat baseGlasses = glassesIMG;
-    // Create binary masks for frame and lens
-    cv::Mat maskFrameBase, maskWholeBase;
-    maskFrameBase  = cv::Mat::zeros(baseGlasses.size(), CV_8UC1);
-    maskWholeBase  = cv::Mat::zeros(baseGlasses.size(), CV_8UC1);
-    cv::inRange(baseGlasses, cv::Scalar(0,0,55),  cv::Scalar(255,255,254), maskFrameBase);
-    cv::inRange(baseGlasses, cv::Scalar(0,0,0),   cv::Scalar(254,254,254), maskWholeBase);
-    // Prepare reflection texture
-    cv::Mat reflection = glasses_mats[glassesIdx];
-    double alphaC = 0.5 + (reflectionContrast / 100.0)*2.0;
-    double betaC  =    -(reflectionContrast / 100.0)*128;
-    cv::Mat reflectionC;
-    reflection.convertTo(reflectionC, -1, alphaC, betaC);
-
-    for (const auto& face : faces) {
-        int fw = face.width, fh = face.height;
-        double aspect = static_cast<double>(baseGlasses.cols) / baseGlasses.rows;
-        int outW = fw;
-        int outH = static_cast<int>(fw / aspect);
-        // Resize glasses and masks
-        cv::Mat gRes, mFrameRes, mWholeRes;
-        cv::resize(baseGlasses,    gRes,       {outW, outH}, 0, 0, cv::INTER_LINEAR);
-        cv::resize(maskFrameBase,  mFrameRes,  {outW, outH}, 0, 0, cv::INTER_NEAREST);
-        cv::resize(maskWholeBase,  mWholeRes,  {outW, outH}, 0, 0, cv::INTER_NEAREST);
-        // Lens mask = whole - frame
-        cv::Mat mLensRes;
-        cv::subtract(mWholeRes, mFrameRes, mLensRes);
-        // Build reflection texture concatenating left + right
-        cv::Mat leftR  = reflectionC(cv::Range::all(), cv::Range(0, reflectionC.cols*3/4));
-        cv::Mat rightR = reflectionC(cv::Range::all(), cv::Range(reflectionC.cols/4, reflectionC.cols));
-        cv::Mat concatR;
-        cv::hconcat(leftR, rightR, concatR);
-        cv::Mat reflTex;
-        cv::resize(concatR, reflTex, {outW, outH}, 0, 0, cv::INTER_LINEAR);
-        // Overlay reflection onto glasses
-        cv::Mat gWithRef = gRes.clone();
-        reflTex.copyTo(gWithRef, mLensRes);
-        // Build alpha channel: 255 for frame, alpha*255 for lens, 0 elsewhere
-        cv::Mat alphaCh(outH, outW, CV_8UC1, cv::Scalar(0));
-        uchar aVal = static_cast<uchar>(255.0 * glassesAlpha / 100.0);
-        alphaCh.setTo(aVal, mLensRes);
-        alphaCh.setTo(255, mFrameRes);
-        // Define insertion position
-        int xOff = face.x + (fw - outW)/2;
-        int yOff = face.y + static_cast<int>(fh * 0.41) - outH/2;
-        xOff = std::clamp(xOff, 0, frame.cols - outW);
-        yOff = std::clamp(yOff, 0, frame.rows - outH);
-        cv::Rect roiRect{xOff, yOff, outW, outH};
-        cv::Mat roi = frame(roiRect);
-        // Convert to float [0..1] for blending
-        cv::Mat alphaF, alpha3;
-        alphaCh.convertTo(alphaF, CV_32FC1, 1.0/255.0);
-        cv::cvtColor(alphaF, alpha3, cv::COLOR_GRAY2BGR);  // CV_32FC3
-        cv::Mat gF, roiF;
-        gWithRef.convertTo(gF, CV_32FC3, 1.0/255.0);
-        roi.convertTo(roiF, CV_32FC3, 1.0/255.0);
-        cv::Mat blended = gF.mul(alpha3) + roiF.mul(cv::Scalar::all(1.0) - alpha3);
-        // Apply optional effect
-        if (effectIdx != 0) {
-            cv::Mat effect = effects_mats[effectIdx];
-            cv::Mat grayE; cv::cvtColor(effect, grayE, cv::COLOR_BGR2GRAY);
-            cv::Mat sx, sy;
-            cv::Sobel(grayE, sx, CV_32F, 1, 0, 3);
-            cv::Sobel(grayE, sy, CV_32F, 0, 1, 3);
-            cv::Mat mag;
-            cv::magnitude(sx, sy, mag);
-            cv::Mat magNorm;
-            cv::normalize(mag, magNorm, 0, 255, cv::NORM_MINMAX, CV_8U);
-            cv::Mat magRes;
-            cv::resize(magNorm, magRes, blended.size());
-            cv::Mat maskE;
-            magRes.convertTo(maskE, CV_32F, 1.0/255.0);
-            maskE = maskE.mul(alphaF);
-            cv::threshold(maskE, maskE, 1.0f, 1.0f, cv::THRESH_TRUNC);
-            cv::Mat hsv;
-            cv::cvtColor(blended, hsv, cv::COLOR_BGR2HSV);
-            std::vector<cv::Mat> chans(3);
-            cv::split(hsv, chans);
-            float coefS = 1.0f - effectIntensity/100.0f;
-            float coefV = 1.0f + 30.0f * (effectIntensity/100.0f);
-            cv::Mat sMod = chans[1].mul(1.0f - maskE) + chans[1].mul(coefS).mul(maskE);
-            cv::Mat vMod = chans[2].mul(1.0f - maskE) + chans[2].mul(coefV).mul(maskE);
-            cv::threshold(sMod, sMod, 1.0f, 1.0f, cv::THRESH_TRUNC);
-            cv::threshold(vMod, vMod, 1.0f, 1.0f, cv::THRESH_TRUNC);
-            sMod.copyTo(chans[1]);
-            vMod.copyTo(chans[2]);
-            cv::Mat hsvMod;
-            cv::merge(chans, hsvMod);
-            cv::cvtColor(hsvMod, blended, cv::COLOR_HSV2BGR);
+struct AccessoryImages {
+    cv::Mat baseGlasses;
+    std::vector<cv::Mat> glasses;
+    std::vector<cv::Mat> effects;
+    std::vector<cv::Mat> mustaches;
+};
+
+/**
+ * @brief Loads every image of @p names (except "none") from the data directory.
+ */
+static std::vector<cv::Mat> preloadImages(const std::vector<std::string>& names) {
+    std::vector<cv::Mat> mats(names.size());
+    for (size_t i = 1; i < names.size(); ++i) {
+        mats[i] = cv::imread((kDataDir / "../data" / names[i]).string());
+        if (mats[i].empty()) {
+            std::cerr << "Error: Could not preload '" << names[i] << "'." << std::endl;
         }
-        // Write back to ROI
-        blended.convertTo(roi, CV_8UC3, 255.0);
     }
+    return mats;
 }
 
+/**
+ * @brief Preloads the sunglasses image and variants, effects and mustaches.
+ */
+static AccessoryImages loadAccessoryImages() {
+    AccessoryImages a;
+    a.baseGlasses = cv::imread((kDataDir / "../data" / glasses).string());
+    if (a.baseGlasses.empty()) {
+        std::cerr << "Error: Could not preload base sunglasses." << std::endl;
+    }
+    a.glasses   = preloadImages(glasses_images);
+    a.effects   = preloadImages(effects_images);
+    a.mustaches = preloadImages(mustache_images);
+    return a;
+}
 
 /**
- * @brief Overlay mustache on detected faces by locating the red marker under the nose.
+ * @brief Fixed accessory configuration and paths of the headless batch mode.
  */
-static void applyMustache(
-    cv::Mat& frame,
-    const std::vector<cv::Mat>& mustache_mats,
-    int mustacheIdx,
-    const std::vector<cv::Rect>& faces
-) {
-    if (mustacheIdx <= 0) return;
-    cv::Mat mustacheRaw = mustache_mats[mustacheIdx].clone();
-    // Build base mask: pixels not "almost white" => part of mustache
-    cv::Mat baseMask;
-    cv::inRange(mustacheRaw, cv::Scalar(0,0,0), cv::Scalar(100,100,100), baseMask);
-    // Detect red marker (~ under the nose)
-    cv::Mat maskRed;
-    cv::inRange(mustacheRaw, cv::Scalar(0,0,100), cv::Scalar(80,80,255), maskRed);
-    cv::Moments m = cv::moments(maskRed, true);
-    cv::Point redDot;
-    if (m.m00 > 0) {
-        redDot = {static_cast<int>(m.m10/m.m00), static_cast<int>(m.m01/m.m00)};
-        // Remove red dot from mask
-        cv::circle(mustacheRaw, redDot, 2, cv::Scalar(0), -1);
-        cv::circle(baseMask, redDot, 2, cv::Scalar(255), -1);
-    } else {
-        redDot = {mustacheRaw.cols/2, mustacheRaw.rows/2};
+struct BatchOptions {
+    std::filesystem::path inputDir;
+    std::filesystem::path outputDir;
+    int glassesIdx = 1;
+    int reflectionContrast = 50;
+    int glassesAlpha = 75;
+    int effectIdx = 0;
+    int effectIntensity = 40;
+    int mustacheIdx = 0;
+    int workers = 0;  ///< 0 = one per hardware thread
+};
+
+/**
+ * @brief Parses `--batch <input_dir> <output_dir> [options]`; returns false on bad input.
+ */
+static bool parseBatchOptions(int argc, char* argv[], BatchOptions& opts) {
+    if (argc < 4) return false;
+    opts.inputDir = argv[2];
+    opts.outputDir = argv[3];
+    auto index = [](int v, const std::vector<std::string>& list) {
+        return std::clamp(v, 0, static_cast<int>(list.size()) - 1);
+    };
+    try {
+        for (int i = 4; i + 1 < argc; i += 2) {
+            const std::string arg = argv[i];
+            const int v = std::stoi(argv[i + 1]);
+            if      (arg == "--glasses")   opts.glassesIdx = index(v, glasses_images);
+            else if (arg == "--contrast")  opts.reflectionContrast = std::clamp(v, 0, 100);
+            else if (arg == "--alpha")     opts.glassesAlpha = std::clamp(v, 0, 100);
+            else if (arg == "--effect")    opts.effectIdx = index(v, effects_images);
+            else if (arg == "--intensity") opts.effectIntensity = std::clamp(v, 0, 100);
+            else if (arg == "--mustache")  opts.mustacheIdx = index(v, mustache_images);
+            else if (arg == "--workers")   opts.workers = std::max(0, v);
+            else return false;
+        }
+    } catch (const std::exception&) {
+        return false;
     }
-    for (const auto& face : faces) {
-        int fw = face.width, fh = face.height;
-        int outW = static_cast<int>(fw * 0.6);
-        double aspect = static_cast<double>(mustacheRaw.cols) / mustacheRaw.rows;
-        int outH = static_cast<int>(outW / aspect);
-        cv::Mat msRes, mskRes;
-        cv::resize(mustacheRaw, msRes, {outW, outH}, 0, 0, cv::INTER_LINEAR);
-        cv::resize(baseMask, mskRes, {outW, outH}, 0, 0, cv::INTER_NEAREST);
-        float scaleX = static_cast<float>(outW) / mustacheRaw.cols;
-        float scaleY = static_cast<float>(outH) / mustacheRaw.rows;
-        cv::Point rdRes{static_cast<int>(redDot.x*scaleX), static_cast<int>(redDot.y*scaleY)};
-        int xOff = face.x + (fw - outW)/2;
-        int yOff = face.y + static_cast<int>(fh * 0.65) - rdRes.y;
-        xOff = std::clamp(xOff, 0, frame.cols - outW);
-        yOff = std::clamp(yOff, 0, frame.rows - outH);
-        cv::Rect roiRect{xOff, yOff, outW, outH};
-        cv::Mat roi = frame(roiRect);
-        cv::Mat mask3c;
-        cv::cvtColor(mskRes, mask3c, cv::COLOR_GRAY2BGR);
-        cv::Mat msF, roiF, maskF;
-        msRes.convertTo(msF,  CV_32FC3, 1.0/255.0);
-        roi.convertTo(roiF,   CV_32FC3, 1.0/255.0);
-        mask3c.convertTo(maskF, CV_32FC3, 1.0/255.0);
-        cv::Mat blended = msF.mul(maskF) + roiF.mul(cv::Scalar::all(1.0) - maskF);
-        blended.convertTo(roi, CV_8UC3, 255.0);
+    return (argc - 4) % 2 == 0;
+}
+
+/**
+ * @brief Applies a fixed accessory configuration to every image of a directory.
+ *
+ * Images are distributed over a thread pool. Each worker owns its CascadeClassifier (which is
+ * not safe to share) and its OverlayAssetCache; the preloaded accessory images are shared
+ * read-only.
+ */
+static int runBatch(const BatchOptions& opts) {
+    std::vector<std::filesystem::path> inputs;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(opts.inputDir, ec)) {
+        const std::string ext = entry.path().extension().string();
+        if (entry.is_regular_file() &&
+            (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp")) {
+            inputs.push_back(entry.path());
+        }
+    }
+    if (ec) {
+        std::cerr << "ERROR: Cannot read directory " << opts.inputDir << std::endl;
+        return -1;
+    }
+    std::sort(inputs.begin(), inputs.end());
+    std::filesystem::create_directories(opts.outputDir, ec);
+
+    const AccessoryImages accessories = loadAccessoryImages();
+    const std::string model = (kDataDir / "../data" / kFaceModel).string();
+    const int numWorkers = std::max(1, opts.workers > 0 ? opts.workers
+                               : static_cast<int>(std::thread::hardware_concurrency()));
+
+    std::atomic<size_t> next{0};
+    std::atomic<int> written{0}, failed{0};
+    const auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int w = 0; w < numWorkers; ++w) {
+        workers.emplace_back([&] {
+            cv::CascadeClassifier faceC;
+            if (!faceC.load(model)) {
+                std::cerr << "ERROR: Could not load face cascade." << std::endl;
+                failed += 1;
+                return;
+            }
+            OverlayAssetCache assets(accessories.baseGlasses, accessories.glasses,
+                                     accessories.effects, accessories.mustaches);
+            for (size_t i = next++; i < inputs.size(); i = next++) {
+                cv::Mat frame = cv::imread(inputs[i].string());
+                if (frame.empty()) {
+                    std::cerr << "Error: Could not read " << inputs[i] << std::endl;
+                    failed += 1;
+                    continue;
+                }
+                const std::vector<cv::Rect> faces = detectFaces(faceC, frame);
+                applyGlasses(frame, assets, opts.glassesIdx, opts.reflectionContrast,
+                             opts.glassesAlpha, faces, opts.effectIdx, opts.effectIntensity);
+                applyMustache(frame, assets, opts.mustacheIdx, faces);
+                const auto out = opts.outputDir / inputs[i].filename();
+                if (cv::imwrite(out.string(), frame)) {
+                    written += 1;
+                } else {
+                    std::cerr << "Error: Could not write " << out << std::endl;
+                    failed += 1;
+                }
+            }
+        });
     }
+    for (auto& t : workers) t.join();
+
+    const double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Processed " << written << " of " << inputs.size() << " images in " << seconds
+              << " s with " << numWorkers << " workers (" << written / std::max(seconds, 1e-9)
+              << " images/s)" << std::endl;
+    return failed == 0 ? 0 : -1;
 }
 
 
-int main() {
+int main(int argc, char* argv[]) {
+    // Headless batch mode
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        BatchOptions opts;
+        if (!parseBatchOptions(argc, argv, opts)) {
+            std::cerr << "Usage: " << argv[0] << " --batch <input_dir> <output_dir>"
+                      << " [--glasses N] [--contrast 0-100] [--alpha 0-100] [--effect N]"
+                      << " [--intensity 0-100] [--mustache N] [--workers N]" << std::endl;
+            return -1;
+        }
+        return runBatch(opts);
+    }
+
     // 1. Create windows
     cv::namedWindow(kOptionsWindow, cv::WINDOW_NORMAL);
     cv::resizeWindow(kOptionsWindow, 600, 400);
@@ -350,45 +524,12 @@ int main() {
         return -1;
     }
     // 4. Preload static images
-    std::vector<cv::Mat> staticImages(input_sources.size());
-    for (size_t i = 1; i < input_sources.size(); ++i) {
-        cv::Mat img = cv::imread((kDataDir / "../data" / input_sources[i]).string());
-        if (img.empty()) {
-            std::cerr << "Error: Could not preload '" << input_sources[i] << "'." << std::endl;
-        }
-        staticImages[i] = img;
-    }
-    // 5. Preload sunglasses image and variants
-    cv::Mat baseGlasses = cv::imread((kDataDir / "../data" / "sunglassRGB.png").string());
-    if (baseGlasses.empty()) {
-        std::cerr << "Error: Could not preload base sunglasses." << std::endl;
-    }
-    std::vector<cv::Mat> glassesMats(glasses_images.size());
-    for (size_t i = 1; i < glasses_images.size(); ++i) {
-        cv::Mat gimg = cv::imread((kDataDir / "../data" / glasses_images[i]).string());
-        if (gimg.empty()) {
-            std::cerr << "Error: Could not preload '" << glasses_images[i] << "'." << std::endl;
-        }
-        glassesMats[i] = gimg;
-    }
-    // 6. Preload effects
-    std::vector<cv::Mat> effectsMats(effects_images.size());
-    for (size_t i = 1; i < effects_images.size(); ++i) {
-        cv::Mat eimg = cv::imread((kDataDir / "../data" / effects_images[i]).string());
-        if (eimg.empty()) {
-            std::cerr << "Error: Could not preload '" << effects_images[i] << "'." << std::endl;
-        }
-        effectsMats[i] = eimg;
-    }
-    // 7. Preload mustache images
-    std::vector<cv::Mat> mustacheMats(mustache_images.size());
-    for (size_t i = 1; i < mustache_images.size(); ++i) {
-        cv::Mat mimg = cv::imread((kDataDir / "../data" / mustache_images[i]).string());
-        if (mimg.empty()) {
-            std::cerr << "Error: Could not preload '" << mustache_images[i] << "'." << std::endl;
-        }
-        mustacheMats[i] = mimg;
-    }
+    const std::vector<cv::Mat> staticImages = preloadImages(input_sources);
+    // 5-7. Preload sunglasses, effects and mustaches
+    const AccessoryImages accessories = loadAccessoryImages();
+    // Accessory overlays are prepared lazily and reused across faces and frames
+    OverlayAssetCache assets(accessories.baseGlasses, accessories.glasses,
+                             accessories.effects, accessories.mustaches);
     // 8. Initialize webcam
     cv::VideoCapture cap(0);
     if (cap.isOpened()) {
@@ -397,44 +538,63 @@ int main() {
     } else {
         std::cout << "Warning: Cannot open webcam; static images only." << std::endl;
     }
-    // 9. Setup multi-tracker
-    cv::Ptr<cv::legacy::MultiTracker> multiTracker = cv::legacy::MultiTracker::create();
-    bool trackersInited = false;
+    // 9. Setup background detector and per-face trackers
+    AsyncFaceDetector detector;
+    if (!detector.load((kDataDir / "../data" / kFaceModel).string())) {
+        std::cerr << "ERROR: Could not load face cascade." << std::endl;
+        return -1;
+    }
+    std::vector<FaceTrack> tracks;
     int frameCount = 0;
     std::vector<cv::Rect> faceBoxes;
+    // Face boxes per static source, detected on first use
+    std::vector<std::optional<std::vector<cv::Rect>>> staticFaces(input_sources.size());
+    int lastStaticSrc = -1;
 
     // 10. Main loop
     while (true) {
         cv::Mat frame;
         // 10a. Acquire frame based on source selection
         if (g_srcIdx == 0 && cap.isOpened()) {
+            lastStaticSrc = -1;
             cap >> frame;
             if (frame.empty()) break;
             ++frameCount;
-            bool needRedetect = decideWhetherToRedetect(frameCount, K_FRAMES_DETECTION,
-                    trackersInited, multiTracker, frame);
-            if (needRedetect) {
-                faceBoxes = detectFaces(faceC, frame);
-                if (!faceBoxes.empty()) {
-                    initializeTrackers(faceBoxes, frame, multiTracker);
-                    trackersInited = true;
+            // Track on this thread; detections arrive asynchronously
+            updateTracks(frame, tracks);
+            std::vector<cv::Rect> detections;
+            if (detector.poll(detections)) reconcileTracks(tracks, detections, frame);
+            faceBoxes.clear();
+            for (const auto& t : tracks) faceBoxes.emplace_back(t.box);
+            // Full scan every K frames or while nothing is tracked, ROI re-detection otherwise
+            if (!detector.busy()) {
+                bool fullScan = tracks.empty() || frameCount >= K_FRAMES_DETECTION;
+                if (fullScan || frameCount % K_FRAMES_ROI_DETECTION == 0) {
+                    detector.request(frame, faceBoxes, fullScan);
+                    if (fullScan) frameCount = 0;
                 }
-                frameCount = 0;
-            }
-            if (trackersInited) {
-                updateTrackers(frame, multiTracker);
-                faceBoxes = rect2dToRect(multiTracker->getObjects());
             }
         } else {
+            // Static images never change: re-render only when a trackbar moved
+            if (!g_dirty && g_srcIdx == lastStaticSrc) {
+                int key = cv::waitKey(30) & 0xFF;
+                if (key == 27) break;  // ESC to exit
+                continue;
+            }
+            if (staticImages[g_srcIdx].empty()) break;
+            if (!staticFaces[g_srcIdx]) {
+                staticFaces[g_srcIdx] = detectFaces(faceC, staticImages[g_srcIdx]);
+            }
             frame = staticImages[g_srcIdx].clone();
-            if (frame.empty()) break;
-            faceBoxes = detectFaces(faceC, frame);
+            faceBoxes = *staticFaces[g_srcIdx];
+            lastStaticSrc = g_srcIdx;
+            g_dirty = false;
         }
         // 10b. Overlay accessories
-        applyGlasses(frame, baseGlasses, glassesMats, g_glassesImgIdx,
+        applyGlasses(frame, assets, g_glassesImgIdx,
                      g_reflectionContrast, g_glassesAlpha,
-                     faceBoxes, effectsMats, g_effectImgIdx, g_effectIntensity);
-        applyMustache(frame, mustacheMats, g_mustacheOption, faceBoxes);
+                     faceBoxes, g_effectImgIdx, g_effectIntensity);
+        applyMustache(frame, assets, g_mustacheOption, faceBoxes);
         // 10c. Display result
         cv::imshow(kInputWindow, frame);
         int key = cv::waitKey(30) & 0xFF;